@@ -2621,6 +2621,27 @@ class Program implements TopOpWriter {
                 return undef()
             }
 
+            case "Buffer.getArrayAt":
+            case "Buffer.setArrayAt": {
+                if (
+                    funName == "Buffer.setArrayAt" ||
+                    expr.arguments.length != 2
+                )
+                    this.requireArgs(expr, 3)
+                const fmt = this.parseFormat(expr.arguments[1])
+                const name =
+                    funName == "Buffer.getArrayAt"
+                        ? BuiltInString.GETARRAYAT
+                        : BuiltInString.SETARRAYAT
+                wr.emitCall(
+                    wr.builtInMember(this.emitExpr(obj), name),
+                    this.emitExpr(expr.arguments[0]),
+                    literal(fmt),
+                    ...expr.arguments.slice(2).map(a => this.emitExpr(a))
+                )
+                return this.retVal()
+            }
+
             case "ds.keep": {
                 this.requireArgs(expr, 1)
                 this.ignore(this.emitExpr(expr.arguments[0]))
@@ -38,6 +38,20 @@ export interface DevsKeyValue {
 
 const maxBytesFetch = 512
 
+// not (yet) part of the service spec
+const CMD_READ_ALLOC_PROFILE = 0xa0
+const CMD_READ_HEAP_SNAPSHOT = 0xa1
+// fnIdx values in allocation profile
+export const ALLOC_PROF_NATIVE = 0xfffe
+export const ALLOC_PROF_OTHER = 0xffff
+
+export interface DevsAllocSite {
+    pc: number
+    fnIdx: number
+    count: number
+    bytes: number
+}
+
 export class DevsValue {
     index: number
     tag: DevsDbgValueTag
@@ -432,6 +446,34 @@ export class DevsDbgClient extends JDServiceClient {
         })
     }
 
+    /**
+     * Read allocation-site profile (when runtime was started with profiling enabled).
+     * Sorted by bytes allocated, descending.
+     */
+    async readAllocProfile(): Promise<DevsAllocSite[]> {
+        const pkts = await this.pipeGet(CMD_READ_ALLOC_PROFILE)
+        const res: DevsAllocSite[] = []
+        for (const pkt of pkts.output) {
+            for (let off = 0; off + 12 <= pkt.data.length; off += 12) {
+                const [pc, fnIdx, count, bytes] = jdunpack(
+                    pkt.data.slice(off, off + 12),
+                    "u16 u16 u32 u32"
+                )
+                res.push({ pc, fnIdx, count, bytes })
+            }
+        }
+        return res
+    }
+
+    /**
+     * Read the heap of the suspended program, in Chrome DevTools .heapsnapshot format.
+     */
+    async readHeapSnapshot(): Promise<string> {
+        const pkts = await this.pipeGet(CMD_READ_HEAP_SNAPSHOT)
+        const data = bufferConcatMany(pkts.output.map(pkt => pkt.data))
+        return fromUTF8(uint8ArrayToString(data))
+    }
+
     private unpackValue(buf: Uint8Array) {
         let [v0, v1, fnIdx, tag] = jdunpack(buf, "u32 u32 u16 u8")
 
@@ -507,9 +549,11 @@ export class DevsDbgClient extends JDServiceClient {
     }
 
     private async pipeGet(cmd: number, suff?: Uint8Array) {
-        assert(cmd == DevsDbgCmd.ReadFibers || this.suspended)
+        const anytime =
+            cmd == DevsDbgCmd.ReadFibers || cmd == CMD_READ_ALLOC_PROFILE
+        assert(anytime || this.suspended)
         return this.runExclusive(async () => {
-            assert(cmd == DevsDbgCmd.ReadFibers || this.suspended)
+            assert(anytime || this.suspended)
             const inp = new InPipeReader(this.device.bus)
             const openPkt = inp.openCommand(cmd)
             if (suff) openPkt.data = bufferConcat(openPkt.data, suff)
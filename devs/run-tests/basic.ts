@@ -228,6 +228,64 @@ function testBuffer() {
     isEq(buf[2], 0x33)
     isEq(buf[3], 0x12)
     isEq(buf[4], 0x13)
+
+    const sub = buf.subarray(1, 5)
+    isEq(sub.length, 4)
+    isEq(sub[0], 0x33)
+    sub[1] = 0x44
+    isEq(buf[2], 0x44)
+    sub.setAt(2, "u16", 0x1234)
+    isEq(buf.getAt(3, "u16"), 0x1234)
+    const sub2 = sub.subarray(-2)
+    isEq(sub2.length, 2)
+    isEq(sub2.toString("hex"), "3412")
+    isEq(buf.subarray(5, 2).length, 0)
+    isEq(b2.subarray(1, 3).toString("hex"), "3323")
+
+    const b3 = hex`00 11 22 33`
+    isEq(b3.slice(1, 3).toString("hex"), "1122")
+    isEq(b3.slice(-1).toString("hex"), "33")
+    isEq(b3.slice(3, 1).length, 0)
+    const cp = b3.slice()
+    cp[0] = 0x42
+    isEq(b3[0], 0)
+    isEq(b3.concat(b2).toString("hex"), "0011223372332312")
+    isEq(Buffer.concat(b2, b3.subarray(2), b2).toString("hex"), "72332312223372332312")
+    isEq(Buffer.concat().length, 0)
+    cp.set(b2.subarray(2), 1)
+    isEq(cp.toString("hex"), "42231233")
+    cp.set(b2, 2)
+    isEq(cp.toString("hex"), "42237233")
+    cp.set(cp.subarray(0, 3), 1)
+    isEq(cp.toString("hex"), "42422372")
+
+    const b4 = hex`01 02 03 01 02 03`
+    isEq(b4.indexOf(hex`02 03`), 1)
+    isEq(b4.indexOf(hex`02 03`, 2), 4)
+    isEq(b4.indexOf(hex`02 03`, 2, 5), -1)
+    isEq(b4.indexOf(hex`03 04`), -1)
+    isEq(b4.lastIndexOf(hex`01 02`), 3)
+    isEq(b4.lastIndexOf(hex`01 02`, 0, 4), 0)
+    isEq(b4.lastIndexOf(3), 5)
+
+    const b5 = Buffer.alloc(9)
+    b5.setArrayAt(1, "i16", [1, -2, 70000, -1])
+    isEq(b5.toString("hex"), "000100feffff7fffff")
+    const arr = b5.getArrayAt(1, "i16")
+    isEq(arr.length, 4)
+    isEq(arr[1], -2)
+    isEq(arr[2], 0x7fff)
+    isEq(b5.getArrayAt(0, "u8", 3).join(), "0,1,0")
+    b5.setArrayAt(0, "f32", [1.5, -0.25])
+    isEq(b5.getArrayAt(0, "f32").join(), "1.5,-0.25")
+    let ok = false
+    try {
+        b5.setArrayAt(6, "u16", [1, 2])
+    } catch (e) {
+        ds.assert(e instanceof RangeError)
+        ok = true
+    }
+    ds.assert(ok)
 }
 
 function three(a: number, b: number, c: number) {
@@ -928,6 +986,17 @@ function expectTypeError(f: () => void) {
     ds.assert(ok)
 }
 
+function expectSyntaxError(f: () => void) {
+    let ok = false
+    try {
+        f()
+    } catch (e) {
+        ds.assert(e instanceof SyntaxError)
+        ok = true
+    }
+    ds.assert(ok)
+}
+
 function testQDot() {
     let q: any = null
     let i = 0
@@ -1055,6 +1124,20 @@ function testStringMethods() {
     ds.assert("foobarbaz".indexOf("foo", 1) === -1)
     ds.assert("ffoo".startsWith("foo") === false)
     ds.assert("ffoo".endsWith("fo") === false)
+    isEq("żółw ab żółw".lastIndexOf("żółw"), 8)
+    isEq("żółw ab żółw".indexOf("ab", 2), 5)
+    isEq("canal".lastIndexOf("a", 2), 1)
+    isEq(" \t żółw\u00a0\r\n".trim(), "żółw")
+    isEq("a;ż;;b".split(";").join("|"), "a|ż||b")
+    isEq("żół".split("").length, 3)
+    isEq("".split(",").length, 1)
+    isEq("a,b,c".replace(",", ";"), "a;b,c")
+    isEq("a,b,c".replaceAll(",", ", "), "a, b, c")
+    isEq("Żółw ABC xyz".toLowerCase(), "Żółw abc xyz")
+    isEq("Żółw ABC xyz".toUpperCase(), "Żółw ABC XYZ")
+    const lo = ds._id("abc")
+    ds.assert(lo < "abd" && lo <= "abc" && !(lo < "abc") && "ab" < lo)
+    ds.assert("z" < "ż" && !("b" <= "a"))
 
     const buf = hex`0011223322`
     ds.assert(buf.indexOf(0x00) === 0)
@@ -1112,6 +1195,316 @@ function testForIn() {
     }
 }
 
+function testGcStats() {
+    const arr = [1, 2, 3]
+    const st = ds.gcStats()
+    ds.assert(st.numAlloc["array"] > 0)
+    ds.assert(st.allocBytes["array"] > 0)
+    ds.assert(st.markTime.length === st.sweepTime.length)
+    ds.assert(st.maxFreeBlock <= st.freeBytes)
+    isEq(arr.length, 3)
+}
+
+function testRegCacheStats() {
+    const st = ds.regCacheStats()
+    ds.assert(st.size > 0)
+    ds.assert(st.hits >= 0)
+    ds.assert(st.misses >= 0)
+}
+
+function testHandleScopes() {
+    const shared = [1]
+    const o: any = { a: shared, b: shared }
+    isEq(JSON.stringify(o), '{"a":[1],"b":[1]}')
+    o.self = o
+    let thrown = false
+    try {
+        JSON.stringify(o)
+    } catch {
+        thrown = true
+    }
+    ds.assert(thrown)
+
+    // nesting deeper than the initial root stack
+    let deep = "1"
+    for (let i = 0; i < 40; ++i) deep = "[" + deep + "]"
+    isEq(JSON.stringify(JSON.parse(deep)), deep)
+
+    const s = "ab" + deep.length
+    isEq(s + s, "ab83ab83")
+}
+
+function testRopes() {
+    let s = ""
+    for (let i = 0; i < 200; ++i) s = s + "x" + i + ","
+    isEq(s.length, 890)
+    isEq(s.slice(0, 9), "x0,x1,x2,")
+    isEq(s.charCodeAt(s.length - 1), 44)
+
+    let p = ""
+    for (let i = 0; i < 100; ++i) p = "ab" + p
+    isEq(p.length, 200)
+    isEq(p.indexOf("ba"), 1)
+
+    const u = "żółw " + s + " żółw"
+    isEq(u.length, s.length + 10)
+    isEq(u[1], "ó")
+    isEq(u + "", u)
+    isEq(JSON.parse(JSON.stringify({ u })).u, u)
+}
+
+function testAsciiChars() {
+    const s = "hello, wórld"
+    let r = ""
+    for (const c of s) r = c + r
+    isEq(r, "dlrów ,olleh")
+    isEq(s[4], "o")
+    isEq(s.charAt(0), "h")
+    isEq(s[7] + s[8], "wó")
+    isEq(String.fromCharCode(97), "a")
+    isEq(s.slice(11, 12), "d")
+    isEq(typeof s[0], "string")
+    isEq(s[1].toUpperCase(), "E")
+    isEq(s[1].length, 1)
+
+    const counts: Record<string, number> = {}
+    for (const c of "abracadabra") counts[c] = (counts[c] || 0) + 1
+    isEq(counts["a"], 5)
+    isEq(counts.b, 2)
+    isEq(JSON.stringify(counts), '{"a":5,"b":2,"r":2,"c":1,"d":1}')
+
+    let long = ""
+    for (let i = 0; i < 100; ++i) long += "0123456789"
+    const st0 = ds.gcStats().numAlloc["string"]
+    let n = 0
+    for (let i = 0; i < long.length; ++i) if (long[i] === "7") n++
+    const st1 = ds.gcStats().numAlloc["string"]
+    isEq(n, 100)
+    ds.assert(st1 - st0 < 100, "chars allocate")
+}
+
+function testNumberToString() {
+    isEq(0.1 + 0.2 + "", "0.30000000000000004")
+    isEq(1 / 3 + "", "0.3333333333333333")
+    isEq(123.456 + "", "123.456")
+    isEq(-1.5e-7 + "", "-1.5e-7")
+    isEq(0.000001 + "", "0.000001")
+    isEq(1e21 + "", "1e+21")
+    isEq(2 ** 53 + "", "9007199254740992")
+    isEq(-0 + "", "0")
+    isEq(5e-324 + "", "5e-324")
+    isEq(1.7976931348623157e308 + "", "1.7976931348623157e+308")
+    isEq(-2147483648 + "", "-2147483648")
+    isEq(3000000000 + "", "3000000000")
+    isEq(JSON.stringify([1.25, -7, 0.1, 1e-10]), "[1.25,-7,0.1,1e-10]")
+    isEq([1, 2.5, 17].join(), "1,2.5,17")
+
+    for (let i = -50; i < 1000; i += 7) isEq(parseFloat(i + ""), i)
+    for (let x = 0.001; x < 1e6; x *= 3.7) isEq(parseFloat(x + ""), x)
+
+    // repeated conversions of the same ints are cached
+    let s = ""
+    for (let i = 0; i < 20; ++i) s = (i & 7) + 100 + ""
+    const st0 = ds.gcStats().numAlloc["string"]
+    for (let i = 0; i < 100; ++i) s = (i & 7) + 100 + ""
+    const st1 = ds.gcStats().numAlloc["string"]
+    isEq(s, "103")
+    ds.assert(st1 - st0 < 10, "int strings cached")
+}
+
+function testNumberParsing() {
+    isEq(parseFloat("0.30000000000000004"), 0.1 + 0.2)
+    isEq(parseFloat("  -12.5e-3xyz"), -0.0125)
+    isEq(parseFloat("1e400"), Infinity)
+    isEq(parseFloat("5e-324") > 0, true)
+    isEq(parseFloat("123456789012345678901234567890"), 1.2345678901234568e29)
+    isEq(parseFloat(".5"), 0.5)
+    ds.assert(isNaN(parseFloat("-")), "NaN")
+    isEq(parseInt("0x1F"), 31)
+    isEq(parseInt("42.9"), 42)
+
+    const v = JSON.parse(
+        '{"ts":1680000000,"temp":23.47,"lat":47.6062095,"lon":-122.3320708,"acc":[0.0123,-9.81e0,1E-3]}'
+    )
+    isEq(v.ts, 1680000000)
+    isEq(v.temp, 23.47)
+    isEq(v.lat, 47.6062095)
+    isEq(v.lon, -122.3320708)
+    isEq(v.acc[1], -9.81)
+    isEq(v.acc[2], 0.001)
+    for (let x = 1e-5; x < 1e10; x *= 7.3) isEq(JSON.parse(JSON.stringify(x)), x)
+}
+
+function testJsonParse() {
+    // long enough to take the pre-sized path
+    const rows: any[] = []
+    for (let i = 0; i < 20; ++i)
+        rows.push({ id: i, name: "r\"ow" + i, tags: [i, [], {}, "ż\n"] })
+    const js = JSON.stringify({ rows, empty: [], nested: [[1, [2, [3]]], { a: { b: null } }] })
+    const o = JSON.parse(js)
+    isEq(o.rows.length, 20)
+    isEq(o.rows[19].name, 'r"ow19')
+    isEq(o.rows[3].tags.length, 4)
+    isEq(o.rows[3].tags[3], "ż\n")
+    isEq(o.nested[0][1][1][0], 3)
+    isEq(JSON.stringify(o), js)
+    isEq(JSON.parse('"a\\u00e9\\ud83d\\ude00b"'), "a\u00e9\ud83d\ude00b")
+    isEq(JSON.parse('"[,{}]"'), "[,{}]")
+    isEq(JSON.parse(' [ "]" , "\\"]" ] ').length, 2)
+    for (const bad of ["[1,2", '{"a":1,}', '"abc', "[1 2]", '{"a" 1}']) expectErr(bad)
+}
+
+function testJsonStream() {
+    const doc = JSON.stringify({
+        a: [1, -2.5e3, true, null, "x\"ż😀"],
+        b: { c: "\ud83d\ude00", d: [] },
+    })
+    const buf = Buffer.from(doc)
+    // split everywhere, including inside strings, numbers and UTF-8 sequences
+    for (let step = 1; step < 8; ++step) {
+        const p = JSON.createParser()
+        const res: any[] = []
+        for (let i = 0; i < buf.length; i += step)
+            for (const v of p.write(buf.slice(i, i + step))) res.push(v)
+        for (const v of p.end()) res.push(v)
+        isEq(res.length, 1)
+        isEq(JSON.stringify(res[0]), doc)
+    }
+
+    const p = JSON.createParser()
+    isEq(p.write('{"x":1} [2').length, 1)
+    isEq(p.write("]12").length, 1)
+    const last = p.end()
+    isEq(last.length, 1)
+    isEq(last[0], 12)
+
+    expectSyntaxError(() => p.write("[1}"))
+    const p2 = JSON.createParser()
+    p2.write("[1,")
+    expectSyntaxError(() => p2.end())
+
+    // the parser state is opaque to the program, and nothing else is accepted in its place
+    const p3 = JSON.createParser()
+    p3.write('{"a":[tr')
+    isEq(typeof (p3 as any).state, "object")
+    isEq(p3.write("ue]}").length, 1)
+    ;(p3 as any).state = [{}]
+    expectTypeError(() => p3.write("1"))
+}
+
+function testJsonWrite() {
+    let e = ""
+    for (let i = 0; i < 100; ++i) e += "x"
+    const obj = { a: [1, "ż", { b: null }], c: { d: undefined }, e }
+    const exp = JSON.stringify(obj)
+    const buf = Buffer.alloc(200)
+    const n = buf.writeJSON(obj, 3)
+    isEq(n, Buffer.from(exp).length)
+    isEq(buf.slice(3, 3 + n).toString(), exp)
+    isEq(buf[2], 0)
+    isEq(buf[3 + n], 0)
+    let ok = false
+    try {
+        Buffer.alloc(50).writeJSON(obj)
+    } catch (e) {
+        ds.assert(e instanceof RangeError)
+        ok = true
+    }
+    ds.assert(ok)
+    ds.traceJSON(obj)
+}
+
+function testCbor() {
+    const obj = {
+        a: [1, -2, 1.5, 100000, -1e10, "ż"],
+        b: { c: null, d: true, e: false },
+        f: hex`0102ff`,
+        g: "x",
+    }
+    const buf = ds.encodeCBOR(obj)
+    ds.assert(buf.length < JSON.stringify(obj).length)
+    const r = ds.decodeCBOR(buf)
+    isEq(JSON.stringify(r.a), JSON.stringify(obj.a))
+    isEq(JSON.stringify(r.b), JSON.stringify(obj.b))
+    isEq(r.f.toString("hex"), "0102ff")
+    isEq(r.g, "x")
+    // the output buffer is grown a few times
+    const arr: number[] = []
+    for (let i = 0; i < 300; ++i) arr.push(i * 1000)
+    const big = ds.encodeCBOR(arr)
+    isEq(big.length, 3 + 1 + 65 * 3 + 234 * 5)
+    isEq(JSON.stringify(ds.decodeCBOR(big)), JSON.stringify(arr))
+    isEq(ds.decodeCBOR(hex`a1016161`)["1"], "a")
+    ds.assert(isNaN(ds.decodeCBOR(hex`f97e00`)))
+    expectSyntaxError(() => ds.decodeCBOR(hex`83 01 02`))
+    expectSyntaxError(() => ds.decodeCBOR(hex`01 02`))
+}
+
+function testStringBuilder() {
+    const parts: any[] = []
+    for (let i = 0; i < 100; ++i) parts.push(i % 3 ? "ż" + i : i)
+    const j = parts.join("; ")
+    isEq(j.length, 190 + 66 + 99 * 2)
+    isEq(j.slice(0, 9), "0; ż1; ż2")
+    isEq(parts.join(), parts.join(","))
+    isEq([].join(), "")
+
+    const big = { arr: parts, nested: { s: j } }
+    isEq(JSON.parse(JSON.stringify(big)).nested.s, j)
+    isEq(JSON.stringify({ a: [1, "x"] }, null, 2), '{\n  "a": [\n    1,\n    "x"\n  ]\n}')
+    isEq(ds.format("{0}-{1}", 1, "ż"), "1-ż")
+    isEq(ds.format("{0}", [1, "a"]), '[1,"a"]')
+    const long = ds.format("{0}", parts.map((_, i) => i))
+    isEq(long.length, 100)
+    isEq(long.slice(-3), "...")
+}
+
+function testTypedArray() {
+    const a = new Int16Array(4)
+    isEq(a.length, 4)
+    isEq(a.byteLength, 8)
+    a[0] = 0x12345
+    a[1] = -3
+    isEq(a[0], 0x2345)
+    isEq(a[1], -3)
+    isEq(a[4], undefined)
+    isEq(a.buffer.getAt(2, "i16"), -3)
+
+    const f = new Float32Array([1.5, 2, -0.25])
+    isEq(f.length, 3)
+    isEq(f[0] + f[1] + f[2], 3.25)
+    const u = new Uint32Array(f)
+    isEq(u[1], 2)
+    u[0] = -1
+    isEq(u[0], 0xffffffff)
+
+    const buf = Buffer.alloc(10)
+    const b = new Uint16Array(buf, 2, 3)
+    b.fill(0x101)
+    isEq(buf.toString("hex"), "00000101010101010000")
+    const s = b.subarray(1)
+    isEq(s.length, 2)
+    isEq(s.byteOffset, 4)
+    s[1] = 7
+    isEq(buf[6], 7)
+    b.set([9, 8], 1)
+    isEq(s[0], 9)
+
+    const d = new Float64Array(2)
+    d[1] = Math.PI
+    isEq(d[1], Math.PI)
+    ds.assert(!(d instanceof Float32Array))
+
+    let ok = false
+    try {
+        a[10] = 1
+    } catch (e) {
+        ds.assert(e instanceof RangeError)
+        ok = true
+    }
+    ds.assert(ok)
+}
+
 testFlow()
 if (x !== 42) _panic(10)
 testMath()
@@ -1156,5 +1549,18 @@ testWhenUsed()
 testStringMethods()
 testObjArrayCtor()
 testForIn()
+testGcStats()
+testRegCacheStats()
+testHandleScopes()
+testRopes()
+testStringBuilder()
+testAsciiChars()
+testNumberToString()
+testNumberParsing()
+testJsonParse()
+testJsonStream()
+testJsonWrite()
+testCbor()
+testTypedArray()
 
 console.log("all OK")
@@ -120,44 +120,3 @@ Array.prototype.reduce = function (callbackfn: any, initialValue: any) {
     }
     return initialValue
 }
-
-Buffer.prototype.set = function (other: Buffer, trgOff?: number) {
-    if (!trgOff) trgOff = 0
-    this.blitAt(trgOff, other, 0, other.length)
-}
-
-Buffer.prototype.concat = function (other: Buffer) {
-    const r = Buffer.alloc(this.length + other.length)
-    r.set(this)
-    r.set(other, this.length)
-    return r
-}
-
-Buffer.prototype.slice = function (start?: number, end?: number) {
-    if (end === undefined) end = this.length
-    if (start === undefined) start = 0
-    const len = end - start
-    if (len <= 0 || start >= this.length) return Buffer.alloc(0)
-    const r = Buffer.alloc(len)
-    r.blitAt(0, this, start, len)
-    return r
-}
-
-Buffer.concat = function (...buffers: Buffer[]) {
-    let size = 0
-    for (const b of buffers) {
-        size += b.length
-    }
-    const r = Buffer.alloc(size)
-    size = 0
-    for (const b of buffers) {
-        r.blitAt(size, b, 0, b.length)
-        size += b.length
-    }
-    return r
-}
-
-Buffer.prototype.lastIndexOf = function (byte, startOffset, endOffset) {
-    if (endOffset == undefined) endOffset = this.length
-    return this.indexOf(byte, startOffset, -endOffset)
-}
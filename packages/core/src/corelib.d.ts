@@ -181,6 +181,22 @@ interface String {
      * @param limit A value used to limit the number of elements returned in the array.
      */
     split(separator: string, limit?: number): string[]
+
+    /**
+     * Replaces the first occurrence of a substring.
+     * Regular expressions and replacement patterns (`$&` etc.) are not supported.
+     * @param searchValue The substring to search for.
+     * @param replaceValue The string to insert in place of the match.
+     */
+    replace(searchValue: string, replaceValue: string): string
+
+    /**
+     * Replaces all occurrences of a substring.
+     * Regular expressions and replacement patterns (`$&` etc.) are not supported.
+     * @param searchValue The substring to search for.
+     * @param replaceValue The string to insert in place of each match.
+     */
+    replaceAll(searchValue: string, replaceValue: string): string
 }
 
 interface StringConstructor {
@@ -393,6 +409,145 @@ interface ArrayConstructor {
 
 declare var Array: ArrayConstructor
 
+/**
+ * Array of numbers of a fixed type, stored in a Buffer.
+ * Writing outside of the array throws a `RangeError`; values are converted to the element type.
+ */
+interface TypedArray {
+    /**
+     * Number of elements in the array.
+     */
+    readonly length: number
+    /**
+     * Buffer holding the elements.
+     */
+    readonly buffer: Buffer
+    /**
+     * Offset in bytes of the first element in `buffer`.
+     */
+    readonly byteOffset: number
+    /**
+     * Size in bytes of the array.
+     */
+    readonly byteLength: number
+    [index: number]: number
+
+    /**
+     * Return an array of the same type sharing the underlying buffer.
+     * Negative indices count from the end of the array.
+     * @param begin defaults to 0
+     * @param end defaults to array length
+     */
+    subarray(begin?: number, end?: number): this
+    /**
+     * Copy elements of `array` into this array, starting at `offset`.
+     * @param offset defaults to 0
+     */
+    set(array: number[] | TypedArray, offset?: number): void
+    /**
+     * Set elements from `start` to `end` to `value`.
+     * @param start defaults to 0
+     * @param end defaults to array length
+     */
+    fill(value: number, start?: number, end?: number): this
+}
+
+/**
+ * Array of 8-bit signed integers.
+ */
+interface Int8Array extends TypedArray {}
+interface Int8ArrayConstructor {
+    new (length?: number): Int8Array
+    new (array: number[] | TypedArray): Int8Array
+    new (buffer: Buffer, byteOffset?: number, length?: number): Int8Array
+    readonly prototype: Int8Array
+}
+declare var Int8Array: Int8ArrayConstructor
+
+/**
+ * Array of 8-bit unsigned integers.
+ */
+interface Uint8Array extends TypedArray {}
+interface Uint8ArrayConstructor {
+    new (length?: number): Uint8Array
+    new (array: number[] | TypedArray): Uint8Array
+    new (buffer: Buffer, byteOffset?: number, length?: number): Uint8Array
+    readonly prototype: Uint8Array
+}
+declare var Uint8Array: Uint8ArrayConstructor
+
+/**
+ * Array of 16-bit signed integers.
+ */
+interface Int16Array extends TypedArray {}
+interface Int16ArrayConstructor {
+    new (length?: number): Int16Array
+    new (array: number[] | TypedArray): Int16Array
+    new (buffer: Buffer, byteOffset?: number, length?: number): Int16Array
+    readonly prototype: Int16Array
+}
+declare var Int16Array: Int16ArrayConstructor
+
+/**
+ * Array of 16-bit unsigned integers.
+ */
+interface Uint16Array extends TypedArray {}
+interface Uint16ArrayConstructor {
+    new (length?: number): Uint16Array
+    new (array: number[] | TypedArray): Uint16Array
+    new (buffer: Buffer, byteOffset?: number, length?: number): Uint16Array
+    readonly prototype: Uint16Array
+}
+declare var Uint16Array: Uint16ArrayConstructor
+
+/**
+ * Array of 32-bit signed integers.
+ */
+interface Int32Array extends TypedArray {}
+interface Int32ArrayConstructor {
+    new (length?: number): Int32Array
+    new (array: number[] | TypedArray): Int32Array
+    new (buffer: Buffer, byteOffset?: number, length?: number): Int32Array
+    readonly prototype: Int32Array
+}
+declare var Int32Array: Int32ArrayConstructor
+
+/**
+ * Array of 32-bit unsigned integers.
+ */
+interface Uint32Array extends TypedArray {}
+interface Uint32ArrayConstructor {
+    new (length?: number): Uint32Array
+    new (array: number[] | TypedArray): Uint32Array
+    new (buffer: Buffer, byteOffset?: number, length?: number): Uint32Array
+    readonly prototype: Uint32Array
+}
+declare var Uint32Array: Uint32ArrayConstructor
+
+/**
+ * Array of 32-bit floats.
+ */
+interface Float32Array extends TypedArray {}
+interface Float32ArrayConstructor {
+    new (length?: number): Float32Array
+    new (array: number[] | TypedArray): Float32Array
+    new (buffer: Buffer, byteOffset?: number, length?: number): Float32Array
+    readonly prototype: Float32Array
+}
+declare var Float32Array: Float32ArrayConstructor
+
+/**
+ * Array of 64-bit floats.
+ */
+interface Float64Array extends TypedArray {}
+interface Float64ArrayConstructor {
+    new (length?: number): Float64Array
+    new (array: number[] | TypedArray): Float64Array
+    new (buffer: Buffer, byteOffset?: number, length?: number): Float64Array
+    readonly prototype: Float64Array
+}
+declare var Float64Array: Float64ArrayConstructor
+
 declare namespace console {
     /**
      * Same as `console.log`.
@@ -615,6 +770,24 @@ interface SyntaxErrorConstructor extends ErrorConstructor {
 }
 declare var SyntaxError: SyntaxErrorConstructor
 
+/**
+ * Incremental JSON parser; see `JSON.createParser()`.
+ */
+interface JSONParser {
+    /**
+     * Parses the next piece of input.
+     * Returns the top-level values completed by it (possibly none).
+     * Several values may follow one another, separated by whitespace.
+     * @param chunk Next piece of the input, split anywhere (also inside UTF-8 characters).
+     */
+    write(chunk: Buffer | string): any[]
+    /**
+     * Signals the end of input; throws `SyntaxError` if a value is incomplete.
+     * The parser can be reused for another input afterwards.
+     */
+    end(): any[]
+}
+
 interface JSON {
     /**
      * Converts a JavaScript Object Notation (JSON) string into an object.
@@ -628,6 +801,11 @@ interface JSON {
      * @param space Adds indentation, white space, and line break characters to the return-value JSON text to make it easier to read.
      */
     stringify(value: any, replacer?: null, space?: number): string
+    /**
+     * Creates a parser that accepts a JSON text in pieces, for example as it arrives from a socket.
+     * The whole text never needs to be in memory at once.
+     */
+    createParser(): JSONParser
 }
 /**
  * An intrinsic object that provides functions to convert JavaScript values to and from the JavaScript Object Notation (JSON) format.
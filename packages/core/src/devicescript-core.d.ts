@@ -317,6 +317,12 @@ declare module "@devicescript/core" {
      */
     export function keep(method: any): void
 
+    /**
+     * Append `value` as a line of JSON to the trace log, when it is enabled (`-l` in the native runtime).
+     * The JSON is written in small pieces, without building the whole string in memory.
+     */
+    export function traceJSON(value: any): void
+
     /**
      * Print out internal representation of a given value, possibly prefixed by label.
      * @internal
@@ -389,6 +395,46 @@ declare module "@devicescript/core" {
      */
     export function isSimulator(): boolean
 
+    /**
+     * Return garbage collector counters.
+     * `markTime` and `sweepTime` are histograms; bucket `i` counts collections taking less than `16 << (2 * i)` microseconds.
+     * `numAlloc` and `allocBytes` are keyed by heap object type.
+     */
+    export function gcStats(): {
+        numGC: number
+        liveBytes: number
+        freeBytes: number
+        freeBlocks: number
+        maxFreeBlock: number
+        markTime: number[]
+        sweepTime: number[]
+        numAlloc: Record<string, number>
+        allocBytes: Record<string, number>
+    }
+
+    /**
+     * Return register cache counters.
+     * A read is a hit when it is served from the cache, and a miss when it has to wait for the value from the bus.
+     */
+    export function regCacheStats(): {
+        size: number
+        hits: number
+        misses: number
+    }
+
+    /**
+     * Encode value as CBOR (RFC 8949), a compact binary alternative to JSON.
+     * Objects are encoded as maps and buffers as byte strings; functions are skipped.
+     */
+    export function encodeCBOR(value: any): Buffer
+
+    /**
+     * Decode CBOR data, as produced by `encodeCBOR()`.
+     * Map keys are converted to strings; tags are ignored.
+     * Throws `SyntaxError` on malformed input.
+     */
+    export function decodeCBOR(data: Buffer): any
+
     /*
      * Print out message. Used by console.log, etc.
      */
@@ -439,6 +485,18 @@ declare module "@devicescript/core" {
             setLength(len: number): void
             getAt(offset: number, format: string): number
             setAt(offset: number, format: string, value: number): void
+            /**
+             * Read consecutive numbers of the same format, starting at `offset`.
+             * @param format format descriptor, like in `getAt()`
+             * @param count maximal number of values to read; defaults to as many as fit
+             */
+            getArrayAt(offset: number, format: string, count?: number): number[]
+            /**
+             * Write consecutive numbers of the same format, starting at `offset`.
+             * Throws `RangeError` if they don't fit.
+             * @param format format descriptor, like in `setAt()`
+             */
+            setArrayAt(offset: number, format: string, values: number[]): void
             blitAt(
                 offset: number,
                 src: Buffer | string,
@@ -447,18 +505,25 @@ declare module "@devicescript/core" {
             ): void
             fillAt(offset: number, length: number, value: number): void
             /**
-             * Return index of specified byte in buffer or -1 if not found.
-             * @param byte
+             * Return index of specified byte, or sequence of bytes, in buffer or -1 if not found.
+             * @param byte a byte value, or a buffer or string to search for
              * @param startOffset defaults to 0
              * @param endOffset defaults to buffer length (`endOffset < 0` has special meaning)
              */
             indexOf(
-                byte: number,
+                byte: number | Buffer | string,
                 startOffset?: number,
                 endOffset?: number
             ): number
+            /**
+             * Return index of the last occurrence of specified byte, or sequence of bytes, in buffer
+             * or -1 if not found.
+             * @param byte a byte value, or a buffer or string to search for
+             * @param startOffset defaults to 0
+             * @param endOffset defaults to buffer length
+             */
             lastIndexOf(
-                byte: number,
+                byte: number | Buffer | string,
                 startOffset?: number,
                 endOffset?: number
             ): number
@@ -466,9 +531,37 @@ declare module "@devicescript/core" {
 
             toString(encoding?: "hex" | "utf-8" | "utf8"): string
 
+            /**
+             * Write JSON representation of the value into the buffer, without creating a string.
+             * Throws `RangeError` if it doesn't fit.
+             * @param offset defaults to 0
+             * @returns number of bytes written
+             */
+            writeJSON(value: any, offset?: number): number
+
+            /**
+             * Copy `from` into this buffer, starting at `targetOffset`.
+             * Data that doesn't fit is ignored.
+             * @param targetOffset defaults to 0
+             */
             set(from: Buffer, targetOffset?: number): void
             concat(other: Buffer): Buffer
+            /**
+             * Return a copy of part of the buffer.
+             * Negative indices count from the end of the buffer.
+             * @param from defaults to 0
+             * @param to defaults to buffer length
+             */
             slice(from?: number, to?: number): Buffer
+
+            /**
+             * Return a view of part of the buffer, without copying the data.
+             * Writes to the view are visible in this buffer and vice versa.
+             * Negative indices count from the end of the buffer.
+             * @param start defaults to 0
+             * @param end defaults to buffer length
+             */
+            subarray(start?: number, end?: number): Buffer
         }
 
         /**
@@ -5,7 +5,7 @@ import "./utils"
 import "./buffer"
 import "./timeouts"
 import "./array"
-import "./string"
+import "./json"
 import "./events"
 import "./jacdac"
 import "./led"
@@ -0,0 +1,23 @@
+import * as ds from "@devicescript/core"
+
+type DsJson = typeof ds & {
+    _jsonParser(): unknown
+    _jsonFeed(state: unknown, chunk: Buffer | string | null): any[]
+}
+
+class StreamingJSONParser {
+    // opaque object managed by the runtime
+    private state = (ds as DsJson)._jsonParser()
+
+    write(chunk: Buffer | string): any[] {
+        return (ds as DsJson)._jsonFeed(this.state, chunk)
+    }
+
+    end(): any[] {
+        return (ds as DsJson)._jsonFeed(this.state, null)
+    }
+}
+
+JSON.createParser = function createParser() {
+    return new StreamingJSONParser()
+}
@@ -78,20 +78,26 @@ export class Response {
         this.headers = new Headers()
     }
 
-    async buffer() {
-        if (this._buffer) return this._buffer
+    private async readBody(onData: (buf: Buffer) => void) {
         const explen = parseInt(this.headers.get("content-length"))
-        const buffers: Buffer[] = []
         let buflen = 0
         for (;;) {
             const buf = await this.socket.recv()
             if (!buf) break
             buflen += buf.length
-            buffers.push(buf)
+            onData(buf)
             // note: explen can be NaN
             if (buflen >= explen) break
         }
         await this.socket.close()
+    }
+
+    async buffer() {
+        if (this._buffer) return this._buffer
+        const buffers: Buffer[] = []
+        await this.readBody(buf => {
+            buffers.push(buf)
+        })
         this._buffer = Buffer.concat(...buffers)
         return this._buffer
     }
@@ -101,7 +107,17 @@ export class Response {
     }
 
     async json() {
-        return JSON.parse(await this.text())
+        if (this._buffer) return JSON.parse(await this.text())
+        // parse as the body arrives, so that it is never held in memory as a whole
+        const parser = JSON.createParser()
+        const values: any[] = []
+        await this.readBody(buf => {
+            for (const v of parser.write(buf)) values.push(v)
+        })
+        for (const v of parser.end()) values.push(v)
+        if (values.length != 1)
+            throw new SyntaxError("expecting a single JSON value")
+        return values[0]
     }
 
     async close() {
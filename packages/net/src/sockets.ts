@@ -5,6 +5,7 @@ type DsSockets = typeof ds & {
     _socketOpen(host: string, port: number): number
     _socketClose(): number
     _socketWrite(buf: Buffer | string): number
+    _socketWriteJSON(value: any): number
     _socketOnEvent(event: SocketEvent, arg?: Buffer | string): void
 }
 
@@ -103,6 +104,17 @@ export class Socket {
         }
     }
 
+    /**
+     * Send JSON representation of the value over the socket.
+     * The JSON is written out in small pieces and never built as a whole string.
+     * Throws when connection is closed or there is an error.
+     */
+    async sendJSON(value: any) {
+        this.check()
+        const r = (ds as DsSockets)._socketWriteJSON(value)
+        if (r !== 0) throw this.error(`send error ${r}`)
+    }
+
     private finish(msg: string) {
         if (msg !== null) this.lastError = this.error(msg)
         this.closed = true
@@ -0,0 +1,94 @@
+#include "devs_internal.h"
+
+static inline unsigned site_hash(unsigned pc) {
+    return (pc ^ (pc >> 6)) & (DEVS_ALLOC_PROF_SIZE - 1);
+}
+
+void devs_alloc_prof_init(devs_ctx_t *ctx) {
+    JD_ASSERT(ctx->alloc_prof == NULL);
+    if (devs_get_global_flags() & DEVS_FLAG_ALLOC_PROFILE) {
+        ctx->alloc_prof = jd_alloc(sizeof(devs_alloc_site_t) * (DEVS_ALLOC_PROF_SIZE + 1));
+        ctx->alloc_prof[DEVS_ALLOC_PROF_SIZE].fn_idx = DEVS_ALLOC_PROF_OTHER;
+    }
+}
+
+void devs_alloc_prof_free(devs_ctx_t *ctx) {
+    if (ctx->alloc_prof) {
+        devs_alloc_prof_dump(ctx);
+        jd_free(ctx->alloc_prof);
+        ctx->alloc_prof = NULL;
+    }
+}
+
+void devs_alloc_prof_record(devs_ctx_t *ctx, unsigned size) {
+    devs_alloc_site_t *tbl = ctx->alloc_prof;
+    unsigned pc = 0;
+    unsigned fn_idx = DEVS_ALLOC_PROF_NATIVE;
+    devs_activation_t *fn = ctx->curr_fn;
+    if (fn) {
+        pc = fn->pc;
+        fn_idx = fn->func - devs_img_get_function(ctx->img, 0);
+    }
+
+    devs_alloc_site_t *e = &tbl[DEVS_ALLOC_PROF_SIZE];
+    unsigned h = site_hash(pc);
+    // linear probing; the table is never cleared so there are no tombstones
+    for (unsigned i = 0; i < DEVS_ALLOC_PROF_SIZE; ++i) {
+        devs_alloc_site_t *p = &tbl[(h + i) & (DEVS_ALLOC_PROF_SIZE - 1)];
+        if (p->count == 0) {
+            p->pc = pc;
+            p->fn_idx = fn_idx;
+            e = p;
+            break;
+        }
+        if (p->pc == pc && p->fn_idx == fn_idx) {
+            e = p;
+            break;
+        }
+    }
+
+    e->count++;
+    e->bytes += size;
+}
+
+unsigned devs_alloc_prof_read(devs_ctx_t *ctx, devs_alloc_site_t *dst, unsigned max) {
+    if (!ctx->alloc_prof)
+        return 0;
+
+    unsigned n = 0;
+    for (unsigned i = 0; i <= DEVS_ALLOC_PROF_SIZE; ++i) {
+        devs_alloc_site_t *e = &ctx->alloc_prof[i];
+        if (e->count == 0)
+            continue;
+        // insertion sort, dropping the smallest entry when full
+        unsigned j = n < max ? n++ : max;
+        while (j > 0 && dst[j - 1].bytes < e->bytes) {
+            if (j < max)
+                dst[j] = dst[j - 1];
+            j--;
+        }
+        if (j < max)
+            dst[j] = *e;
+    }
+    return n;
+}
+
+void devs_alloc_prof_dump(devs_ctx_t *ctx) {
+    devs_alloc_site_t top[16];
+    unsigned n = devs_alloc_prof_read(ctx, top, sizeof(top) / sizeof(top[0]));
+    if (n == 0)
+        return;
+
+    DMESG("alloc profile (top %u sites by bytes):", n);
+    for (unsigned i = 0; i < n; ++i) {
+        devs_alloc_site_t *e = &top[i];
+        if (e->fn_idx == DEVS_ALLOC_PROF_OTHER)
+            DMESG("  (other): %u allocs, %u B", (unsigned)e->count, (unsigned)e->bytes);
+        else if (e->fn_idx == DEVS_ALLOC_PROF_NATIVE)
+            DMESG("  (native): %u allocs, %u B", (unsigned)e->count, (unsigned)e->bytes);
+        else
+            DMESG("  %s_F%d (pc:%d): %u allocs, %u B", devs_img_fun_name(ctx->img, e->fn_idx),
+                  e->fn_idx, (int)(e->pc - devs_img_get_function(ctx->img, e->fn_idx)->start),
+                  (unsigned)e->count, (unsigned)e->bytes);
+    }
+}
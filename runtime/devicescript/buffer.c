@@ -7,6 +7,25 @@ static value_t invalid_numfmt(devs_ctx_t *ctx) {
     return devs_throw_range_error(ctx, "buffer numfmt invalid");
 }
 
+static value_t read_num(const uint8_t *data, uint32_t fmt0) {
+    if (jd_numfmt_is_plain_int(fmt0)) {
+        int32_t q = jd_numfmt_read_i32(data, fmt0);
+        // if it was out of range, it would get clamped
+        if (INT_MIN < q && q < INT_MAX)
+            return devs_value_from_int(q);
+    }
+
+    return devs_value_from_double(jd_numfmt_read_float(data, fmt0));
+}
+
+static void write_num(devs_ctx_t *ctx, uint8_t *data, uint32_t fmt0, value_t v) {
+    if (devs_is_tagged_int(v)) {
+        jd_numfmt_write_i32(data, fmt0, v.val_int32);
+    } else {
+        jd_numfmt_write_float(data, fmt0, devs_value_to_double(ctx, v));
+    }
+}
+
 value_t devs_buffer_op(devs_ctx_t *ctx, uint32_t fmt0, uint32_t offset, value_t buffer,
                        value_t *setv) {
 
@@ -31,23 +50,10 @@ value_t devs_buffer_op(devs_ctx_t *ctx, uint32_t fmt0, uint32_t offset, value_t
 
     if (setv) {
         JD_ASSERT(devs_buffer_is_writable(ctx, buffer));
-        value_t q = *setv;
-        if (devs_is_tagged_int(q)) {
-            jd_numfmt_write_i32(data, fmt0, q.val_int32);
-        } else {
-            jd_numfmt_write_float(data, fmt0, devs_value_to_double(ctx, q));
-        }
-
+        write_num(ctx, data, fmt0, *setv);
         return devs_void;
     } else {
-        if (jd_numfmt_is_plain_int(fmt0)) {
-            int32_t q = jd_numfmt_read_i32(data, fmt0);
-            // if it was out of range, it would get clamped
-            if (INT_MIN < q && q < INT_MAX)
-                return devs_value_from_int(q);
-        }
-
-        return devs_value_from_double(jd_numfmt_read_float(data, fmt0));
+        return read_num(data, fmt0);
     }
 }
 
@@ -76,15 +82,7 @@ value_t devs_buffer_decode(devs_ctx_t *ctx, uint32_t fmt0, uint8_t **buf, unsign
             return devs_undefined;
 
         *buf += sz;
-
-        if (jd_numfmt_is_plain_int(fmt0)) {
-            int32_t q = jd_numfmt_read_i32(data, fmt0);
-            // if it was out of range, it would get clamped
-            if (INT_MIN < q && q < INT_MAX)
-                return devs_value_from_int(q);
-        }
-
-        return devs_value_from_double(jd_numfmt_read_float(data, fmt0));
+        return read_num(data, fmt0);
     }
 
     case DEVS_NUMFMT_SPECIAL_BOOL:
@@ -139,13 +137,8 @@ unsigned devs_buffer_encode(devs_ctx_t *ctx, uint32_t fmt0, uint8_t *data, unsig
         }
 
         unsigned sz = jd_numfmt_bytes(fmt0);
-        if (sz <= len) {
-            if (devs_is_tagged_int(v)) {
-                jd_numfmt_write_i32(data, fmt0, v.val_int32);
-            } else {
-                jd_numfmt_write_float(data, fmt0, devs_value_to_double(ctx, v));
-            }
-        }
+        if (sz <= len)
+            write_num(ctx, data, fmt0, v);
         return sz;
     }
 
@@ -189,3 +182,97 @@ unsigned devs_buffer_encode(devs_ctx_t *ctx, uint32_t fmt0, uint8_t *data, unsig
         return 0;
     }
 }
+
+unsigned devs_numfmt_plain_size(uint32_t fmt0) {
+    if (jd_numfmt_special_idx(fmt0) != -1 || !jd_numfmt_is_valid(fmt0))
+        return 0;
+    return jd_numfmt_bytes(fmt0);
+}
+
+// Formats without a fixed-point shift are handled with one loop per format, instead of
+// dispatching on the format for every value.
+
+#define DECODE_LOOP(T, mkval)                                                                      \
+    for (unsigned i = 0; i < count; ++i) {                                                         \
+        T v;                                                                                       \
+        memcpy(&v, data + i * sizeof(T), sizeof(T));                                               \
+        dst[i] = mkval;                                                                            \
+    }                                                                                              \
+    break
+
+void devs_buffer_decode_many(uint32_t fmt0, const uint8_t *data, unsigned count, value_t *dst) {
+    switch (fmt0) {
+    case DEVS_NUMFMT_U8:
+        DECODE_LOOP(uint8_t, devs_value_from_int(v));
+    case DEVS_NUMFMT_I8:
+        DECODE_LOOP(int8_t, devs_value_from_int(v));
+    case DEVS_NUMFMT_U16:
+        DECODE_LOOP(uint16_t, devs_value_from_int(v));
+    case DEVS_NUMFMT_I16:
+        DECODE_LOOP(int16_t, devs_value_from_int(v));
+    case DEVS_NUMFMT_I32:
+        DECODE_LOOP(int32_t, devs_value_from_int(v));
+    case DEVS_NUMFMT_U32:
+        DECODE_LOOP(uint32_t,
+                    v <= INT32_MAX ? devs_value_from_int(v) : devs_value_from_double(v));
+    case DEVS_NUMFMT_F32:
+        DECODE_LOOP(float, devs_value_from_double(v));
+    case DEVS_NUMFMT_F64:
+        DECODE_LOOP(double, devs_value_from_double(v));
+    default: {
+        unsigned sz = jd_numfmt_bytes(fmt0);
+        for (unsigned i = 0; i < count; ++i)
+            dst[i] = read_num(data + i * sz, fmt0);
+        break;
+    }
+    }
+}
+
+// integers are clamped, like jd_numfmt_write_i32() does
+#define ENCODE_INT_LOOP(T, lo, hi)                                                                 \
+    for (unsigned i = 0; i < count; ++i) {                                                         \
+        value_t q = src[i];                                                                        \
+        if (devs_is_tagged_int(q)) {                                                               \
+            int32_t v = q.val_int32;                                                               \
+            T t = v < (lo) ? (lo) : v > (hi) ? (hi) : v;                                           \
+            memcpy(data + i * sizeof(T), &t, sizeof(T));                                           \
+        } else {                                                                                   \
+            jd_numfmt_write_float(data + i * sizeof(T), fmt0, devs_value_to_double(ctx, q));       \
+        }                                                                                          \
+    }                                                                                              \
+    break
+
+#define ENCODE_FLOAT_LOOP(T)                                                                       \
+    for (unsigned i = 0; i < count; ++i) {                                                         \
+        T v = devs_value_to_double(ctx, src[i]);                                                   \
+        memcpy(data + i * sizeof(T), &v, sizeof(T));                                               \
+    }                                                                                              \
+    break
+
+void devs_buffer_encode_many(devs_ctx_t *ctx, uint32_t fmt0, uint8_t *data, unsigned count,
+                             const value_t *src) {
+    switch (fmt0) {
+    case DEVS_NUMFMT_U8:
+        ENCODE_INT_LOOP(uint8_t, 0, 0xff);
+    case DEVS_NUMFMT_I8:
+        ENCODE_INT_LOOP(int8_t, -0x80, 0x7f);
+    case DEVS_NUMFMT_U16:
+        ENCODE_INT_LOOP(uint16_t, 0, 0xffff);
+    case DEVS_NUMFMT_I16:
+        ENCODE_INT_LOOP(int16_t, -0x8000, 0x7fff);
+    case DEVS_NUMFMT_U32:
+        ENCODE_INT_LOOP(uint32_t, 0, INT32_MAX);
+    case DEVS_NUMFMT_I32:
+        ENCODE_INT_LOOP(int32_t, INT32_MIN, INT32_MAX);
+    case DEVS_NUMFMT_F32:
+        ENCODE_FLOAT_LOOP(float);
+    case DEVS_NUMFMT_F64:
+        ENCODE_FLOAT_LOOP(double);
+    default: {
+        unsigned sz = jd_numfmt_bytes(fmt0);
+        for (unsigned i = 0; i < count; ++i)
+            write_num(ctx, data + i * sz, fmt0, src[i]);
+        break;
+    }
+    }
+}
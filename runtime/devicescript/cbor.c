@@ -0,0 +1,514 @@
+#include "devs_internal.h"
+#include <math.h>
+
+// CBOR (RFC 8949) encoding of program values.
+// Objects become maps with string keys, Buffers byte strings; like JSON, functions (and
+// undefined fields) are left out. Numbers use the shortest of integer, float32 and float64
+// that represents them exactly.
+
+#define LOG_TAG "CBOR"
+#include "devs_logging.h"
+
+#define MT_UINT 0
+#define MT_NEGINT 1
+#define MT_BYTES 2
+#define MT_TEXT 3
+#define MT_ARRAY 4
+#define MT_MAP 5
+#define MT_TAG 6
+#define MT_SIMPLE 7
+
+#define SIMPLE_FALSE 20
+#define SIMPLE_TRUE 21
+#define SIMPLE_NULL 22
+#define SIMPLE_UNDEFINED 23
+#define AI_FLOAT16 25
+#define AI_FLOAT32 26
+#define AI_FLOAT64 27
+#define AI_INDEFINITE 31
+#define CBOR_BREAK 0xff
+
+// nesting limit for decoding, to bound native stack use on untrusted input
+#define CBOR_MAX_DEPTH 64
+// initial size of the output buffer; it is doubled as needed
+#define CBOR_INITIAL_SIZE 64
+
+typedef struct {
+    devs_ctx_t *ctx;
+    devs_buffer_t *buf; // output; buf->length is the capacity until the end
+    unsigned size;      // bytes of buf used
+    unsigned buf_root;  // the roots[] slot keeping buf alive
+    bool error;
+    // objects currently being encoded are pushed since this root scope
+    unsigned scope;
+} encoder_t;
+
+static bool grow(encoder_t *enc, unsigned sz) {
+    unsigned cap = enc->buf->length * 2;
+    while (cap < enc->size + sz)
+        cap *= 2;
+    if (cap > DEVS_MAX_ALLOC)
+        cap = enc->size + sz;
+    // throws when too big
+    devs_buffer_t *nbuf = devs_buffer_try_alloc(enc->ctx, cap);
+    if (!nbuf)
+        return false;
+    memcpy(nbuf->data, enc->buf->data, enc->size);
+    enc->buf = nbuf;
+    enc->ctx->roots[enc->buf_root] = devs_value_from_gc_obj(enc->ctx, nbuf);
+    return true;
+}
+
+static void put_bytes(encoder_t *enc, const void *data, unsigned sz) {
+    if (enc->size + sz > enc->buf->length && !grow(enc, sz))
+        return;
+    memcpy(enc->buf->data + enc->size, data, sz);
+    enc->size += sz;
+}
+
+static void put_head(encoder_t *enc, unsigned major, uint64_t v) {
+    uint8_t buf[9];
+    unsigned n;
+    if (v < 24) {
+        buf[0] = (major << 5) | v;
+        n = 1;
+    } else {
+        unsigned sz = v <= 0xff ? 1 : v <= 0xffff ? 2 : v <= 0xffffffff ? 4 : 8;
+        buf[0] = (major << 5) | (24 + (sz == 1 ? 0 : sz == 2 ? 1 : sz == 4 ? 2 : 3));
+        for (unsigned i = 0; i < sz; ++i)
+            buf[sz - i] = (uint8_t)(v >> (8 * i));
+        n = sz + 1;
+    }
+    put_bytes(enc, buf, n);
+}
+
+static void put_float(encoder_t *enc, double d) {
+    uint8_t buf[9];
+    unsigned sz;
+    float f = (float)d;
+    if (isnan(d) || (double)f == d) {
+        uint32_t u;
+        memcpy(&u, &f, 4);
+        buf[0] = (MT_SIMPLE << 5) | AI_FLOAT32;
+        for (unsigned i = 0; i < 4; ++i)
+            buf[4 - i] = (uint8_t)(u >> (8 * i));
+        sz = 5;
+    } else {
+        uint64_t u;
+        memcpy(&u, &d, 8);
+        buf[0] = (MT_SIMPLE << 5) | AI_FLOAT64;
+        for (unsigned i = 0; i < 8; ++i)
+            buf[8 - i] = (uint8_t)(u >> (8 * i));
+        sz = 9;
+    }
+    put_bytes(enc, buf, sz);
+}
+
+static void put_number(encoder_t *enc, value_t v) {
+    if (devs_is_tagged_int(v)) {
+        int32_t i = v.val_int32;
+        if (i < 0)
+            put_head(enc, MT_NEGINT, (uint64_t)(-1 - (int64_t)i));
+        else
+            put_head(enc, MT_UINT, i);
+        return;
+    }
+
+    double d = devs_value_to_double(enc->ctx, v);
+    // integers up to 2^53 are exact in both representations
+    if (d == floor(d) && fabs(d) <= 9007199254740992.0 && !(d == 0 && signbit(d))) {
+        if (d < 0)
+            put_head(enc, MT_NEGINT, (uint64_t)(-1 - (int64_t)d));
+        else
+            put_head(enc, MT_UINT, (uint64_t)d);
+    } else {
+        put_float(enc, d);
+    }
+}
+
+static bool skip_field(devs_ctx_t *ctx, value_t v) {
+    switch (devs_value_typeof(ctx, v)) {
+    case DEVS_OBJECT_TYPE_FUNCTION:
+    case DEVS_OBJECT_TYPE_UNDEFINED:
+    case DEVS_OBJECT_TYPE_EXOTIC:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static void encode_value(encoder_t *enc, value_t v);
+
+static void count_field(devs_ctx_t *ctx, void *state, value_t k, value_t v) {
+    if (devs_is_string(ctx, k) && !skip_field(ctx, v))
+        (*(unsigned *)state)++;
+}
+
+static void encode_field(devs_ctx_t *ctx, void *state, value_t k, value_t v) {
+    encoder_t *enc = state;
+    if (devs_is_string(ctx, k) && !skip_field(ctx, v)) {
+        encode_value(enc, k);
+        encode_value(enc, v);
+    }
+}
+
+static void encode_value(encoder_t *enc, value_t v) {
+    devs_ctx_t *ctx = enc->ctx;
+
+    if (enc->error || ctx->error_code)
+        return;
+
+    switch (devs_value_typeof(ctx, v)) {
+    case DEVS_OBJECT_TYPE_NUMBER:
+        put_number(enc, v);
+        return;
+    case DEVS_OBJECT_TYPE_BOOL:
+        put_head(enc, MT_SIMPLE, devs_value_to_bool(ctx, v) ? SIMPLE_TRUE : SIMPLE_FALSE);
+        return;
+    case DEVS_OBJECT_TYPE_NULL:
+        put_head(enc, MT_SIMPLE, SIMPLE_NULL);
+        return;
+    case DEVS_OBJECT_TYPE_UNDEFINED:
+    case DEVS_OBJECT_TYPE_FUNCTION:
+    case DEVS_OBJECT_TYPE_EXOTIC:
+        put_head(enc, MT_SIMPLE, SIMPLE_UNDEFINED);
+        return;
+    case DEVS_OBJECT_TYPE_STRING:
+    case DEVS_OBJECT_TYPE_BUFFER: {
+        unsigned sz;
+        const void *data = devs_bufferish_data(ctx, v, &sz);
+        put_head(enc, devs_is_buffer(ctx, v) ? MT_BYTES : MT_TEXT, sz);
+        // the value is reachable from the root, and objects don't move during a native call
+        put_bytes(enc, data, sz);
+        return;
+    }
+    }
+
+    if (devs_root_in_scope(ctx, enc->scope, v)) {
+        enc->error = true;
+        return;
+    }
+
+    unsigned scope = devs_root_scope(ctx);
+    devs_root_push(ctx, v);
+
+    if (devs_is_array(ctx, v)) {
+        devs_array_t *arr = devs_value_to_gc_obj(ctx, v);
+        put_head(enc, MT_ARRAY, arr->length);
+        for (unsigned i = 0; i < arr->length; ++i)
+            encode_value(enc, arr->data[i]);
+    } else {
+        devs_maplike_t *map = devs_object_get_attached_enum(ctx, v);
+        unsigned num_fields = 0;
+        if (map)
+            devs_maplike_iter(ctx, map, &num_fields, count_field);
+        put_head(enc, MT_MAP, num_fields);
+        if (map)
+            devs_maplike_iter(ctx, map, enc, encode_field);
+    }
+
+    devs_root_pop(ctx, scope);
+}
+
+value_t devs_cbor_encode(devs_ctx_t *ctx, value_t v) {
+    unsigned scope = devs_root_scope(ctx);
+    devs_buffer_t *buf = devs_buffer_try_alloc(ctx, CBOR_INITIAL_SIZE);
+    if (!buf)
+        return devs_undefined;
+    devs_root_push(ctx, devs_value_from_gc_obj(ctx, buf));
+
+    encoder_t enc = {
+        .ctx = ctx,
+        .buf = buf,
+        .buf_root = scope,
+        .scope = devs_root_scope(ctx),
+    };
+    encode_value(&enc, v);
+    devs_root_pop(ctx, scope);
+
+    if (enc.error)
+        devs_throw_type_error(ctx, "Converting circular structure to CBOR");
+    if (enc.error || ctx->error_code)
+        return devs_undefined;
+
+    // the result is the output buffer itself, with the unused end given back to the heap
+    devs_buffer_shrink(ctx, enc.buf, enc.size);
+    return devs_value_from_gc_obj(ctx, enc.buf);
+}
+
+typedef struct {
+    devs_ctx_t *ctx;
+    const uint8_t *ptr0;
+    const uint8_t *ptr;
+    const uint8_t *end;
+    unsigned depth;
+    bool error;
+} decoder_t;
+
+static value_t error(decoder_t *dec) {
+    dec->error = true;
+    return devs_undefined;
+}
+
+// reads the head of the next item; returns the additional info, or -1 on error
+static int get_head(decoder_t *dec, unsigned *major, uint64_t *arg) {
+    if (dec->ptr >= dec->end)
+        return -1;
+    uint8_t b = *dec->ptr++;
+    unsigned ai = b & 0x1f;
+    *major = b >> 5;
+    if (ai < 24) {
+        *arg = ai;
+    } else if (ai < 28) {
+        unsigned sz = 1 << (ai - 24);
+        if ((unsigned)(dec->end - dec->ptr) < sz)
+            return -1;
+        uint64_t v = 0;
+        for (unsigned i = 0; i < sz; ++i)
+            v = (v << 8) | *dec->ptr++;
+        *arg = v;
+    } else if (ai == AI_INDEFINITE && *major != MT_UINT && *major != MT_NEGINT &&
+               *major != MT_TAG) {
+        *arg = 0;
+    } else {
+        return -1;
+    }
+    return ai;
+}
+
+static double half_to_double(unsigned h) {
+    unsigned exp = (h >> 10) & 0x1f;
+    unsigned mant = h & 0x3ff;
+    double v;
+    if (exp == 0)
+        v = ldexp(mant, -24);
+    else if (exp != 31)
+        v = ldexp(mant + 1024, exp - 25);
+    else
+        v = mant == 0 ? INFINITY : NAN;
+    return h & 0x8000 ? -v : v;
+}
+
+static value_t decode_value(decoder_t *dec);
+
+// byte or text string, possibly split into definite-length chunks
+static value_t decode_string(decoder_t *dec, unsigned major, int ai, uint64_t len) {
+    devs_ctx_t *ctx = dec->ctx;
+
+    if (ai != AI_INDEFINITE) {
+        if (len > (uint64_t)(dec->end - dec->ptr))
+            return error(dec);
+        const uint8_t *p = dec->ptr;
+        dec->ptr += len;
+        if (major == MT_BYTES)
+            return devs_value_from_gc_obj(ctx, devs_buffer_try_alloc_init(ctx, p, len));
+        if (len == 0)
+            return devs_builtin_string(DEVS_BUILTIN_STRING__EMPTY);
+        return devs_string_from_utf8(ctx, p, len);
+    }
+
+    devs_strbuild_t sb;
+    devs_strbuild_init(ctx, &sb);
+    for (;;) {
+        if (dec->ptr < dec->end && *dec->ptr == CBOR_BREAK) {
+            dec->ptr++;
+            break;
+        }
+        unsigned cmajor;
+        uint64_t clen;
+        int cai = get_head(dec, &cmajor, &clen);
+        if (cai < 0 || cai == AI_INDEFINITE || cmajor != major ||
+            clen > (uint64_t)(dec->end - dec->ptr)) {
+            devs_strbuild_free(&sb);
+            return error(dec);
+        }
+        char *dst = devs_strbuild_reserve(&sb, clen);
+        if (dst == NULL) {
+            devs_strbuild_free(&sb);
+            return error(dec);
+        }
+        memcpy(dst, dec->ptr, clen);
+        devs_strbuild_commit(&sb, clen, 0);
+        dec->ptr += clen;
+    }
+
+    value_t r = devs_undefined;
+    if (!sb.error) {
+        if (major == MT_BYTES)
+            r = devs_value_from_gc_obj(ctx, devs_buffer_try_alloc_init(ctx, sb.data, sb.size));
+        else
+            r = devs_string_from_utf8(ctx, (const uint8_t *)sb.data, sb.size);
+    }
+    devs_strbuild_free(&sb);
+    return r;
+}
+
+static bool at_break(decoder_t *dec) {
+    if (dec->ptr < dec->end && *dec->ptr == CBOR_BREAK) {
+        dec->ptr++;
+        return true;
+    }
+    return false;
+}
+
+static value_t decode_array(decoder_t *dec, int ai, uint64_t len) {
+    devs_ctx_t *ctx = dec->ctx;
+    bool indef = ai == AI_INDEFINITE;
+    // each element takes at least a byte, which bounds the allocation
+    if (!indef && len > (uint64_t)(dec->end - dec->ptr))
+        return error(dec);
+
+    devs_array_t *arr = devs_array_try_alloc(ctx, indef ? 0 : len);
+    if (arr == NULL)
+        return error(dec);
+    value_t ret = devs_value_from_gc_obj(ctx, arr);
+    unsigned scope = devs_root_scope(ctx);
+    devs_root_push(ctx, ret);
+
+    for (unsigned i = 0; indef || i < len; ++i) {
+        if (indef && at_break(dec))
+            break;
+        value_t e = decode_value(dec);
+        if (dec->error)
+            break;
+        if (indef)
+            devs_array_pin_push(ctx, arr, e);
+        else
+            arr->data[i] = e;
+    }
+
+    devs_root_pop(ctx, scope);
+    return ret;
+}
+
+static value_t decode_map(decoder_t *dec, int ai, uint64_t len) {
+    devs_ctx_t *ctx = dec->ctx;
+    bool indef = ai == AI_INDEFINITE;
+    if (!indef && len > (uint64_t)(dec->end - dec->ptr) / 2)
+        return error(dec);
+
+    devs_map_t *map = devs_map_try_alloc(ctx, NULL);
+    if (map == NULL)
+        return error(dec);
+    value_t ret = devs_value_from_gc_obj(ctx, map);
+    unsigned scope = devs_root_scope(ctx);
+    devs_root_push(ctx, ret);
+
+    for (unsigned i = 0; indef || i < len; ++i) {
+        if (indef && at_break(dec))
+            break;
+        unsigned key_scope = devs_root_scope(ctx);
+        value_t key = devs_root_push(ctx, decode_value(dec));
+        if (dec->error)
+            break;
+        if (!devs_is_string(ctx, key))
+            key = devs_root_push(ctx, devs_value_to_string(ctx, key));
+        value_t val = devs_root_push(ctx, decode_value(dec));
+        if (!dec->error)
+            devs_map_set(ctx, map, key, val);
+        devs_root_pop(ctx, key_scope);
+        if (dec->error)
+            break;
+    }
+
+    devs_root_pop(ctx, scope);
+    return ret;
+}
+
+static value_t decode_simple(decoder_t *dec, int ai, uint64_t arg) {
+    switch (ai) {
+    case SIMPLE_FALSE:
+        return devs_false;
+    case SIMPLE_TRUE:
+        return devs_true;
+    case SIMPLE_NULL:
+        return devs_null;
+    case SIMPLE_UNDEFINED:
+        return devs_undefined;
+    case AI_FLOAT16:
+        return devs_value_from_double(half_to_double(arg));
+    case AI_FLOAT32: {
+        uint32_t u = arg;
+        float f;
+        memcpy(&f, &u, 4);
+        return devs_value_from_double(f);
+    }
+    case AI_FLOAT64: {
+        double d;
+        memcpy(&d, &arg, 8);
+        return devs_value_from_double(d);
+    }
+    default:
+        // other simple values, and a misplaced break
+        return error(dec);
+    }
+}
+
+static value_t decode_value(decoder_t *dec) {
+    if (dec->error)
+        return devs_undefined;
+    if (dec->ctx->error_code)
+        return error(dec);
+    if (++dec->depth > CBOR_MAX_DEPTH)
+        return error(dec);
+
+    unsigned major;
+    uint64_t arg;
+    int ai = get_head(dec, &major, &arg);
+    value_t r;
+
+    if (ai < 0) {
+        r = error(dec);
+    } else {
+        switch (major) {
+        case MT_UINT:
+            r = arg <= INT32_MAX ? devs_value_from_int(arg) : devs_value_from_double(arg);
+            break;
+        case MT_NEGINT:
+            r = arg <= INT32_MAX ? devs_value_from_int(-1 - (int32_t)arg)
+                                 : devs_value_from_double(-1.0 - (double)arg);
+            break;
+        case MT_BYTES:
+        case MT_TEXT:
+            r = decode_string(dec, major, ai, arg);
+            break;
+        case MT_ARRAY:
+            r = decode_array(dec, ai, arg);
+            break;
+        case MT_MAP:
+            r = decode_map(dec, ai, arg);
+            break;
+        case MT_TAG:
+            // tags (dates, bignums, ...) are ignored, the tagged item is returned as is
+            r = decode_value(dec);
+            break;
+        default:
+            r = decode_simple(dec, ai, arg);
+            break;
+        }
+    }
+
+    dec->depth--;
+    return r;
+}
+
+value_t devs_cbor_decode(devs_ctx_t *ctx, const uint8_t *data, unsigned size) {
+    decoder_t dec = {
+        .ctx = ctx,
+        .ptr0 = data,
+        .ptr = data,
+        .end = data + size,
+    };
+
+    value_t r = decode_value(&dec);
+    if (!dec.error && dec.ptr != dec.end)
+        error(&dec);
+
+    if (dec.error) {
+        if (!ctx->in_throw)
+            devs_throw_syntax_error(ctx, "Invalid CBOR at position %d",
+                                    (int)(dec.ptr - dec.ptr0));
+        return devs_undefined;
+    }
+    return r;
+}
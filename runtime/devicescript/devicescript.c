@@ -13,6 +13,8 @@ static void setup_ctx(devs_ctx_t *ctx, const uint8_t *img) {
     ctx->img.data = img;
     ctx->ctx_seq_no = ++ctx_seq_no;
 
+    devs_alloc_prof_init(ctx);
+    devs_regcache_init(&ctx->regcache, ctx->cfg.regcache_size);
     ctx->gc = devs_gc_create();
 
     ctx->globals = devs_try_alloc(ctx, sizeof(value_t) * ctx->img.header->num_globals);
@@ -84,6 +86,8 @@ static void devs_enter(devs_ctx_t *ctx) {
 static void devs_leave(devs_ctx_t *ctx) {
     JD_ASSERT((ctx->flags & DEVS_CTX_FLAG_BUSY) != 0);
     ctx->flags &= ~DEVS_CTX_FLAG_BUSY;
+    // no native code is running anymore, so every handle scope must have been popped
+    JD_ASSERT(ctx->num_roots == 0);
 }
 
 unsigned devs_error_code(devs_ctx_t *ctx, unsigned *pc) {
@@ -144,6 +148,7 @@ void devs_client_event_handler(devs_ctx_t *ctx, int event_id, void *arg0, void *
         break;
     case JD_CLIENT_EV_PROCESS:
         devs_fiber_poke(ctx);
+        devs_gc_compact_if_needed(ctx);
         break;
     }
 
@@ -160,19 +165,22 @@ static void clear_ctx(devs_ctx_t *ctx) {
     devs_jd_free_roles(ctx);
     devs_vm_clear_breakpoints(ctx);
     devs_enter(ctx);
-    devs_regcache_free_all(&ctx->regcache);
+    devs_regcache_destroy(&ctx->regcache);
     devs_fiber_free_all_fibers(ctx);
     devs_free(ctx, ctx->globals);
     for (unsigned i = 0; i < ctx->num_roles; ++i)
         devs_free(ctx, ctx->roles[i]);
     devs_free(ctx, ctx->roles);
     devs_gc_destroy(ctx->gc);
+    devs_alloc_prof_free(ctx);
     memset(ctx, 0, sizeof(*ctx));
 }
 
 void devs_restart(devs_ctx_t *ctx) {
     const uint8_t *img = ctx->img.data;
+    devs_cfg_t cfg = ctx->cfg;
     clear_ctx(ctx);
+    ctx->cfg = cfg;
     setup_ctx(ctx, img);
 }
 
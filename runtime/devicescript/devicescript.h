@@ -18,6 +18,7 @@ typedef struct devs_ctx devs_ctx_t;
 
 typedef struct {
     uint8_t mgr_service_idx;
+    uint16_t regcache_size; // number of register cache entries; 0 for default
 } devs_cfg_t;
 
 int devs_verify(const uint8_t *img, uint32_t size);
@@ -33,11 +34,58 @@ void devs_panic_handler(int exitcode);
 void devs_deploy_handler(int exitcode);
 
 #define DEVS_FLAG_GC_STRESS (1U << 0)
+#define DEVS_FLAG_GC_COMPACT (1U << 1)
+#define DEVS_FLAG_ALLOC_PROFILE (1U << 2)
 
 void devs_set_global_flags(uint32_t global_flags);
 void devs_reset_global_flags(uint32_t global_flags);
 uint32_t devs_get_global_flags(void);
 
+// bucket i counts GC phases that took less than (16 << 2*i) us; the last one counts the rest
+#define DEVS_GC_TIME_BUCKETS 8
+#define DEVS_GC_NUM_TAGS 32
+
+// all fields are u32; the summary, up to DEVS_GC_STATS_SUMMARY_SIZE, is sent as-is over Jacdac
+// (the per-tag counters don't fit in a single packet)
+typedef struct {
+    uint32_t num_gc;
+    uint32_t live_bytes; // after last GC
+    // current state of the free list
+    uint32_t free_bytes;
+    uint32_t free_blocks;
+    uint32_t max_free_block;
+    uint32_t mark_time[DEVS_GC_TIME_BUCKETS];
+    uint32_t sweep_time[DEVS_GC_TIME_BUCKETS];
+    uint32_t last_mark_time; // in us
+    // indexed by DEVS_GC_TAG_*
+    uint32_t num_alloc[DEVS_GC_NUM_TAGS];
+    uint32_t alloc_bytes[DEVS_GC_NUM_TAGS];
+} devs_gc_stats_t;
+#define DEVS_GC_STATS_SUMMARY_SIZE offsetof(devs_gc_stats_t, num_alloc)
+const devs_gc_stats_t *devs_get_gc_stats(devs_ctx_t *ctx);
+
+// Implemented by the host when JD_GC_ELASTIC is set on 64-bit builds.
+// Returns address space for the whole heap; pages should only be committed when touched.
+void *devs_gc_host_reserve(unsigned size);
+void devs_gc_host_release(void *ptr);
+
+// Implemented by the host when JD_GC_PARALLEL is set.
+// run_workers() calls fn(arg, 0) ... fn(arg, n - 1) concurrently and waits for all of them;
+// n is at most num_workers(), and fn(arg, 0) may run on the calling thread.
+unsigned devs_gc_host_num_workers(void);
+void devs_gc_host_run_workers(unsigned n, void (*fn)(void *arg, unsigned idx), void *arg);
+// wait() blocks a worker until ready(arg) is true; it is re-checked after each wake_workers()
+void devs_gc_host_wait(bool (*ready)(void *arg), void *arg);
+void devs_gc_host_wake_workers(void);
+
+// Heap snapshot in Chrome DevTools .heapsnapshot format, generated in pieces.
+// The program must not run between start() and free().
+typedef struct devs_heapsnap devs_heapsnap_t;
+devs_heapsnap_t *devs_heapsnap_start(devs_ctx_t *ctx);
+// returns number of bytes written to dst; 0 at the end, negative if the heap changed since start()
+int devs_heapsnap_read(devs_heapsnap_t *snap, void *dst, unsigned size);
+void devs_heapsnap_free(devs_heapsnap_t *snap);
+
 void devs_gpio_init_dcfg(devs_ctx_t *ctx);
 
 // General utils
@@ -25,6 +25,9 @@
 #define DEVS_NO_ROLE 0xffff
 
 #define DEVS_MAX_STACK_TRACE_FRAMES 16
+// handle scope slots; recursive natives (JSON, CBOR, inspect) use one or two per nesting level,
+// so this also bounds how deeply nested the values they handle can be
+#define DEVS_MAX_ROOTS 128
 
 typedef struct devs_activation devs_activation_t;
 
@@ -115,6 +118,37 @@ typedef struct {
 // has to be under 0xff
 #define DEVS_BRK_MAX_COUNT 0xf0
 
+// recent int-to-string conversions, see devs_value_to_string(); has to be power of 2
+#define DEVS_INT_STR_CACHE_SIZE 16
+
+// allocation-site profiler; has to be power of 2
+#define DEVS_ALLOC_PROF_SIZE 64
+// fn_idx for allocations outside of bytecode, and for the catch-all entry when the table is full
+#define DEVS_ALLOC_PROF_NATIVE 0xfffe
+#define DEVS_ALLOC_PROF_OTHER 0xffff
+typedef struct {
+    devs_pc_t pc;
+    uint16_t fn_idx;
+    uint32_t count;
+    uint32_t bytes;
+} devs_alloc_site_t;
+
+// packet decoders compiled from devs_packet_spec_t, see pktdecode.c; has to be power of 2
+#define DEVS_PKT_DECODER_CACHE_SIZE 16
+#define DEVS_PKT_DECODER_MAX_FIELDS 8
+#define DEVS_PKT_DECODER_GENERIC 0 // interpret the field specs
+#define DEVS_PKT_DECODER_SINGLE 1  // one number
+#define DEVS_PKT_DECODER_STRUCT 2  // fixed numeric fields, optionally followed by a repeated one
+typedef struct {
+    const devs_packet_spec_t *spec; // NULL for empty slots
+    uint8_t kind;                   // DEVS_PKT_DECODER_*
+    uint8_t num_fields;
+    uint8_t size; // bytes taken by numfmts[]
+    uint8_t rep_numfmt;
+    uint8_t rep_size; // 0 if there is no repeated field
+    uint8_t numfmts[DEVS_PKT_DECODER_MAX_FIELDS];
+} devs_pkt_decoder_t;
+
 #define DEVS_DBG_BRK_UNHANDLED_EXN 0x01
 #define DEVS_DBG_BRK_HANDLED_EXN 0x02
 
@@ -148,6 +182,10 @@ struct devs_ctx {
     uint32_t literal_int;
     value_t the_stack[DEVS_MAX_STACK_DEPTH];
 
+    // handle scopes; see devs_root_push()
+    value_t roots[DEVS_MAX_ROOTS];
+    uint16_t num_roots;
+
     devs_short_map_t *fn_protos;
     devs_short_map_t *fn_values;
     devs_short_map_t *spec_protos;
@@ -187,6 +225,14 @@ struct devs_ctx {
     uint16_t brk_count;
     uint8_t brk_jump_tbl[DEVS_BRK_HASH_SIZE];
 
+    // DEVS_ALLOC_PROF_SIZE entries, followed by the catch-all one; NULL when not profiling
+    devs_alloc_site_t *alloc_prof;
+
+    int32_t int_str_keys[DEVS_INT_STR_CACHE_SIZE];
+    value_t int_str_vals[DEVS_INT_STR_CACHE_SIZE]; // undefined for empty slots
+
+    devs_pkt_decoder_t pkt_decoders[DEVS_PKT_DECODER_CACHE_SIZE];
+
     uint8_t program_hash[JD_SHA256_HASH_BYTES];
 
     union {
@@ -239,9 +285,83 @@ static inline value_t devs_invalid_program(devs_ctx_t *ctx, unsigned code) {
     return _devs_invalid_program(ctx, code - 60000);
 }
 
+// dtoa.c
+// longest output of devs_dtoa(), with the final NUL
+#define DEVS_DTOA_SIZE 32
+// shortest string that parses back to d, formatted like Number.prototype.toString()
+unsigned devs_dtoa(double d, char *buf);
+unsigned devs_itoa(int32_t v, char *buf);
+
+// strtod.c
+// same as strtod() (str has to be NUL-terminated), but faster on typical decimal input
+double devs_strtod(const char *str, char **endp);
+
+// strbuild.c
+// returns 0 when all size bytes were consumed
+typedef int (*devs_strbuild_sink_t)(void *arg, const char *data, unsigned size);
+
+typedef struct {
+    devs_ctx_t *ctx;
+    char *data;
+    unsigned size;   // in bytes
+    unsigned length; // in code points
+    unsigned capacity;
+    bool error; // allocation failed (exception thrown); further writes are ignored
+    int sink_error;
+    devs_strbuild_sink_t sink;
+    void *sink_arg;
+    char inline_buf[64];
+} devs_strbuild_t;
+
+void devs_strbuild_init(devs_ctx_t *ctx, devs_strbuild_t *sb);
+// data is passed to sink() in chunks of up to chunk_size bytes (inline buffer size when 0),
+// instead of being collected; only a single piece longer than that grows the buffer
+void devs_strbuild_init_sink(devs_ctx_t *ctx, devs_strbuild_t *sb, unsigned chunk_size,
+                             devs_strbuild_sink_t sink, void *arg);
+// passes the remaining data to the sink; returns its error if any, or -1 on allocation error
+int devs_strbuild_flush(devs_strbuild_t *sb);
+// returns space for sz more bytes, to be filled and then committed; NULL on error
+// this may allocate, so any GC data being copied needs to be rooted
+char *devs_strbuild_reserve(devs_strbuild_t *sb, unsigned sz);
+void devs_strbuild_commit(devs_strbuild_t *sb, unsigned sz, unsigned len);
+// s must not point to an unrooted GC object
+void devs_strbuild_add(devs_strbuild_t *sb, const char *s, unsigned sz);
+void devs_strbuild_add_ch(devs_strbuild_t *sb, char c, unsigned rep);
+void devs_strbuild_add_string(devs_strbuild_t *sb, value_t s);
+// appends devs_value_to_string(v)
+void devs_strbuild_add_value(devs_strbuild_t *sb, value_t v);
+// cuts to at most size bytes, at a character boundary
+void devs_strbuild_truncate(devs_strbuild_t *sb, unsigned size);
+// returns the string (undefined on error) and releases the buffer
+value_t devs_strbuild_finish(devs_strbuild_t *sb);
+void devs_strbuild_free(devs_strbuild_t *sb);
+
 // strformat.c
-size_t devs_strformat(devs_ctx_t *ctx, const char *fmt, size_t fmtlen, char *dst, size_t dstlen,
-                      value_t *args, size_t numargs, size_t *ulen);
+void devs_strformat(devs_strbuild_t *sb, const char *fmt, size_t fmtlen, value_t *args,
+                    size_t numargs);
+
+// inspect.c
+// appends at most size bytes (100 when 0); complex values are cut with "..."
+void devs_inspect_to(devs_strbuild_t *sb, value_t v, unsigned size);
+
+// json.c
+void devs_json_escape_to(devs_strbuild_t *sb, const char *str, unsigned sz);
+// writes JSON to sink() in chunks, without building the whole string;
+// returns 0, the sink's error, or -1 when an exception was thrown
+int devs_json_stringify_to(devs_ctx_t *ctx, value_t v, int indent, unsigned chunk_size,
+                           devs_strbuild_sink_t sink, void *arg);
+
+// cbor.c
+// returns a Buffer
+value_t devs_cbor_encode(devs_ctx_t *ctx, value_t v);
+value_t devs_cbor_decode(devs_ctx_t *ctx, const uint8_t *data, unsigned size);
+
+// jsonstream.c
+// a new devs_json_parser_t
+value_t devs_json_parser_alloc(devs_ctx_t *ctx);
+// feeds a chunk (buffer or string, nullish at end of input) to the parser;
+// returns an array of the top-level values completed by it
+value_t devs_json_feed(devs_ctx_t *ctx, value_t parser, value_t chunk);
 
 // jdiface.c
 bool devs_jd_should_run(devs_fiber_t *fiber);
@@ -295,13 +415,33 @@ void devs_vm_halt(devs_ctx_t *ctx);
 int devs_vm_resume(devs_ctx_t *ctx);
 void devs_vm_set_debug(devs_ctx_t *ctx, bool en);
 
+// allocprof.c
+void devs_alloc_prof_init(devs_ctx_t *ctx);
+void devs_alloc_prof_free(devs_ctx_t *ctx);
+void devs_alloc_prof_record(devs_ctx_t *ctx, unsigned size);
+void devs_alloc_prof_dump(devs_ctx_t *ctx);
+// copies non-empty entries, sorted by bytes (descending); returns number of entries
+unsigned devs_alloc_prof_read(devs_ctx_t *ctx, devs_alloc_site_t *dst, unsigned max);
+
 value_t devs_buffer_op(devs_ctx_t *ctx, uint32_t fmt0, uint32_t offset, value_t buffer,
                        value_t *setv);
 double devs_read_number(void *data, unsigned bufsz, uint16_t fmt0);
 value_t devs_buffer_decode(devs_ctx_t *ctx, uint32_t fmt0, uint8_t **buf, unsigned len);
 unsigned devs_buffer_encode(devs_ctx_t *ctx, uint32_t fmt0, uint8_t *data, unsigned len, value_t v);
+// size of a single value of numeric format, or 0 for special and invalid formats
+unsigned devs_numfmt_plain_size(uint32_t fmt0);
+// bulk versions for numeric formats; data has to hold count values
+void devs_buffer_decode_many(uint32_t fmt0, const uint8_t *data, unsigned count, value_t *dst);
+void devs_buffer_encode_many(devs_ctx_t *ctx, uint32_t fmt0, uint8_t *data, unsigned count,
+                             const value_t *src);
 value_t devs_packet_decode(devs_ctx_t *ctx, const devs_packet_spec_t *pkt, uint8_t *dp,
                            unsigned len);
+// interprets the field specs of pkt
+value_t devs_packet_decode_generic(devs_ctx_t *ctx, const devs_packet_spec_t *pkt, uint8_t *dp,
+                                   unsigned len);
+// uses a decoder compiled on first use; returns false if the generic decoder is needed
+bool devs_packet_decode_fast(devs_ctx_t *ctx, const devs_packet_spec_t *pkt, const uint8_t *dp,
+                             unsigned len, value_t *res);
 
 void *devs_try_alloc(devs_ctx_t *ctx, uint32_t size);
 void devs_free(devs_ctx_t *ctx, void *ptr);
@@ -339,11 +479,49 @@ static inline void devs_ret(devs_ctx_t *ctx, value_t v) {
         ctx->curr_fiber->ret_val = v;
 }
 
+/*
+ * Handle scopes - temporary GC roots for native code:
+ *
+ *   unsigned scope = devs_root_scope(ctx);
+ *   a = devs_root_push(ctx, devs_value_to_string(ctx, a));
+ *   ... allocate ...
+ *   devs_root_pop(ctx, scope);
+ *
+ * Everything pushed while executing an opcode is popped when the opcode finishes,
+ * so early returns from builtins do not leak roots.
+ *
+ * There are DEVS_MAX_ROOTS slots, and pushing never allocates. Pushing more panics with
+ * DEVS_PANIC_STACK_OVERFLOW; the value is then not rooted, so recursive code has to stop
+ * once ctx->error_code is set.
+ */
+static inline unsigned devs_root_scope(devs_ctx_t *ctx) {
+    return ctx->num_roots;
+}
+static inline value_t devs_root_push(devs_ctx_t *ctx, value_t v) {
+    if (ctx->num_roots < DEVS_MAX_ROOTS)
+        ctx->roots[ctx->num_roots++] = v;
+    else
+        devs_panic(ctx, DEVS_PANIC_STACK_OVERFLOW);
+    return v;
+}
+static inline void devs_root_pop(devs_ctx_t *ctx, unsigned scope) {
+    JD_ASSERT(scope <= ctx->num_roots);
+    ctx->num_roots = scope;
+}
+// is v pushed since scope?
+bool devs_root_in_scope(devs_ctx_t *ctx, unsigned scope, value_t v);
+
 static inline bool devs_did_yield(devs_ctx_t *ctx) {
     return ctx->curr_fiber == NULL;
 }
 void devs_setup_resume(devs_fiber_t *f, devs_resume_cb_t cb, void *userdata);
 int devs_clamp_size(int v, int max);
+// clamped to [0, sz]; negative indices count from the end
+unsigned devs_rel_index(int idx, unsigned sz);
+// offset of the first (last) occurrence of needle in hay, or -1; the empty needle is found at
+// the start (end) of hay
+int devs_memfind(const void *hay, unsigned size, const void *needle, unsigned nsize);
+int devs_memrfind(const void *hay, unsigned size, const void *needle, unsigned nsize);
 
 static inline devs_role_t *devs_role(devs_ctx_t *ctx, unsigned roleidx) {
     if (roleidx < ctx->num_roles)
@@ -65,6 +65,36 @@ typedef struct {
     uint8_t data[0];
 } devs_buffer_t;
 
+// window into another buffer, sharing its data
+typedef struct {
+    devs_gc_object_t gc; // DEVS_GC_TAG_BUFFER_VIEW
+    devs_small_size_t length;
+    devs_small_size_t offset;
+    value_t parent; // GC or image buffer, never another view
+    devs_map_t *attached;
+} devs_buffer_view_t;
+
+// element kinds of typed arrays; same order as their DEVS_BUILTIN_OBJECT_*s
+#define DEVS_TYPED_ARRAY_INT8 0
+#define DEVS_TYPED_ARRAY_UINT8 1
+#define DEVS_TYPED_ARRAY_INT16 2
+#define DEVS_TYPED_ARRAY_UINT16 3
+#define DEVS_TYPED_ARRAY_INT32 4
+#define DEVS_TYPED_ARRAY_UINT32 5
+#define DEVS_TYPED_ARRAY_FLOAT32 6
+#define DEVS_TYPED_ARRAY_FLOAT64 7
+#define DEVS_TYPED_ARRAY__MAX 7
+
+// Int16Array etc.; numbers stored unboxed in a buffer
+typedef struct {
+    devs_gc_object_t gc;      // DEVS_GC_TAG_TYPED_ARRAY
+    devs_small_size_t length; // in elements
+    devs_small_size_t offset; // in bytes
+    uint8_t kind;             // DEVS_TYPED_ARRAY_*
+    value_t buffer;           // GC or image buffer, never a view
+    devs_map_t *attached;
+} devs_typed_array_t;
+
 // ASCII string, length==size
 typedef struct {
     devs_gc_object_t gc; // DEVS_GC_TAG_STRING
@@ -77,6 +107,16 @@ typedef struct {
     devs_utf8_string_t inner;
 } devs_string_jmp_t;
 
+// result of concatenation; flattened when the contents are first needed
+typedef struct {
+    devs_gc_object_t gc; // DEVS_GC_TAG_STRING_ROPE
+    devs_small_size_t size;
+    devs_small_size_t length;
+    uint8_t depth; // of nested right children; bounds recursion when flattening
+    value_t left;  // after flattening, the flat string
+    value_t right; // after flattening, undefined
+} devs_string_rope_t;
+
 typedef struct {
     devs_gc_object_t gc;
 } devs_any_string_t;
@@ -89,6 +129,14 @@ typedef struct {
     value_t *data;
 } devs_array_t;
 
+// parser from JSON.createParser(); opaque to programs, see jsonstream.c
+typedef struct {
+    devs_gc_object_t gc;  // DEVS_GC_TAG_JSON_PARSER
+    devs_buffer_t *token; // bytes of the current string or number token, if any
+    devs_array_t *stack;  // containers being filled; an object is followed by its pending key
+    uint8_t state[0];     // json_stream_t
+} devs_json_parser_t;
+
 typedef struct {
     devs_gc_object_t gc;
     value_t this_val;
@@ -184,6 +232,15 @@ void devs_packet_encode(devs_ctx_t *ctx, const devs_packet_spec_t *pkt);
 
 devs_packet_t *devs_value_to_packet_or_throw(devs_ctx_t *ctx, value_t self);
 
+// NULL if v is not a typed array
+devs_typed_array_t *devs_value_to_typed_array(devs_ctx_t *ctx, value_t v);
+// undefined when out of range
+value_t devs_typed_array_get(devs_ctx_t *ctx, devs_typed_array_t *arr, unsigned idx);
+// throws when out of range, or when the array is backed by a read-only buffer
+void devs_typed_array_set(devs_ctx_t *ctx, devs_typed_array_t *arr, unsigned idx, value_t v);
+unsigned devs_typed_array_proto_idx(unsigned kind);
+unsigned devs_typed_array_name_idx(unsigned kind);
+
 // GC
 
 typedef struct _devs_gc_t devs_gc_t;
@@ -193,15 +250,29 @@ devs_short_map_t *devs_short_map_try_alloc(devs_ctx_t *ctx);
 devs_array_t *devs_array_try_alloc(devs_ctx_t *ctx, unsigned size);
 devs_buffer_t *devs_buffer_try_alloc_init(devs_ctx_t *ctx, const void *data, unsigned size);
 devs_buffer_t *devs_buffer_try_alloc(devs_ctx_t *ctx, unsigned size);
+// sets the length to size (at most the current one), and frees the memory past it
+void devs_buffer_shrink(devs_ctx_t *ctx, devs_buffer_t *buf, unsigned size);
+// parent has to be a buffer; views of views point at the underlying buffer
+devs_buffer_view_t *devs_buffer_view_try_alloc(devs_ctx_t *ctx, value_t parent, unsigned offset,
+                                               unsigned length);
+// buffer is handled as in devs_buffer_view_try_alloc(); offset is in bytes, length in elements
+devs_typed_array_t *devs_typed_array_try_alloc(devs_ctx_t *ctx, unsigned kind, value_t buffer,
+                                               unsigned offset, unsigned length);
 devs_string_t *devs_string_try_alloc(devs_ctx_t *ctx, unsigned size);
 devs_string_jmp_t *devs_string_jmp_try_alloc(devs_ctx_t *ctx, unsigned size, unsigned length);
 devs_any_string_t *devs_string_try_alloc_init(devs_ctx_t *ctx, const char *str, unsigned size);
-char *devs_string_prep(devs_ctx_t *ctx, value_t *v, unsigned sz, unsigned len);
-void devs_string_finish(devs_ctx_t *ctx, value_t *v, unsigned sz, unsigned len);
+// roots *v until devs_string_finish() is called with the returned *scope
+char *devs_string_prep(devs_ctx_t *ctx, value_t *v, unsigned sz, unsigned len, unsigned *scope);
+// NULL if v is not a rope
+devs_string_rope_t *devs_string_get_rope(devs_ctx_t *ctx, value_t v);
+void devs_string_finish(devs_ctx_t *ctx, value_t *v, unsigned sz, unsigned len, unsigned scope);
 
 int devs_string_length(devs_ctx_t *ctx, value_t s);
 int devs_string_index(devs_ctx_t *ctx, value_t s, unsigned idx);
 int devs_string_jmp_index(const devs_utf8_string_t *dst, unsigned idx);
+// inverse of devs_string_index(); off has to be at a character boundary
+int devs_string_char_index(devs_ctx_t *ctx, value_t s, unsigned off);
+int devs_string_jmp_char_index(const devs_utf8_string_t *dst, unsigned off);
 // assumes valid UTF8 input
 unsigned devs_utf8_code_point_length(const char *data);
 // assumes valid UTF8 input
@@ -229,6 +300,33 @@ void *devs_any_try_alloc(devs_ctx_t *ctx, unsigned tag, unsigned size);
 devs_gc_t *devs_gc_create(void);
 void devs_gc_set_ctx(devs_gc_t *gc, devs_ctx_t *ctx);
 void devs_gc_destroy(devs_gc_t *gc);
+// slide live blocks together; only call when no native code holds pointers to GC objects
+void devs_gc_compact(devs_gc_t *gc);
+// compact if fragmentation was detected and ctx is at a safe point (DEVS_FLAG_GC_COMPACT)
+void devs_gc_compact_if_needed(devs_ctx_t *ctx);
+// run full collection now
+void devs_gc_collect(devs_gc_t *gc);
+
+// heap walking; the heap must not change in between calls
+// first/next return allocated (non-free) blocks in address order, NULL at the end
+void *devs_gc_first_obj(devs_gc_t *gc);
+void *devs_gc_next_obj(devs_gc_t *gc, void *obj);
+bool devs_gc_is_heap_ptr(devs_gc_t *gc, const void *ptr);
+// changes whenever blocks are allocated, freed or moved
+uint32_t devs_gc_heap_version(devs_gc_t *gc);
+
+#define DEVS_GC_ROOT_GLOBALS 0
+#define DEVS_GC_ROOT_STACK 1
+#define DEVS_GC_ROOT_BUILTINS 2
+#define DEVS_GC_ROOT_ROLES 3
+#define DEVS_GC_ROOT_PINS 4
+#define DEVS_GC_ROOT_INTERNAL 5
+#define DEVS_GC_ROOT_FIBERS 6
+#define DEVS_GC_ROOT_SCOPES 7
+#define DEVS_GC_ROOT___MAX 7
+typedef void (*devs_gc_root_cb_t)(devs_ctx_t *ctx, void *userdata, unsigned kind, void *obj);
+// calls cb for every GC object directly referenced from outside of the heap
+void devs_gc_iter_roots(devs_ctx_t *ctx, devs_gc_root_cb_t cb, void *userdata);
 
 #define DEVS_GC_MK_TAG_WORDS(tag, size) ((size) | ((uintptr_t)(tag) << DEVS_GC_TAG_POS))
 #define DEVS_GC_MK_TAG_BYTES(tag, size)                                                            \
@@ -242,7 +340,7 @@ void devs_gc_destroy(devs_gc_t *gc);
 #define DEVS_GC_TAG_MASK_PENDING 0x80
 #define DEVS_GC_TAG_MASK_SCANNED 0x20
 #define DEVS_GC_TAG_MASK_PINNED 0x40
-#define DEVS_GC_TAG_MASK 0xf // 0x1f should be possible
+#define DEVS_GC_TAG_MASK 0x1f
 
 // update devs_gc_tag_name() when adding/reordering
 #define DEVS_GC_TAG_NULL 0x0
@@ -259,6 +357,10 @@ void devs_gc_destroy(devs_gc_t *gc);
 #define DEVS_GC_TAG_PACKET 0xB
 #define DEVS_GC_TAG_STRING_JMP 0xC
 #define DEVS_GC_TAG_IMAGE 0xD
+#define DEVS_GC_TAG_STRING_ROPE 0xE
+#define DEVS_GC_TAG_BUFFER_VIEW 0xF
+#define DEVS_GC_TAG_TYPED_ARRAY 0x10
+#define DEVS_GC_TAG_JSON_PARSER 0x11
 #define DEVS_GC_TAG_BUILTIN_PROTO DEVS_GC_TAG_MASK // these are not in GC heap!
 #define DEVS_GC_TAG_FINAL (DEVS_GC_TAG_MASK | DEVS_GC_TAG_MASK_PINNED)
 
@@ -270,6 +372,8 @@ static inline int devs_gc_tag(const void *ptr) {
 void devs_gc_obj_check(devs_ctx_t *ctx, const void *ptr);
 int devs_dump_heap(devs_ctx_t *ctx, int off, int cnt);
 
+const devs_gc_stats_t *devs_gc_stats(devs_gc_t *gc);
+
 static inline bool devs_is_map(const void *ptr) {
     int t = devs_gc_tag(ptr);
     return t == DEVS_GC_TAG_MAP || t == DEVS_GC_TAG_HALF_STATIC_MAP;
@@ -1,7 +1,7 @@
 #define DEVS_QUERY_MAX_INLINE 9
 typedef struct devs_regcache_entry {
     uint16_t role_idx;
-    uint16_t service_command;
+    uint16_t service_command; // 0 for free entries
     uint32_t last_refresh_time;
     union {
         uint32_t u32;
@@ -10,27 +10,43 @@ typedef struct devs_regcache_entry {
     } value;
     uint8_t resp_size;
     uint16_t argument;
+    // entry indices, DEVS_REGCACHE_NONE at list ends
+    uint16_t lru_prev, lru_next; // towards most and least recently used
+    uint16_t hash_next;
 } devs_regcache_entry_t;
 
-#define DEVS_REGCACHE_NUM_ENTRIES 20
+#define DEVS_REGCACHE_NONE 0xffff
+#define DEVS_REGCACHE_DEFAULT_SIZE 20
+#define DEVS_REGCACHE_MAX_SIZE 1024
 
 typedef struct devs_regcache {
-    devs_regcache_entry_t entries[DEVS_REGCACHE_NUM_ENTRIES];
-    uint16_t latest_idx;
+    devs_regcache_entry_t *entries;
+    // heads of hash chains, indexed by hash of (role_idx, service_command)
+    uint16_t *buckets;
+    uint16_t num_entries;
+    uint16_t num_buckets; // power of 2
+    // all entries are on the LRU list; free ones at the end
+    uint16_t lru_first, lru_last;
+    // reads served from the cache right away, and ones that waited for the bus
+    uint32_t num_hits, num_misses;
 } devs_regcache_t;
 
 static inline void *devs_regcache_data(devs_regcache_entry_t *q) {
     return q->resp_size > DEVS_QUERY_MAX_INLINE ? q->value.buffer : q->value.data;
 }
 
+void devs_regcache_init(devs_regcache_t *cache, unsigned num_entries);
+void devs_regcache_destroy(devs_regcache_t *cache);
 void devs_regcache_free(devs_regcache_t *cache, devs_regcache_entry_t *q);
 devs_regcache_entry_t *devs_regcache_mark_used(devs_regcache_t *cache, devs_regcache_entry_t *q);
 devs_regcache_entry_t *devs_regcache_lookup(devs_regcache_t *cache, unsigned role_idx,
                                             unsigned service_command, unsigned argument);
 devs_regcache_entry_t *devs_regcache_alloc(devs_regcache_t *cache, unsigned role_idx,
-                                           unsigned service_command, unsigned resp_size);
+                                           unsigned service_command, unsigned argument,
+                                           unsigned resp_size);
 void devs_regcache_age(devs_regcache_t *cache, unsigned role_idx, uint32_t min_time);
 void devs_regcache_free_role(devs_regcache_t *cache, unsigned role_idx);
+// entries for role_idx and service_command (with any argument), following prev (or first if NULL)
 devs_regcache_entry_t *devs_regcache_next(devs_regcache_t *cache, unsigned role_idx,
                                           unsigned service_command, devs_regcache_entry_t *prev);
 void devs_regcache_free_all(devs_regcache_t *cache);
@@ -25,4 +25,7 @@ typedef struct {
     devs_pc_t pc;
 } devs_trace_ev_fiber_yield_t;
 
+// a piece of JSON from ds.traceJSON(); each value is ended by a "\n" piece
+#define DEVS_TRACE_EV_JSON 0x48
+
 void devs_trace(devs_ctx_t *ctx, unsigned trace_type, const void *data, unsigned data_size);
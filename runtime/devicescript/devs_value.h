@@ -45,6 +45,7 @@ typedef union {
 #define DEVS_HANDLE_TYPE_IMG_BUFFERISH 0x4
 #define DEVS_HANDLE_TYPE_BOUND_FUNCTION_STATIC 0x5
 #define DEVS_HANDLE_TYPE_ROLE_MEMBER 0x6
+#define DEVS_HANDLE_TYPE_ASCII_CHAR 0x7 // one-character string; value is the character code
 
 #define DEVS_HANDLE_TYPE_GC_OBJECT 0x8 // see devs_handle_type_is_ptr()
 #define DEVS_HANDLE_TYPE_CLOSURE 0x9
@@ -217,11 +218,11 @@ __attribute__((format(printf, 2, 3))) value_t devs_string_sprintf(devs_ctx_t *ct
                                                                   const char *format, ...);
 value_t devs_string_from_utf8(devs_ctx_t *ctx, const uint8_t *utf8, unsigned size);
 value_t devs_builtin_string(unsigned idx);
+// c < 0x80; doesn't allocate
+value_t devs_string_from_ascii_char(unsigned c);
 value_t devs_string_slice(devs_ctx_t *ctx, value_t str, int start, int endp);
-
-void devs_value_pin(devs_ctx_t *ctx, value_t v);
-void devs_value_unpin(devs_ctx_t *ctx, value_t v);
-bool devs_value_is_pinned(devs_ctx_t *ctx, value_t v);
+// <0, 0 or >0, comparing code points; both a and b have to be strings
+int devs_string_cmp(devs_ctx_t *ctx, value_t a, value_t b);
 
 // assumes string is valid utf8; don't run on buffers
 value_t devs_json_parse(devs_ctx_t *ctx, const char *str, unsigned sz, bool do_throw);
@@ -7,6 +7,18 @@
 #define LOG_TAG "dbg"
 #include "devs_logging.h"
 
+// devs_alloc_site_t[]; not (yet) part of the service spec
+#ifndef JD_DEVS_DBG_CMD_READ_ALLOC_PROFILE
+#define JD_DEVS_DBG_CMD_READ_ALLOC_PROFILE 0xa0
+#endif
+
+// bytes of .heapsnapshot JSON; only when suspended
+#ifndef JD_DEVS_DBG_CMD_READ_HEAP_SNAPSHOT
+#define JD_DEVS_DBG_CMD_READ_HEAP_SNAPSHOT 0xa1
+#endif
+
+#define HEAPSNAP_CHUNK 200
+
 struct srv_state {
     SRV_COMMON;
     uint8_t enabled;
@@ -20,6 +32,8 @@ struct srv_state {
     uint16_t pipe_curr_elt;
     void *pipe_data;
     jd_opipe_desc_t results_pipe;
+    // if set, pipe_data is refilled from here
+    devs_heapsnap_t *snap;
 };
 static srv_t *_state;
 
@@ -42,6 +56,8 @@ static void devsdbg_stop_pipe(srv_t *state) {
     state->pipe_cmd = 0;
     jd_free(state->pipe_data);
     state->pipe_data = NULL;
+    devs_heapsnap_free(state->snap);
+    state->snap = NULL;
 }
 
 static void devsdbg_pipe_alloc(srv_t *state, unsigned elt_size, unsigned num_elts) {
@@ -64,18 +80,32 @@ typedef struct {
     devs_ctx_t *ctx;
 } cmd_t;
 
-static void *devsdbg_open_results_pipe(cmd_t *cmd, unsigned elt_size, unsigned num_elts) {
+static void *devsdbg_open_pipe(cmd_t *cmd, unsigned elt_size, unsigned num_elts) {
     srv_t *state = cmd->state;
-    if (!state->enabled || !state->suspended)
-        num_elts = 0;
     devsdbg_pipe_alloc(state, elt_size, num_elts);
     jd_opipe_open_cmd(&state->results_pipe, cmd->pkt);
     state->pipe_cmd = cmd->pkt->service_command;
     return state->pipe_data;
 }
 
+static void *devsdbg_open_results_pipe(cmd_t *cmd, unsigned elt_size, unsigned num_elts) {
+    srv_t *state = cmd->state;
+    if (!state->enabled || !state->suspended)
+        num_elts = 0;
+    return devsdbg_open_pipe(cmd, elt_size, num_elts);
+}
+
 void devsdbg_process(srv_t *state) {
     while (state->pipe_cmd) {
+        if (state->snap && state->pipe_curr_elt >= state->pipe_num_elts) {
+            // the snapshot is only valid as long as the program doesn't run
+            int n = -1;
+            if (state->suspended)
+                n = devs_heapsnap_read(state->snap, state->pipe_data, HEAPSNAP_CHUNK);
+            // on error the snapshot is cut short, which the client sees as invalid JSON
+            state->pipe_num_elts = n < 0 ? 0 : n;
+            state->pipe_curr_elt = 0;
+        }
         if (state->pipe_curr_elt >= state->pipe_num_elts)
             devsdbg_stop_pipe(state);
         else {
@@ -189,6 +219,12 @@ static void expand_value(devs_ctx_t *ctx, jd_devs_dbg_value_t *trg, value_t v) {
         trg->tag = JD_DEVS_DBG_VALUE_TAG_IMG_ROLE_MEMBER;
         trg->v0 = hv;
         return;
+
+    case DEVS_HANDLE_TYPE_ASCII_CHAR:
+        // no debugger tag for these yet
+        trg->tag = JD_DEVS_DBG_VALUE_TAG_EXOTIC;
+        memcpy(&trg->v0, &v, 8);
+        return;
     }
 
     switch (devs_value_typeof(ctx, v)) {
@@ -247,11 +283,12 @@ static void expand_value(devs_ctx_t *ctx, jd_devs_dbg_value_t *trg, value_t v) {
         break;
 
     case DEVS_OBJECT_TYPE_BUFFER: {
-        devs_buffer_t *b = devs_handle_ptr_value(ctx, v);
-        JD_ASSERT(devs_gc_tag(b) == DEVS_GC_TAG_BUFFER);
+        JD_ASSERT(devs_handle_type(v) == DEVS_HANDLE_TYPE_GC_OBJECT);
+        unsigned sz;
+        devs_buffer_data(ctx, v, &sz);
         trg->tag = JD_DEVS_DBG_VALUE_TAG_OBJ_BUFFER;
         trg->v0 = hv;
-        trg->v1 = b->length | HAS_NAMED;
+        trg->v1 = sz | HAS_NAMED;
         break;
     }
 
@@ -612,6 +649,7 @@ void devsdbg_handle_packet(srv_t *state, jd_packet_t *pkt) {
         case JD_DEVS_DBG_CMD_READ_STACK:
         case JD_DEVS_DBG_CMD_READ_INDEXED_VALUES:
         case JD_DEVS_DBG_CMD_READ_NAMED_VALUES:
+        case JD_DEVS_DBG_CMD_READ_HEAP_SNAPSHOT:
             send_empty(cmd);
             return;
 
@@ -670,6 +708,28 @@ void devsdbg_handle_packet(srv_t *state, jd_packet_t *pkt) {
         break;
     }
 
+    case JD_DEVS_DBG_CMD_READ_ALLOC_PROFILE: {
+        // unlike other reads, this works while the program is running
+        unsigned max = ctx && ctx->alloc_prof ? DEVS_ALLOC_PROF_SIZE + 1 : 0;
+        devs_alloc_site_t *data = devsdbg_open_pipe(cmd, sizeof(devs_alloc_site_t), max);
+        if (data) {
+            unsigned num = devs_alloc_prof_read(ctx, data, max);
+            for (unsigned i = 0; i < num; ++i)
+                if (data[i].fn_idx < DEVS_ALLOC_PROF_NATIVE)
+                    data[i].fn_idx = map_fn_idx(data[i].fn_idx);
+            state->pipe_num_elts = num;
+        }
+        break;
+    }
+
+    case JD_DEVS_DBG_CMD_READ_HEAP_SNAPSHOT:
+        // the JSON is generated as it's sent, see devsdbg_process()
+        if (devsdbg_open_results_pipe(cmd, 1, HEAPSNAP_CHUNK)) {
+            state->snap = devs_heapsnap_start(ctx);
+            state->pipe_num_elts = 0;
+        }
+        break;
+
     case JD_DEVS_DBG_CMD_READ_INDEXED_VALUES:
         read_indexed(cmd);
         break;
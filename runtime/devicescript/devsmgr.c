@@ -14,6 +14,17 @@
 
 #define DEVSMGR_ALIGN 32
 
+// number of register cache entries; 0 for DEVS_REGCACHE_DEFAULT_SIZE
+#ifndef JD_REGCACHE_SIZE
+#define JD_REGCACHE_SIZE 0
+#endif
+
+// summary part of devs_gc_stats_t; not (yet) part of the service spec
+#ifndef JD_DEVICE_SCRIPT_MANAGER_REG_GC_STATS
+#define JD_DEVICE_SCRIPT_MANAGER_REG_GC_STATS 0x190
+#endif
+STATIC_ASSERT(DEVS_GC_STATS_SUMMARY_SIZE <= JD_SERIAL_PAYLOAD_SIZE);
+
 #define DEVSMGR_PROG_MAGIC0 0x8d8abd53
 #define DEVSMGR_PROG_MAGIC1 0xb27c4b2b
 
@@ -106,7 +117,8 @@ __attribute__((weak)) void devsdbg_restarted(devs_ctx_t *ctx) {}
 static void run_img(srv_t *state, const void *img, unsigned size) {
     if (state->ctx)
         devs_free_ctx(state->ctx);
-    devs_cfg_t cfg = {.mgr_service_idx = state->service_index};
+    devs_cfg_t cfg = {.mgr_service_idx = state->service_index,
+                      .regcache_size = JD_REGCACHE_SIZE};
     state->ctx = devs_create_ctx(img, size, &cfg);
     if (state->ctx) {
         if (img != devs_empty_program) {
@@ -390,6 +402,14 @@ void devsmgr_handle_packet(srv_t *state, jd_packet_t *pkt) {
         jd_respond_u32(pkt, DEVS_IMG_VERSION);
         break;
 
+    case JD_GET(JD_DEVICE_SCRIPT_MANAGER_REG_GC_STATS):
+        if (state->ctx)
+            jd_send(pkt->service_index, pkt->service_command, devs_get_gc_stats(state->ctx),
+                    DEVS_GC_STATS_SUMMARY_SIZE);
+        else
+            jd_send(pkt->service_index, pkt->service_command, NULL, 0);
+        break;
+
     default:
         if (respond_dcfg(pkt, JD_DEVICE_SCRIPT_MANAGER_REG_PROGRAM_VERSION, "@version") ||
             respond_dcfg(pkt, JD_DEVICE_SCRIPT_MANAGER_REG_PROGRAM_NAME, "@name"))
@@ -0,0 +1,458 @@
+#include "devs_internal.h"
+
+// Shortest round-trip double formatting, using Grisu2 (Loitsch, "Printing Floating-Point
+// Numbers Quickly and Accurately with Integers", PLDI 2010).
+// Grisu2 output always parses back to the same double, but when it needs 16+ digits it
+// may be a digit too long, or not the closest candidate. Those cases are redone with
+// exact big-number arithmetic, so the result matches Number.prototype.toString().
+
+typedef struct {
+    uint64_t f;
+    int e;
+} diy_fp_t;
+
+#define DP_SIGNIFICAND_SIZE 52
+#define DP_EXPONENT_BIAS (0x3FF + DP_SIGNIFICAND_SIZE)
+#define DP_MIN_EXPONENT (-DP_EXPONENT_BIAS)
+#define DP_HIDDEN_BIT ((uint64_t)1 << DP_SIGNIFICAND_SIZE)
+#define DP_SIGNIFICAND_MASK (DP_HIDDEN_BIT - 1)
+
+// 10^k for k = -348, -340, ..., 340, normalized to 64 bits
+static const uint64_t cached_powers_f[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL, 0xcf42894a5dce35eaULL,
+    0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL, 0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL,
+    0xbe5691ef416bd60cULL, 0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL, 0xc21094364dfb5637ULL,
+    0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL, 0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL,
+    0xb23867fb2a35b28eULL, 0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL, 0xb5b5ada8aaff80b8ULL,
+    0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL, 0x964e858c91ba2655ULL, 0xdff9772470297ebdULL,
+    0xa6dfbd9fb8e5b88fULL, 0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL, 0xaa242499697392d3ULL,
+    0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL, 0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL,
+    0x9c40000000000000ULL, 0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL, 0x9f4f2726179a2245ULL,
+    0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL, 0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL,
+    0x924d692ca61be758ULL, 0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL, 0x952ab45cfa97a0b3ULL,
+    0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL, 0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL,
+    0x88fcf317f22241e2ULL, 0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL, 0x8bab8eefb6409c1aULL,
+    0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL, 0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL,
+    0x80444b5e7aa7cf85ULL, 0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+static const int16_t cached_powers_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+    -901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+    -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+    -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+    56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+    694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+    1013, 1039, 1066,
+};
+
+static const uint64_t pow10_tbl[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL,
+    10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL,
+    1000000000000ULL, 10000000000000ULL, 100000000000000ULL, 1000000000000000ULL,
+    10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL,
+};
+
+static diy_fp_t fp_mul(diy_fp_t x, diy_fp_t y) {
+    const uint64_t m32 = 0xFFFFFFFFU;
+    uint64_t a = x.f >> 32, b = x.f & m32, c = y.f >> 32, d = y.f & m32;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & m32) + (bc & m32);
+    tmp += 1U << 31; // round
+    diy_fp_t r = {ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64};
+    return r;
+}
+
+static diy_fp_t fp_normalize(diy_fp_t x) {
+    while (!(x.f & ((uint64_t)1 << 63))) {
+        x.f <<= 1;
+        x.e--;
+    }
+    return x;
+}
+
+static void normalized_boundaries(diy_fp_t v, diy_fp_t *minus, diy_fp_t *plus) {
+    diy_fp_t pl = {(v.f << 1) + 1, v.e - 1};
+    while (!(pl.f & (DP_HIDDEN_BIT << 1))) {
+        pl.f <<= 1;
+        pl.e--;
+    }
+    pl.f <<= 64 - DP_SIGNIFICAND_SIZE - 2;
+    pl.e -= 64 - DP_SIGNIFICAND_SIZE - 2;
+
+    diy_fp_t mi;
+    if (v.f == DP_HIDDEN_BIT) {
+        mi.f = (v.f << 2) - 1;
+        mi.e = v.e - 2;
+    } else {
+        mi.f = (v.f << 1) - 1;
+        mi.e = v.e - 1;
+    }
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+
+    *plus = pl;
+    *minus = mi;
+}
+
+static diy_fp_t cached_power(int e, int *K) {
+    // dk must be positive, so we can round up by truncating
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int k = (int)dk;
+    if (dk - k > 0.0)
+        k++;
+    unsigned index = (k >> 3) + 1;
+    *K = -(-348 + (int)(index << 3));
+    diy_fp_t r = {cached_powers_f[index], cached_powers_e[index]};
+    return r;
+}
+
+static void grisu_round(char *buf, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa,
+                        uint64_t wp_w) {
+    while (rest < wp_w && delta - rest >= ten_kappa &&
+           (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+        buf[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static int count_digits32(uint32_t n) {
+    int r = 1;
+    while (r < 10 && n >= pow10_tbl[r])
+        r++;
+    return r;
+}
+
+static int digit_gen(diy_fp_t w, diy_fp_t mp, uint64_t delta, char *buf, int *K) {
+    diy_fp_t one = {(uint64_t)1 << -mp.e, mp.e};
+    uint64_t wp_w = mp.f - w.f;
+    uint32_t p1 = (uint32_t)(mp.f >> -one.e);
+    uint64_t p2 = mp.f & (one.f - 1);
+    int kappa = count_digits32(p1);
+    int len = 0;
+
+    while (kappa > 0) {
+        uint32_t div = pow10_tbl[kappa - 1];
+        uint32_t d = p1 / div;
+        p1 %= div;
+        if (d || len)
+            buf[len++] = '0' + d;
+        kappa--;
+        uint64_t tmp = ((uint64_t)p1 << -one.e) + p2;
+        if (tmp <= delta) {
+            *K += kappa;
+            grisu_round(buf, len, delta, tmp, pow10_tbl[kappa] << -one.e, wp_w);
+            return len;
+        }
+    }
+
+    for (;;) {
+        p2 *= 10;
+        delta *= 10;
+        char d = (char)(p2 >> -one.e);
+        if (d || len)
+            buf[len++] = '0' + d;
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < delta) {
+            *K += kappa;
+            int index = -kappa;
+            grisu_round(buf, len, delta, p2, one.f, wp_w * (index < 20 ? pow10_tbl[index] : 0));
+            return len;
+        }
+    }
+}
+
+// v > 0, finite; returns number of digits; value is digits * 10^K
+static int grisu2(double v, char *buf, int *K) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    int biased_e = (bits >> DP_SIGNIFICAND_SIZE) & 0x7FF;
+    diy_fp_t dv;
+    dv.f = bits & DP_SIGNIFICAND_MASK;
+    if (biased_e) {
+        dv.f += DP_HIDDEN_BIT;
+        dv.e = biased_e - DP_EXPONENT_BIAS;
+    } else {
+        dv.e = DP_MIN_EXPONENT + 1;
+    }
+
+    diy_fp_t w_m, w_p;
+    normalized_boundaries(dv, &w_m, &w_p);
+    diy_fp_t c_mk = cached_power(w_p.e, K);
+    diy_fp_t w = fp_mul(fp_normalize(dv), c_mk);
+    diy_fp_t wp = fp_mul(w_p, c_mk);
+    diy_fp_t wm = fp_mul(w_m, c_mk);
+    wm.f++;
+    wp.f--;
+    return digit_gen(w, wp, wp.f - wm.f, buf, K);
+}
+
+#define BIG_WORDS 40 // enough for 2^1074 and for 10^340 * 2^53
+
+typedef struct {
+    unsigned len;
+    uint32_t w[BIG_WORDS];
+} bignum_t;
+
+static void big_set(bignum_t *b, uint64_t v) {
+    b->w[0] = (uint32_t)v;
+    b->w[1] = (uint32_t)(v >> 32);
+    b->len = b->w[1] ? 2 : b->w[0] ? 1 : 0;
+}
+
+static void big_mul_small(bignum_t *b, uint32_t m) {
+    uint64_t carry = 0;
+    for (unsigned i = 0; i < b->len; ++i) {
+        uint64_t t = (uint64_t)b->w[i] * m + carry;
+        b->w[i] = (uint32_t)t;
+        carry = t >> 32;
+    }
+    if (carry) {
+        JD_ASSERT(b->len < BIG_WORDS);
+        b->w[b->len++] = (uint32_t)carry;
+    }
+}
+
+static void big_mul_pow10(bignum_t *b, unsigned p) {
+    while (p >= 9) {
+        big_mul_small(b, 1000000000);
+        p -= 9;
+    }
+    if (p)
+        big_mul_small(b, pow10_tbl[p]);
+}
+
+static void big_shl(bignum_t *b, unsigned n) {
+    unsigned words = n / 32, bits = n % 32;
+    JD_ASSERT(b->len + words + 1 <= BIG_WORDS);
+    b->w[b->len] = 0;
+    for (int i = b->len; i >= 0; --i) {
+        uint32_t v = b->w[i] << bits;
+        if (bits && i > 0)
+            v |= b->w[i - 1] >> (32 - bits);
+        b->w[i + words] = v;
+    }
+    for (unsigned i = 0; i < words; ++i)
+        b->w[i] = 0;
+    b->len += words + 1;
+    while (b->len && !b->w[b->len - 1])
+        b->len--;
+}
+
+static int big_cmp(const bignum_t *a, const bignum_t *b) {
+    if (a->len != b->len)
+        return a->len < b->len ? -1 : 1;
+    for (int i = a->len - 1; i >= 0; --i)
+        if (a->w[i] != b->w[i])
+            return a->w[i] < b->w[i] ? -1 : 1;
+    return 0;
+}
+
+// a -= b, assumes a >= b
+static void big_sub(bignum_t *a, const bignum_t *b) {
+    int64_t borrow = 0;
+    for (unsigned i = 0; i < a->len; ++i) {
+        int64_t t = (int64_t)a->w[i] - (i < b->len ? b->w[i] : 0) + borrow;
+        a->w[i] = (uint32_t)t;
+        borrow = t < 0 ? -1 : 0;
+    }
+    while (a->len && !a->w[a->len - 1])
+        a->len--;
+}
+
+// Correctly rounded (half to even) len-digit decimal of v > 0; value is 0.digits * 10^n.
+// n is an estimate on input.
+static void exact_digits(double v, int len, char *digits, int *n) {
+    static bignum_t num, den; // too big for the stack on small devices
+
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    int e = (bits >> DP_SIGNIFICAND_SIZE) & 0x7FF;
+    uint64_t m = bits & DP_SIGNIFICAND_MASK;
+    if (e) {
+        m += DP_HIDDEN_BIT;
+        e -= DP_EXPONENT_BIAS;
+    } else {
+        e = DP_MIN_EXPONENT + 1;
+    }
+
+    big_set(&num, m);
+    big_set(&den, 1);
+    if (e > 0)
+        big_shl(&num, e);
+    else
+        big_shl(&den, -e);
+
+    // scale to 1 <= num/den < 10
+    int p = 1 - *n;
+    if (p > 0)
+        big_mul_pow10(&num, p);
+    else
+        big_mul_pow10(&den, -p);
+    if (big_cmp(&num, &den) < 0) {
+        big_mul_small(&num, 10);
+        (*n)--;
+    } else {
+        big_mul_small(&den, 10);
+        if (big_cmp(&num, &den) >= 0)
+            (*n)++;
+        else
+            big_mul_small(&num, 10);
+    }
+
+    for (int i = 0; i < len; ++i) {
+        if (i > 0)
+            big_mul_small(&num, 10);
+        int d = 0;
+        while (big_cmp(&num, &den) >= 0) {
+            big_sub(&num, &den);
+            d++;
+        }
+        digits[i] = '0' + d;
+    }
+
+    big_shl(&num, 1);
+    int c = big_cmp(&num, &den);
+    if (c > 0 || (c == 0 && (digits[len - 1] & 1))) {
+        int i = len - 1;
+        while (i >= 0 && digits[i] == '9')
+            digits[i--] = '0';
+        if (i >= 0) {
+            digits[i]++;
+        } else {
+            digits[0] = '1';
+            (*n)++;
+        }
+    }
+}
+
+static bool digits_roundtrip(double v, const char *digits, int len, int n) {
+    char buf[32];
+    memcpy(buf, digits, len);
+    jd_sprintf(buf + len, sizeof(buf) - len, "e%d", n - len);
+    return devs_strtod(buf, NULL) == v;
+}
+
+static unsigned print_u64(char *dst, uint64_t v) {
+    char tmp[20];
+    unsigned n = 0;
+    do {
+        tmp[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    for (unsigned i = 0; i < n; ++i)
+        dst[i] = tmp[n - 1 - i];
+    return n;
+}
+
+unsigned devs_itoa(int32_t v, char *buf) {
+    unsigned n = 0;
+    uint32_t u = v;
+    if (v < 0) {
+        buf[n++] = '-';
+        u = 0 - u;
+    }
+    n += print_u64(buf + n, u);
+    buf[n] = 0;
+    return n;
+}
+
+unsigned devs_dtoa(double d, char *buf) {
+    char *p = buf;
+
+    if (d != d) {
+        strcpy(buf, "NaN");
+        return 3;
+    }
+    if (d < 0) {
+        *p++ = '-';
+        d = -d;
+    }
+    if (d == 0) {
+        // also -0
+        strcpy(buf, "0");
+        return 1;
+    }
+    if (d > 1.7976931348623157e308) {
+        strcpy(p, "Infinity");
+        return p - buf + 8;
+    }
+
+    // exact integers don't need Grisu
+    if (d < 9007199254740992.0 && d == (double)(uint64_t)d) {
+        p += print_u64(p, (uint64_t)d);
+        *p = 0;
+        return p - buf;
+    }
+
+    char digits[20];
+    int K;
+    int k = grisu2(d, digits, &K);
+    // value is 0.digits * 10^n
+    int n = k + K;
+
+    if (k >= 16) {
+        char tmp[20];
+        for (int len = k - 1; len <= k; ++len) {
+            int n2 = n;
+            exact_digits(d, len, tmp, &n2);
+            if (digits_roundtrip(d, tmp, len, n2)) {
+                memcpy(digits, tmp, len);
+                k = len;
+                n = n2;
+                break;
+            }
+        }
+        // rounding may have produced trailing zeros
+        while (k > 1 && digits[k - 1] == '0')
+            k--;
+    }
+
+    if (k <= n && n <= 21) {
+        memcpy(p, digits, k);
+        p += k;
+        for (int i = k; i < n; ++i)
+            *p++ = '0';
+    } else if (0 < n && n <= 21) {
+        memcpy(p, digits, n);
+        p += n;
+        *p++ = '.';
+        memcpy(p, digits + n, k - n);
+        p += k - n;
+    } else if (-6 < n && n <= 0) {
+        *p++ = '0';
+        *p++ = '.';
+        for (int i = n; i < 0; ++i)
+            *p++ = '0';
+        memcpy(p, digits, k);
+        p += k;
+    } else {
+        *p++ = digits[0];
+        if (k > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, k - 1);
+            p += k - 1;
+        }
+        *p++ = 'e';
+        int e = n - 1;
+        if (e < 0) {
+            *p++ = '-';
+            e = -e;
+        } else {
+            *p++ = '+';
+        }
+        p += print_u64(p, e);
+    }
+
+    *p = 0;
+    return p - buf;
+}
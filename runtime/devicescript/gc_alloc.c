@@ -2,6 +2,7 @@
 // Licensed under the MIT license.
 
 #include "devs_internal.h"
+#include "interfaces/jd_hw.h"
 
 // #define LOG_TAG "gc"
 // #define VLOGGING 1
@@ -17,6 +18,46 @@ void devs_gc_obj_check_core(devs_gc_t *gc, const void *ptr);
 
 #define ROOT_SCAN_DEPTH 10
 
+// compaction is opt-in at runtime (DEVS_FLAG_GC_COMPACT), and can be compiled out
+#ifndef JD_GC_COMPACT
+#define JD_GC_COMPACT 1
+#endif
+
+// we compact when the largest free block after GC is below heap_size/JD_GC_COMPACT_FRACTION
+#define JD_GC_COMPACT_FRACTION 16
+
+// hosted builds start with JD_GC_KB and grow the heap on demand, one chunk at a time
+#ifndef JD_GC_ELASTIC
+#define JD_GC_ELASTIC (JD_HOSTED && !JD_GC_ALLOC)
+#endif
+
+#if JD_GC_ELASTIC
+#ifndef JD_GC_MAX_KB
+// on 64-bit, GC handles are 24-bit offsets from the start of the heap
+#define JD_GC_MAX_KB (16 * 1024 - 64)
+#endif
+// we grow when less than heap_size/JD_GC_GROW_FRACTION is free after GC
+#define JD_GC_GROW_FRACTION 4
+// we release the last chunk if it's empty, and without it at least
+// heap_size/JD_GC_SHRINK_FRACTION would still be free
+#define JD_GC_SHRINK_FRACTION 2
+#endif
+
+// native hosted builds can mark using several threads (make GC_PARALLEL=1),
+// see devs_gc_host_run_workers()
+#ifndef JD_GC_PARALLEL
+#define JD_GC_PARALLEL 0
+#endif
+
+#if JD_GC_PARALLEL
+#ifndef JD_GC_PARALLEL_MIN_KB
+// for smaller heaps, waking up the workers costs more than it saves
+#define JD_GC_PARALLEL_MIN_KB 512
+#endif
+// per-worker; when full, objects are left for the serial pending scan
+#define MARK_DEQUE_SIZE 4096
+#endif
+
 #define GET_TAG(p) ((p) >> DEVS_GC_TAG_POS)
 #define BASIC_TAG(p) (GET_TAG(p) & DEVS_GC_TAG_MASK)
 
@@ -54,10 +95,23 @@ typedef struct _devs_gc_block_t {
         devs_short_map_t short_map;
         devs_activation_t act;
         devs_bound_function_t bound_function;
+        devs_string_rope_t rope;
         devs_packet_t pkt;
+        devs_buffer_view_t buffer_view;
+        devs_typed_array_t typed_array;
+        devs_json_parser_t json_parser;
     };
 } block_t;
 
+#if JD_GC_PARALLEL
+// Chase-Lev work-stealing deque; the owner pushes and pops at bottom, others steal from top
+typedef struct {
+    long top;
+    long bottom;
+    block_t *items[MARK_DEQUE_SIZE];
+} mark_deque_t;
+#endif
+
 typedef struct _devs_gc_chunk_t {
     struct _devs_gc_chunk_t *next;
     block_t *end; // GET_TAG(end) == DEVS_GC_TAG_FINAL
@@ -68,9 +122,23 @@ struct _devs_gc_t {
     block_t *first_free;
     chunk_t *first_chunk;
     uint32_t num_alloc;
+    uint32_t num_free;
     uint32_t gc_threshold;
     uint32_t curr_alloc;
+    uint32_t compact_threshold;
+    uint8_t compact_pending;
     devs_ctx_t *ctx;
+    devs_gc_stats_t stats;
+#if JD_GC_ELASTIC && JD_64
+    // chunks are allocated consecutively from here, see devs_gc_host_reserve()
+    uint8_t *reserve_top;
+    uint8_t *reserve_end;
+#endif
+#if JD_GC_PARALLEL
+    mark_deque_t *mark_deques;
+    unsigned num_mark_deques;
+    unsigned num_idle;
+#endif
 };
 
 static inline void mark_block(devs_gc_t *gc, block_t *block, unsigned tag, unsigned size) {
@@ -95,19 +163,18 @@ void devs_gc_add_chunk(devs_gc_t *gc, void *start, unsigned size) {
         (block_t *)(((uintptr_t)((uint8_t *)start + size) & ~(JD_PTRSIZE - 1)) - sizeof(uintptr_t));
 
     gc->gc_threshold += size / sizeof(void *) / JD_GC_FRACTION;
+    gc->compact_threshold += size / sizeof(void *) / JD_GC_COMPACT_FRACTION;
 
-    ch->next = NULL;
-    if (gc->first_chunk == NULL) {
-        gc->first_chunk = ch;
-    } else {
-        for (chunk_t *p = gc->first_chunk; p; p = p->next) {
-            JD_ASSERT(p < ch); // addresses have to be in order
-            if (p->next == NULL) {
-                p->next = ch;
-                break;
-            }
-        }
+    // keep chunks in address order
+    chunk_t **pp = &gc->first_chunk;
+    while (*pp && *pp < ch) {
+        JD_ASSERT((void *)(*pp)->end < start);
+        pp = &(*pp)->next;
     }
+    JD_ASSERT(*pp == NULL || (void *)ch->end < (void *)*pp);
+    ch->next = *pp;
+    *pp = ch;
+
     ch->end->header = DEVS_GC_MK_TAG_WORDS(DEVS_GC_TAG_FINAL, 1);
     mark_block(gc, ch->start, DEVS_GC_TAG_FREE, block_ptr(ch->end) - block_ptr(ch->start));
 }
@@ -188,6 +255,22 @@ static void scan_gc_obj(devs_ctx_t *ctx, block_t *block, int depth) {
             scan_value(ctx, block->bound_function.this_val, depth);
             scan_value(ctx, block->bound_function.func, depth);
             break;
+        case DEVS_GC_TAG_STRING_ROPE:
+            scan_value(ctx, block->rope.left, depth);
+            scan_value(ctx, block->rope.right, depth);
+            break;
+        case DEVS_GC_TAG_BUFFER_VIEW:
+            scan_value(ctx, block->buffer_view.parent, depth);
+            map = block->buffer_view.attached;
+            break;
+        case DEVS_GC_TAG_TYPED_ARRAY:
+            scan_value(ctx, block->typed_array.buffer, depth);
+            map = block->typed_array.attached;
+            break;
+        case DEVS_GC_TAG_JSON_PARSER:
+            scan_gc_obj(ctx, (block_t *)block->json_parser.token, depth);
+            scan_gc_obj(ctx, (block_t *)block->json_parser.stack, depth);
+            break;
         case DEVS_GC_TAG_ACTIVATION:
             scan_gc_obj(ctx, (void *)block->act.closure, depth);
             scan_array(ctx, block->act.slots, block->act.func->num_slots, depth);
@@ -203,6 +286,12 @@ static void scan_gc_obj(devs_ctx_t *ctx, block_t *block, int depth) {
             break;
         }
 
+        if (map && (void *)map != (void *)block) {
+            // attached map - it needs to be marked itself, so scan it next
+            block = (block_t *)map;
+            continue;
+        }
+
         if (map) {
             unsigned len = map->length;
             if (BASIC_TAG(header) != DEVS_GC_TAG_SHORT_MAP)
@@ -218,45 +307,318 @@ static void scan_gc_obj(devs_ctx_t *ctx, block_t *block, int depth) {
     }
 }
 
-static void mark_roots(devs_gc_t *gc) {
-    if (gc->ctx == NULL)
-        return;
-    devs_ctx_t *ctx = gc->ctx;
+static void root_value(devs_ctx_t *ctx, devs_gc_root_cb_t cb, void *userdata, unsigned kind,
+                       value_t v) {
+    if (devs_handle_is_ptr(v))
+        cb(ctx, userdata, kind, devs_handle_ptr_value(ctx, v));
+}
 
-    scan_array(ctx, ctx->globals, ctx->img.header->num_globals, ROOT_SCAN_DEPTH);
-    scan_array(ctx, ctx->the_stack, ctx->stack_top_for_gc, ROOT_SCAN_DEPTH);
+static void root_values(devs_ctx_t *ctx, devs_gc_root_cb_t cb, void *userdata, unsigned kind,
+                        value_t *vals, unsigned length) {
+    for (unsigned i = 0; i < length; ++i)
+        root_value(ctx, cb, userdata, kind, vals[i]);
+}
 
-    for (unsigned i = 0; i < ctx->_num_builtin_protos; ++i) {
-        void *p = ctx->_builtin_protos[i];
-        scan_gc_obj(ctx, p, ROOT_SCAN_DEPTH);
-    }
+static void root_obj(devs_ctx_t *ctx, devs_gc_root_cb_t cb, void *userdata, unsigned kind,
+                     void *obj) {
+    if (obj)
+        cb(ctx, userdata, kind, obj);
+}
+
+void devs_gc_iter_roots(devs_ctx_t *ctx, devs_gc_root_cb_t cb, void *userdata) {
+    root_values(ctx, cb, userdata, DEVS_GC_ROOT_GLOBALS, ctx->globals,
+                ctx->img.header->num_globals);
+    root_values(ctx, cb, userdata, DEVS_GC_ROOT_STACK, ctx->the_stack, ctx->stack_top_for_gc);
+    root_values(ctx, cb, userdata, DEVS_GC_ROOT_SCOPES, ctx->roots, ctx->num_roots);
+
+    for (unsigned i = 0; i < ctx->_num_builtin_protos; ++i)
+        root_obj(ctx, cb, userdata, DEVS_GC_ROOT_BUILTINS, ctx->_builtin_protos[i]);
 
     for (unsigned i = 0; i < ctx->num_roles; ++i) {
         devs_role_t *r = devs_role(ctx, i);
         if (r) {
-            scan_value(ctx, r->name, ROOT_SCAN_DEPTH);
-            scan_gc_obj(ctx, (block_t *)r->attached, ROOT_SCAN_DEPTH);
+            root_value(ctx, cb, userdata, DEVS_GC_ROOT_ROLES, r->name);
+            root_obj(ctx, cb, userdata, DEVS_GC_ROOT_ROLES, r->attached);
         }
     }
 
-    for (unsigned i = 0; i < ctx->num_pins; ++i) {
-        scan_value(ctx, ctx->pin_state[i].obj, ROOT_SCAN_DEPTH);
-    }
+    for (unsigned i = 0; i < ctx->num_pins; ++i)
+        root_value(ctx, cb, userdata, DEVS_GC_ROOT_PINS, ctx->pin_state[i].obj);
 
-    scan_gc_obj(ctx, (block_t *)ctx->fn_protos, ROOT_SCAN_DEPTH);
-    scan_gc_obj(ctx, (block_t *)ctx->fn_values, ROOT_SCAN_DEPTH);
-    scan_gc_obj(ctx, (block_t *)ctx->spec_protos, ROOT_SCAN_DEPTH);
-    scan_value(ctx, ctx->exn_val, ROOT_SCAN_DEPTH);
-    scan_value(ctx, ctx->diag_field, ROOT_SCAN_DEPTH);
+    root_obj(ctx, cb, userdata, DEVS_GC_ROOT_INTERNAL, ctx->fn_protos);
+    root_obj(ctx, cb, userdata, DEVS_GC_ROOT_INTERNAL, ctx->fn_values);
+    root_obj(ctx, cb, userdata, DEVS_GC_ROOT_INTERNAL, ctx->spec_protos);
+    root_value(ctx, cb, userdata, DEVS_GC_ROOT_INTERNAL, ctx->exn_val);
+    root_value(ctx, cb, userdata, DEVS_GC_ROOT_INTERNAL, ctx->diag_field);
+    for (unsigned i = 0; i < DEVS_INT_STR_CACHE_SIZE; ++i)
+        root_value(ctx, cb, userdata, DEVS_GC_ROOT_INTERNAL, ctx->int_str_vals[i]);
 
     for (devs_fiber_t *fib = ctx->fibers; fib; fib = fib->next) {
-        scan_value(ctx, fib->ret_val, ROOT_SCAN_DEPTH);
+        root_value(ctx, cb, userdata, DEVS_GC_ROOT_FIBERS, fib->ret_val);
         if (devs_fiber_uses_pkt_data_v(fib))
-            scan_value(ctx, fib->pkt_data.v, ROOT_SCAN_DEPTH);
-        for (devs_activation_t *act = fib->activation; act; act = act->caller) {
-            scan_gc_obj(ctx, (void *)act, ROOT_SCAN_DEPTH);
+            root_value(ctx, cb, userdata, DEVS_GC_ROOT_FIBERS, fib->pkt_data.v);
+        for (devs_activation_t *act = fib->activation; act; act = act->caller)
+            root_obj(ctx, cb, userdata, DEVS_GC_ROOT_FIBERS, act);
+    }
+}
+
+static void mark_root(devs_ctx_t *ctx, void *userdata, unsigned kind, void *obj) {
+    scan_gc_obj(ctx, obj, ROOT_SCAN_DEPTH);
+}
+
+#if JD_GC_PARALLEL
+
+static unsigned heap_bytes(devs_gc_t *gc);
+
+#define SCANNED_BIT ((uintptr_t)DEVS_GC_TAG_MASK_SCANNED << DEVS_GC_TAG_POS)
+#define PENDING_BIT ((uintptr_t)DEVS_GC_TAG_MASK_PENDING << DEVS_GC_TAG_POS)
+
+static bool deque_push(mark_deque_t *d, block_t *b) {
+    long bt = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+    long t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    if (bt - t >= MARK_DEQUE_SIZE)
+        return false;
+    __atomic_store_n(&d->items[bt & (MARK_DEQUE_SIZE - 1)], b, __ATOMIC_RELAXED);
+    __atomic_store_n(&d->bottom, bt + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static block_t *deque_pop(mark_deque_t *d) {
+    long bt = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&d->bottom, bt, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long t = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+    if (t > bt) {
+        __atomic_store_n(&d->bottom, bt + 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    block_t *b = __atomic_load_n(&d->items[bt & (MARK_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+    if (t == bt) {
+        // last item - race against stealers
+        if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, false, __ATOMIC_SEQ_CST,
+                                         __ATOMIC_RELAXED))
+            b = NULL;
+        __atomic_store_n(&d->bottom, bt + 1, __ATOMIC_RELAXED);
+    }
+    return b;
+}
+
+static block_t *deque_steal(mark_deque_t *d) {
+    long t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long bt = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+    if (t >= bt)
+        return NULL;
+    block_t *b = __atomic_load_n(&d->items[t & (MARK_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, false, __ATOMIC_SEQ_CST,
+                                     __ATOMIC_RELAXED))
+        return NULL;
+    return b;
+}
+
+static bool deque_empty(mark_deque_t *d) {
+    return __atomic_load_n(&d->top, __ATOMIC_ACQUIRE) >=
+           __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+}
+
+// more than just the owner's next block
+static bool deque_has_spare(mark_deque_t *d) {
+    return __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) -
+               __atomic_load_n(&d->top, __ATOMIC_ACQUIRE) >
+           1;
+}
+
+// claim the block for marking, and queue it for scanning
+static void par_mark_obj(mark_deque_t *d, block_t *block) {
+    if (!block)
+        return;
+    uintptr_t header = __atomic_load_n(&block->header, __ATOMIC_RELAXED);
+    do {
+        if (IS_FREE(header) ||
+            GET_TAG(header) & (DEVS_GC_TAG_MASK_SCANNED | DEVS_GC_TAG_MASK_PENDING))
+            return;
+    } while (!__atomic_compare_exchange_n(&block->header, &header, header | SCANNED_BIT, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    if (!deque_push(d, block))
+        // deque overflow - sweep() will pick it up serially
+        __atomic_fetch_xor(&block->header, SCANNED_BIT | PENDING_BIT, __ATOMIC_RELAXED);
+}
+
+static void par_mark_value(devs_ctx_t *ctx, mark_deque_t *d, value_t v) {
+    if (devs_handle_is_ptr(v))
+        par_mark_obj(d, devs_handle_ptr_value(ctx, v));
+}
+
+static void par_mark_array(devs_ctx_t *ctx, mark_deque_t *d, value_t *vals, unsigned length) {
+    for (unsigned i = 0; i < length; ++i)
+        par_mark_value(ctx, d, vals[i]);
+}
+
+static void par_mark_array_and_ptr(devs_ctx_t *ctx, mark_deque_t *d, value_t *vals,
+                                   unsigned length) {
+    if (vals) {
+        // the data block is only referenced from its owner, which we hold
+        mark_ptr(ctx, vals);
+        par_mark_array(ctx, d, vals, length);
+    }
+}
+
+// keep in sync with scan_gc_obj()
+static void par_scan_obj(devs_ctx_t *ctx, mark_deque_t *d, block_t *block) {
+    uintptr_t header = __atomic_load_n(&block->header, __ATOMIC_RELAXED);
+    devs_map_t *map = NULL;
+
+    switch (BASIC_TAG(header)) {
+    case DEVS_GC_TAG_BUFFER:
+        map = block->buffer.attached;
+        break;
+    case DEVS_GC_TAG_IMAGE:
+        par_mark_obj(d, (block_t *)block->image.buffer);
+        map = block->image.attached;
+        break;
+    case DEVS_GC_TAG_SHORT_MAP:
+    case DEVS_GC_TAG_HALF_STATIC_MAP:
+    case DEVS_GC_TAG_MAP:
+        map = &block->map;
+        break;
+    case DEVS_GC_TAG_ARRAY:
+        par_mark_array_and_ptr(ctx, d, block->array.data, block->array.length);
+        map = block->array.attached;
+        break;
+    case DEVS_GC_TAG_PACKET:
+        par_mark_obj(d, (block_t *)block->pkt.payload);
+        map = block->pkt.attached;
+        break;
+    case DEVS_GC_TAG_BOUND_FUNCTION:
+        par_mark_value(ctx, d, block->bound_function.this_val);
+        par_mark_value(ctx, d, block->bound_function.func);
+        break;
+    case DEVS_GC_TAG_STRING_ROPE:
+        par_mark_value(ctx, d, block->rope.left);
+        par_mark_value(ctx, d, block->rope.right);
+        break;
+    case DEVS_GC_TAG_BUFFER_VIEW:
+        par_mark_value(ctx, d, block->buffer_view.parent);
+        map = block->buffer_view.attached;
+        break;
+    case DEVS_GC_TAG_TYPED_ARRAY:
+        par_mark_value(ctx, d, block->typed_array.buffer);
+        map = block->typed_array.attached;
+        break;
+    case DEVS_GC_TAG_JSON_PARSER:
+        par_mark_obj(d, (block_t *)block->json_parser.token);
+        par_mark_obj(d, (block_t *)block->json_parser.stack);
+        break;
+    case DEVS_GC_TAG_ACTIVATION:
+        par_mark_obj(d, (void *)block->act.closure);
+        par_mark_array(ctx, d, block->act.slots, block->act.func->num_slots);
+        break;
+    case DEVS_GC_TAG_STRING_JMP:
+    case DEVS_GC_TAG_STRING:
+    case DEVS_GC_TAG_BYTES:
+    case DEVS_GC_TAG_BUILTIN_PROTO:
+        break;
+    default:
+        DMESG("invalid tag: %x at %p", (unsigned)header, block);
+        JD_PANIC();
+        break;
+    }
+
+    if (!map)
+        return;
+
+    if ((void *)map != (void *)block) {
+        par_mark_obj(d, (block_t *)map);
+    } else {
+        unsigned len = map->length;
+        if (BASIC_TAG(header) != DEVS_GC_TAG_SHORT_MAP)
+            len *= 2;
+        par_mark_array_and_ptr(ctx, d, map->data, len);
+        if (devs_maplike_is_map(ctx, map->proto))
+            par_mark_obj(d, (block_t *)map->proto);
+    }
+}
+
+// idle workers sleep until this is true
+static bool par_can_resume(void *arg) {
+    devs_gc_t *gc = arg;
+    unsigned n = gc->num_mark_deques;
+    if (__atomic_load_n(&gc->num_idle, __ATOMIC_SEQ_CST) == n)
+        return true;
+    for (unsigned i = 0; i < n; ++i)
+        if (!deque_empty(&gc->mark_deques[i]))
+            return true;
+    return false;
+}
+
+static void par_mark_worker(void *arg, unsigned idx) {
+    devs_gc_t *gc = arg;
+    unsigned n = gc->num_mark_deques;
+    mark_deque_t *d = &gc->mark_deques[idx];
+
+    for (;;) {
+        block_t *b = deque_pop(d);
+        for (unsigned i = 1; !b && i < n; ++i)
+            b = deque_steal(&gc->mark_deques[(idx + i) % n]);
+        if (b) {
+            par_scan_obj(gc->ctx, d, b);
+            // a missed wake-up only costs parallelism; the last idle worker wakes everyone
+            if (__atomic_load_n(&gc->num_idle, __ATOMIC_RELAXED) && deque_has_spare(d))
+                devs_gc_host_wake_workers();
+            continue;
+        }
+
+        // only busy workers push, so once everyone is idle, all deques are empty
+        if (__atomic_add_fetch(&gc->num_idle, 1, __ATOMIC_SEQ_CST) == n) {
+            devs_gc_host_wake_workers();
+            return;
         }
+        devs_gc_host_wait(par_can_resume, gc);
+        if (__atomic_load_n(&gc->num_idle, __ATOMIC_SEQ_CST) == n)
+            return;
+        __atomic_sub_fetch(&gc->num_idle, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+static void par_mark_root(devs_ctx_t *ctx, void *userdata, unsigned kind, void *obj) {
+    devs_gc_t *gc = userdata;
+    // spread the roots between workers; they will steal from each other anyway
+    par_mark_obj(&gc->mark_deques[gc->num_idle++ % gc->num_mark_deques], obj);
+}
+
+static bool par_mark_roots(devs_gc_t *gc) {
+    if (heap_bytes(gc) < JD_GC_PARALLEL_MIN_KB * 1024)
+        return false;
+    unsigned n = devs_gc_host_num_workers();
+    if (n < 2)
+        return false;
+
+    if (gc->num_mark_deques != n) {
+        jd_free(gc->mark_deques);
+        gc->mark_deques = jd_alloc(n * sizeof(mark_deque_t));
+        gc->num_mark_deques = n;
     }
+
+    gc->num_idle = 0; // used as round-robin counter for roots
+    devs_gc_iter_roots(gc->ctx, par_mark_root, gc);
+    gc->num_idle = 0;
+    devs_gc_host_run_workers(n, par_mark_worker, gc);
+
+    for (unsigned i = 0; i < n; ++i)
+        JD_ASSERT(deque_empty(&gc->mark_deques[i]));
+    return true;
+}
+
+#endif
+
+static void mark_roots(devs_gc_t *gc) {
+    if (gc->ctx == NULL)
+        return;
+#if JD_GC_PARALLEL
+    if (par_mark_roots(gc))
+        return;
+#endif
+    devs_gc_iter_roots(gc->ctx, mark_root, NULL);
 }
 
 // in words
@@ -367,12 +729,579 @@ static void validate_heap(devs_gc_t *gc) {
     }
 }
 
+static void update_free_stats(devs_gc_t *gc) {
+    devs_gc_stats_t *st = &gc->stats;
+    unsigned total = 0;
+    unsigned max_block = 0;
+    unsigned num_blocks = 0;
+    for (block_t *b = gc->first_free; b; b = b->free.next) {
+        unsigned sz = block_size(b);
+        total += sz;
+        num_blocks++;
+        if (sz > max_block)
+            max_block = sz;
+    }
+
+    st->free_bytes = total * sizeof(uintptr_t);
+    st->free_blocks = num_blocks;
+    st->max_free_block = max_block * sizeof(uintptr_t);
+}
+
+static unsigned heap_bytes(devs_gc_t *gc) {
+    unsigned words = 0;
+    for (chunk_t *ch = gc->first_chunk; ch; ch = ch->next)
+        words += block_ptr(ch->end) - block_ptr(ch->start);
+    return words * sizeof(uintptr_t);
+}
+
+static void record_time(uint32_t *hist, uint64_t t0) {
+    uint32_t d = (uint32_t)(tim_get_micros() - t0);
+    unsigned i = 0;
+    while (i < DEVS_GC_TIME_BUCKETS - 1 && d >= (16U << (2 * i)))
+        i++;
+    hist[i]++;
+}
+
+#if JD_GC_ELASTIC
+
+static void *chunk_mem_alloc(devs_gc_t *gc, unsigned size) {
+#if JD_64
+    if (gc->reserve_top + size > gc->reserve_end)
+        return NULL;
+    void *r = gc->reserve_top;
+    gc->reserve_top += size;
+    return r;
+#else
+    return jd_alloc(size);
+#endif
+}
+
+static void chunk_mem_free(devs_gc_t *gc, chunk_t *ch, unsigned size) {
+#if JD_64
+    JD_ASSERT((uint8_t *)ch + size == gc->reserve_top);
+    gc->reserve_top = (uint8_t *)ch;
+#else
+    jd_free(ch);
+#endif
+}
+
+static unsigned chunk_mem_size(chunk_t *ch) {
+    return (uint8_t *)ch->end + sizeof(uintptr_t) - (uint8_t *)ch;
+}
+
+// add a chunk with a free block of at least min_words
+static bool grow_heap(devs_gc_t *gc, unsigned min_words) {
+    unsigned size = JD_GC_KB * 1024;
+    unsigned need = (min_words + 1) * sizeof(uintptr_t) + sizeof(chunk_t);
+    if (size < need)
+        size = (need + 1023) & ~1023;
+    if (heap_bytes(gc) + size > JD_GC_MAX_KB * 1024)
+        return false;
+
+    chunk_t *ch = chunk_mem_alloc(gc, size);
+    if (!ch)
+        return false;
+    devs_gc_add_chunk(gc, ch, size);
+
+    block_t *b = ch->start;
+    b->free.next = gc->first_free;
+    gc->first_free = b;
+
+    LOG("heap grown to %u bytes", heap_bytes(gc));
+    return true;
+}
+
+static void release_chunk(devs_gc_t *gc, chunk_t *ch) {
+    for (block_t **pp = &gc->first_free; *pp; pp = &(*pp)->free.next) {
+        if (*pp == ch->start) {
+            *pp = ch->start->free.next;
+            break;
+        }
+    }
+
+    chunk_t **pp = &gc->first_chunk;
+    while (*pp != ch)
+        pp = &(*pp)->next;
+    *pp = ch->next;
+
+    unsigned size = chunk_mem_size(ch);
+    gc->gc_threshold -= size / sizeof(void *) / JD_GC_FRACTION;
+    gc->compact_threshold -= size / sizeof(void *) / JD_GC_COMPACT_FRACTION;
+    chunk_mem_free(gc, ch, size);
+
+    LOG("heap shrunk to %u bytes", heap_bytes(gc));
+}
+
+// called after GC, with up-to-date free stats
+static void resize_heap(devs_gc_t *gc) {
+    unsigned heap = heap_bytes(gc);
+
+    if (gc->stats.free_bytes < heap / JD_GC_GROW_FRACTION) {
+        if (grow_heap(gc, 0))
+            update_free_stats(gc);
+        return;
+    }
+
+    // only trailing chunks are released; compaction helps emptying them
+    for (;;) {
+        chunk_t *last = gc->first_chunk;
+        while (last->next)
+            last = last->next;
+        if (last == gc->first_chunk)
+            break;
+        block_t *b = last->start;
+        if (!IS_FREE(b->header) || next_block(b) != last->end)
+            break;
+        unsigned words = block_ptr(last->end) - block_ptr(last->start);
+        unsigned free_words = gc->stats.free_bytes / sizeof(uintptr_t) - words;
+        unsigned heap_words = heap / sizeof(uintptr_t) - words;
+        if (free_words < heap_words / JD_GC_SHRINK_FRACTION)
+            break;
+        release_chunk(gc, last);
+        update_free_stats(gc);
+        heap = heap_bytes(gc);
+    }
+}
+
+#endif
+
+#if JD_GC_COMPACT
+static void check_fragmentation(devs_gc_t *gc) {
+    if (!(devs_get_global_flags() & DEVS_FLAG_GC_COMPACT))
+        return;
+
+    unsigned max_block = gc->stats.max_free_block / sizeof(uintptr_t);
+    unsigned total = gc->stats.free_bytes / sizeof(uintptr_t);
+
+    // only worth it if there is enough free space to get a bigger block
+    if (max_block < gc->compact_threshold && total >= 2 * gc->compact_threshold)
+        gc->compact_pending = 1;
+}
+#endif
+
 static void devs_gc(devs_gc_t *gc) {
     LOG("*** GC");
+    uint64_t t0 = tim_get_micros();
     mark_roots(gc);
+    gc->stats.last_mark_time = (uint32_t)(tim_get_micros() - t0);
+    record_time(gc->stats.mark_time, t0);
+    t0 = tim_get_micros();
     sweep(gc);
+    record_time(gc->stats.sweep_time, t0);
+    gc->stats.num_gc++;
+    update_free_stats(gc);
+    gc->stats.live_bytes = heap_bytes(gc) - gc->stats.free_bytes;
+#if JD_GC_ELASTIC
+    resize_heap(gc);
+#endif
+#if JD_GC_COMPACT
+    check_fragmentation(gc);
+#endif
+}
+
+STATIC_ASSERT(DEVS_GC_TAG_MASK + 1 == DEVS_GC_NUM_TAGS);
+
+const devs_gc_stats_t *devs_gc_stats(devs_gc_t *gc) {
+    update_free_stats(gc);
+    return &gc->stats;
+}
+
+const devs_gc_stats_t *devs_get_gc_stats(devs_ctx_t *ctx) {
+    return devs_gc_stats(ctx->gc);
+}
+
+void devs_gc_collect(devs_gc_t *gc) {
+    devs_gc(gc);
+}
+
+static block_t *skip_free(devs_gc_t *gc, chunk_t *chunk, block_t *block) {
+    for (;;) {
+        uintptr_t header = block->header;
+        if (GET_TAG(header) == DEVS_GC_TAG_FINAL) {
+            chunk = chunk->next;
+            if (!chunk)
+                return NULL;
+            block = chunk->start;
+        } else if (IS_FREE(header)) {
+            block = next_block(block);
+        } else {
+            return block;
+        }
+    }
+}
+
+static chunk_t *chunk_of(devs_gc_t *gc, const void *ptr) {
+    for (chunk_t *chunk = gc->first_chunk; chunk; chunk = chunk->next)
+        if ((const void *)chunk->start <= ptr && ptr < (const void *)chunk->end)
+            return chunk;
+    return NULL;
+}
+
+void *devs_gc_first_obj(devs_gc_t *gc) {
+    if (!gc->first_chunk)
+        return NULL;
+    return skip_free(gc, gc->first_chunk, gc->first_chunk->start);
+}
+
+void *devs_gc_next_obj(devs_gc_t *gc, void *obj) {
+    chunk_t *chunk = chunk_of(gc, obj);
+    JD_ASSERT(chunk != NULL);
+    return skip_free(gc, chunk, next_block(obj));
+}
+
+uint32_t devs_gc_heap_version(devs_gc_t *gc) {
+    // every collection (including compaction) counts, as it may free or move blocks
+    return gc->num_alloc + gc->num_free + gc->stats.num_gc;
+}
+
+bool devs_gc_is_heap_ptr(devs_gc_t *gc, const void *ptr) {
+    return chunk_of(gc, ptr) != NULL;
+}
+
+#if JD_GC_COMPACT
+
+/*
+ * Sliding compaction.
+ *
+ * This runs right after a full GC, so every non-free block is live. Live blocks slide down
+ * towards the start of the chunk, except for pinned ones, which stay in place.
+ * The forwarding information is kept as a "break table" of (address, distance) pairs,
+ * one per run of blocks that move by the same distance. The table is stored in a free block
+ * of the chunk (the compaction region ends just before it), so no extra memory is needed.
+ *
+ * Native code may hold raw pointers to GC objects across allocations, so compaction
+ * can only run at a safe point, see devs_gc_compact_if_needed().
+ */
+
+typedef struct {
+    block_t *addr;
+    uintptr_t delta; // in words
+} compact_break_t;
+
+typedef struct {
+    devs_gc_t *gc;
+    devs_ctx_t *ctx;
+    block_t *start;
+    block_t *end; // the free block holding breaks[]; blocks from here on don't move
+    compact_break_t *breaks;
+    unsigned num_breaks;
+} compactor_t;
+
+static inline bool is_pinned(uintptr_t header) {
+    return (GET_TAG(header) & DEVS_GC_TAG_MASK_PINNED) != 0;
+}
+
+static inline unsigned break_table_capacity(block_t *b) {
+    return (block_size(b) - 1) * sizeof(uintptr_t) / sizeof(compact_break_t);
+}
+
+// pick the free block that collects the most free space in front of it, while still being
+// big enough to hold the break table for the region before it
+static block_t *find_break_table(chunk_t *chunk) {
+    block_t *best = NULL;
+    unsigned best_delta = 0;
+    unsigned delta = 0, last_delta = 0, num_breaks = 0;
+
+    for (block_t *block = chunk->start;; block = next_block(block)) {
+        uintptr_t header = block->header;
+        if (GET_TAG(header) == DEVS_GC_TAG_FINAL)
+            break;
+        if (IS_FREE(header)) {
+            if (delta > best_delta && num_breaks <= break_table_capacity(block)) {
+                best = block;
+                best_delta = delta;
+            }
+            delta += block_size(block);
+        } else if (is_pinned(header)) {
+            if (last_delta)
+                num_breaks++;
+            delta = last_delta = 0;
+        } else if (delta != last_delta) {
+            num_breaks++;
+            last_delta = delta;
+        }
+    }
+
+    return best;
+}
+
+static void add_break(compactor_t *c, block_t *addr, unsigned delta) {
+    JD_ASSERT(c->num_breaks < break_table_capacity(c->end));
+    c->breaks[c->num_breaks].addr = addr;
+    c->breaks[c->num_breaks].delta = delta;
+    c->num_breaks++;
+}
+
+static void build_break_table(compactor_t *c) {
+    unsigned delta = 0, last_delta = 0;
+    c->breaks = (compact_break_t *)(block_ptr(c->end) + 1);
+    c->num_breaks = 0;
+    for (block_t *block = c->start; block != c->end; block = next_block(block)) {
+        uintptr_t header = block->header;
+        if (IS_FREE(header)) {
+            delta += block_size(block);
+        } else if (is_pinned(header)) {
+            if (last_delta)
+                add_break(c, block, 0);
+            delta = last_delta = 0;
+        } else if (delta != last_delta) {
+            add_break(c, block, delta);
+            last_delta = delta;
+        }
+    }
+}
+
+static void *relocate(compactor_t *c, void *ptr) {
+    if (ptr < (void *)c->start || ptr >= (void *)c->end)
+        return ptr;
+
+    compact_break_t *hit = NULL;
+    int l = 0, r = c->num_breaks - 1;
+    while (l <= r) {
+        int m = (l + r) >> 1;
+        if ((void *)c->breaks[m].addr <= ptr) {
+            hit = &c->breaks[m];
+            l = m + 1;
+        } else {
+            r = m - 1;
+        }
+    }
+
+    return hit ? (uintptr_t *)ptr - hit->delta : ptr;
+}
+
+#define RELOCATE(c, field) (field) = relocate(c, (void *)(field))
+
+static void relocate_value(compactor_t *c, value_t *v) {
+    if (!devs_handle_is_ptr(*v))
+        return;
+    uint8_t *p = devs_handle_ptr_value(c->ctx, *v);
+    uint8_t *np = relocate(c, p);
+    // the handle is either the pointer or offset from devs_gc_base_addr(), which doesn't move
+    if (p != np)
+        v->mantisa32 -= (uint32_t)(p - np);
+}
+
+static void relocate_values(compactor_t *c, value_t *vals, unsigned length) {
+    if (vals)
+        for (unsigned i = 0; i < length; ++i)
+            relocate_value(c, &vals[i]);
+}
+
+static void relocate_block(compactor_t *c, block_t *block) {
+    switch (BASIC_TAG(block->header)) {
+    case DEVS_GC_TAG_BUFFER:
+        RELOCATE(c, block->buffer.attached);
+        break;
+    case DEVS_GC_TAG_IMAGE:
+        RELOCATE(c, block->image.pix);
+        RELOCATE(c, block->image.buffer);
+        RELOCATE(c, block->image.attached);
+        break;
+    case DEVS_GC_TAG_SHORT_MAP:
+        relocate_values(c, block->short_map.short_data, block->short_map.length);
+        RELOCATE(c, block->short_map.short_data);
+        RELOCATE(c, block->short_map.proto);
+        break;
+    case DEVS_GC_TAG_HALF_STATIC_MAP:
+    case DEVS_GC_TAG_MAP:
+        relocate_values(c, block->map.data, block->map.length * 2);
+        RELOCATE(c, block->map.data);
+        RELOCATE(c, block->map.proto);
+        break;
+    case DEVS_GC_TAG_ARRAY:
+        relocate_values(c, block->array.data, block->array.length);
+        RELOCATE(c, block->array.data);
+        RELOCATE(c, block->array.attached);
+        break;
+    case DEVS_GC_TAG_PACKET:
+        RELOCATE(c, block->pkt.payload);
+        RELOCATE(c, block->pkt.attached);
+        break;
+    case DEVS_GC_TAG_BOUND_FUNCTION:
+        relocate_value(c, &block->bound_function.this_val);
+        relocate_value(c, &block->bound_function.func);
+        break;
+    case DEVS_GC_TAG_STRING_ROPE:
+        relocate_value(c, &block->rope.left);
+        relocate_value(c, &block->rope.right);
+        break;
+    case DEVS_GC_TAG_BUFFER_VIEW:
+        relocate_value(c, &block->buffer_view.parent);
+        RELOCATE(c, block->buffer_view.attached);
+        break;
+    case DEVS_GC_TAG_TYPED_ARRAY:
+        relocate_value(c, &block->typed_array.buffer);
+        RELOCATE(c, block->typed_array.attached);
+        break;
+    case DEVS_GC_TAG_JSON_PARSER:
+        RELOCATE(c, block->json_parser.token);
+        RELOCATE(c, block->json_parser.stack);
+        break;
+    case DEVS_GC_TAG_ACTIVATION:
+        relocate_values(c, block->act.slots, block->act.func->num_slots);
+        RELOCATE(c, block->act.closure);
+        RELOCATE(c, block->act.caller);
+        break;
+    default:
+        break;
+    }
+}
+
+// keep in sync with devs_gc_iter_roots()
+static void relocate_roots(compactor_t *c) {
+    devs_ctx_t *ctx = c->ctx;
+
+    relocate_values(c, ctx->globals, ctx->img.header->num_globals);
+    relocate_values(c, ctx->the_stack, ctx->stack_top_for_gc);
+    relocate_values(c, ctx->roots, ctx->num_roots);
+
+    for (unsigned i = 0; i < ctx->_num_builtin_protos; ++i)
+        RELOCATE(c, ctx->_builtin_protos[i]);
+
+    for (unsigned i = 0; i < ctx->num_roles; ++i) {
+        devs_role_t *r = devs_role(ctx, i);
+        if (r) {
+            relocate_value(c, &r->name);
+            RELOCATE(c, r->attached);
+        }
+    }
+
+    for (unsigned i = 0; i < ctx->num_pins; ++i)
+        relocate_value(c, &ctx->pin_state[i].obj);
+
+    RELOCATE(c, ctx->fn_protos);
+    RELOCATE(c, ctx->fn_values);
+    RELOCATE(c, ctx->spec_protos);
+    relocate_value(c, &ctx->exn_val);
+    relocate_value(c, &ctx->diag_field);
+    for (unsigned i = 0; i < DEVS_INT_STR_CACHE_SIZE; ++i)
+        relocate_value(c, &ctx->int_str_vals[i]);
+
+    RELOCATE(c, ctx->curr_fn);
+    RELOCATE(c, ctx->step_fn);
+
+    for (devs_fiber_t *fib = ctx->fibers; fib; fib = fib->next) {
+        relocate_value(c, &fib->ret_val);
+        if (devs_fiber_uses_pkt_data_v(fib))
+            relocate_value(c, &fib->pkt_data.v);
+        RELOCATE(c, fib->activation);
+    }
+}
+
+static void slide_blocks(compactor_t *c) {
+    devs_gc_t *gc = c->gc;
+    unsigned delta = 0;
+
+    for (block_t *block = c->start; block != c->end;) {
+        uintptr_t header = block->header;
+        unsigned size = block_size(block);
+        block_t *next = next_block(block);
+
+        if (IS_FREE(header)) {
+            delta += size;
+        } else if (is_pinned(header)) {
+            // space collected so far ends up just before the pinned block
+            if (delta)
+                mark_block(gc, (block_t *)(block_ptr(block) - delta), DEVS_GC_TAG_FREE, delta);
+            delta = 0;
+        } else if (delta) {
+            memmove(block_ptr(block) - delta, block, size * sizeof(uintptr_t));
+        }
+
+        block = next;
+    }
+
+    // this also overwrites the break table
+    mark_block(gc, (block_t *)(block_ptr(c->end) - delta), DEVS_GC_TAG_FREE,
+               delta + block_size(c->end));
+}
+
+static void compact_chunk(devs_gc_t *gc, chunk_t *chunk) {
+    compactor_t c = {.gc = gc, .ctx = gc->ctx, .start = chunk->start};
+
+    c.end = find_break_table(chunk);
+    if (!c.end)
+        return;
+    build_break_table(&c);
+    LOG("compact %p-%p, %u breaks", c.start, c.end, c.num_breaks);
+
+    relocate_roots(&c);
+    for (chunk_t *ch = gc->first_chunk; ch; ch = ch->next) {
+        for (block_t *block = ch->start;; block = next_block(block)) {
+            if (GET_TAG(block->header) == DEVS_GC_TAG_FINAL)
+                break;
+            relocate_block(&c, block);
+        }
+    }
+
+    slide_blocks(&c);
+}
+
+static void rebuild_free_list(devs_gc_t *gc) {
+    block_t *prev = NULL;
+    gc->first_free = NULL;
+    for (chunk_t *chunk = gc->first_chunk; chunk; chunk = chunk->next) {
+        for (block_t *block = chunk->start;; block = next_block(block)) {
+            uintptr_t header = block->header;
+            if (GET_TAG(header) == DEVS_GC_TAG_FINAL)
+                break;
+            if (!IS_FREE(header))
+                continue;
+            if (prev == NULL)
+                gc->first_free = block;
+            else
+                prev->free.next = block;
+            block->free.next = NULL;
+            prev = block;
+        }
+    }
+}
+
+void devs_gc_compact(devs_gc_t *gc) {
+    if (gc->ctx == NULL)
+        return;
+
+    // make sure all non-free blocks are live
+    devs_gc(gc);
+    gc->compact_pending = 0;
+
+    for (chunk_t *chunk = gc->first_chunk; chunk; chunk = chunk->next)
+        compact_chunk(gc, chunk);
+    rebuild_free_list(gc);
+    update_free_stats(gc);
+
+    if (devs_get_global_flags() & DEVS_FLAG_GC_STRESS)
+        validate_heap(gc);
+}
+
+void devs_gc_compact_if_needed(devs_ctx_t *ctx) {
+    devs_gc_t *gc = ctx->gc;
+
+    if (!(devs_get_global_flags() & DEVS_FLAG_GC_COMPACT))
+        return;
+
+    if (!gc->compact_pending && !(devs_get_global_flags() & DEVS_FLAG_GC_STRESS))
+        return;
+
+    if (ctx->curr_fiber || ctx->error_code || devs_is_suspended(ctx))
+        return;
+
+    // native code may still hold raw pointers to GC objects
+    for (devs_fiber_t *fib = ctx->fibers; fib; fib = fib->next)
+        if (fib->resume_cb || fib->pkt_kind == DEVS_PKT_KIND_AWAITING)
+            return;
+
+    devs_gc_compact(gc);
 }
 
+#else
+
+void devs_gc_compact(devs_gc_t *gc) {}
+void devs_gc_compact_if_needed(devs_ctx_t *ctx) {}
+
+#endif
+
 static block_t *find_free_block(devs_gc_t *gc, unsigned tag, uint32_t words) {
     block_t *prev = NULL;
     for (block_t *b = gc->first_free; b; prev = b, b = b->free.next) {
@@ -434,6 +1363,10 @@ static block_t *alloc_block(devs_gc_t *gc, unsigned tag, unsigned size) {
         devs_gc(gc);
         b = find_free_block(gc, tag, words);
     }
+#if JD_GC_ELASTIC
+    if (!b && grow_heap(gc, words))
+        b = find_free_block(gc, tag, words);
+#endif
 
     // DMESG("b=%p %p",b,(void*)b->header);
 
@@ -447,6 +1380,8 @@ void *jd_gc_any_try_alloc(devs_gc_t *gc, unsigned tag, uint32_t size) {
     if (!b)
         return NULL;
     memset(b->data, 0x00, size - JD_PTRSIZE);
+    gc->stats.num_alloc[tag & DEVS_GC_TAG_MASK]++;
+    gc->stats.alloc_bytes[tag & DEVS_GC_TAG_MASK] += size;
     LOG("alloc: tag=%s sz=%d -> %p", devs_gc_tag_name(tag), (int)size, b);
     return b;
 }
@@ -455,6 +1390,8 @@ void *devs_any_try_alloc(devs_ctx_t *ctx, unsigned tag, unsigned size) {
     void *r = jd_gc_any_try_alloc(ctx->gc, tag, size);
     if (r == NULL)
         devs_oom(ctx, size);
+    else if (ctx->alloc_prof)
+        devs_alloc_prof_record(ctx, size);
     return r;
 }
 
@@ -483,36 +1420,15 @@ void jd_gc_free(devs_gc_t *gc, void *ptr) {
     if (ptr == NULL)
         return;
     LOG("jd_gc_free %p", (uintptr_t *)ptr - 1);
+    gc->num_free++;
     unpin(gc, ptr, DEVS_GC_TAG_FREE);
 }
 
-bool devs_value_is_pinned(devs_ctx_t *ctx, value_t v) {
-    if (!devs_handle_is_ptr(v))
-        return false;
-    block_t *b = (block_t *)((uintptr_t *)devs_handle_ptr_value(ctx, v));
-    unsigned tag = GET_TAG(b->header);
-    JD_ASSERT((tag & DEVS_GC_TAG_MASK) >= DEVS_GC_TAG_BYTES);
-    return (tag & DEVS_GC_TAG_MASK_PINNED) != 0;
-}
-
-void devs_value_pin(devs_ctx_t *ctx, value_t v) {
-    if (!devs_handle_is_ptr(v))
-        return;
-    block_t *b = (block_t *)((uintptr_t *)devs_handle_ptr_value(ctx, v));
-    unsigned tag = GET_TAG(b->header);
-    JD_ASSERT((tag & DEVS_GC_TAG_MASK_PINNED) == 0);
-    JD_ASSERT((tag & DEVS_GC_TAG_MASK) >= DEVS_GC_TAG_BYTES);
-    b->header |= ((uintptr_t)DEVS_GC_TAG_MASK_PINNED << DEVS_GC_TAG_POS);
-}
-
-void devs_value_unpin(devs_ctx_t *ctx, value_t v) {
-    if (!devs_handle_is_ptr(v))
-        return;
-    block_t *b = (block_t *)((uintptr_t *)devs_handle_ptr_value(ctx, v));
-    unsigned tag = GET_TAG(b->header);
-    JD_ASSERT((tag & DEVS_GC_TAG_MASK_PINNED) != 0);
-    JD_ASSERT((tag & DEVS_GC_TAG_MASK) >= DEVS_GC_TAG_BYTES);
-    b->header &= ~((uintptr_t)DEVS_GC_TAG_MASK_PINNED << DEVS_GC_TAG_POS);
+bool devs_root_in_scope(devs_ctx_t *ctx, unsigned scope, value_t v) {
+    for (unsigned i = scope; i < ctx->num_roots; ++i)
+        if (ctx->roots[i].u64 == v.u64)
+            return true;
+    return false;
 }
 
 devs_map_t *devs_map_try_alloc(devs_ctx_t *ctx, devs_maplike_t *proto) {
@@ -569,6 +1485,66 @@ devs_buffer_t *devs_buffer_try_alloc(devs_ctx_t *ctx, unsigned size) {
     return devs_buffer_try_alloc_init(ctx, NULL, size);
 }
 
+void devs_buffer_shrink(devs_ctx_t *ctx, devs_buffer_t *buf, unsigned size) {
+    JD_ASSERT(size <= buf->length);
+    devs_gc_t *gc = ctx->gc;
+    block_t *b = (block_t *)buf;
+    unsigned words = (sizeof(devs_buffer_t) + size + JD_PTRSIZE - 1) / JD_PTRSIZE;
+    // a free block needs at least two words
+    if (words + 2 <= block_size(b)) {
+        unsigned left = block_size(b) - words;
+        mark_block(gc, b, GET_TAG(b->header), words);
+        block_t *rest = next_block(b);
+        mark_block(gc, rest, DEVS_GC_TAG_FREE, left);
+        rest->free.next = gc->first_free;
+        gc->first_free = rest;
+    }
+    buf->length = size;
+}
+
+devs_buffer_view_t *devs_buffer_view_try_alloc(devs_ctx_t *ctx, value_t parent, unsigned offset,
+                                               unsigned length) {
+    devs_buffer_view_t *pview = devs_value_to_gc_obj(ctx, parent);
+    if (devs_gc_tag(pview) == DEVS_GC_TAG_BUFFER_VIEW) {
+        offset += pview->offset;
+        parent = pview->parent;
+    }
+
+    unsigned scope = devs_root_scope(ctx);
+    devs_root_push(ctx, parent);
+    devs_buffer_view_t *view =
+        devs_any_try_alloc(ctx, DEVS_GC_TAG_BUFFER_VIEW, sizeof(devs_buffer_view_t));
+    if (view) {
+        view->length = length;
+        view->offset = offset;
+        view->parent = parent;
+    }
+    devs_root_pop(ctx, scope);
+    return view;
+}
+
+devs_typed_array_t *devs_typed_array_try_alloc(devs_ctx_t *ctx, unsigned kind, value_t buffer,
+                                               unsigned offset, unsigned length) {
+    devs_buffer_view_t *pview = devs_value_to_gc_obj(ctx, buffer);
+    if (devs_gc_tag(pview) == DEVS_GC_TAG_BUFFER_VIEW) {
+        offset += pview->offset;
+        buffer = pview->parent;
+    }
+
+    unsigned scope = devs_root_scope(ctx);
+    devs_root_push(ctx, buffer);
+    devs_typed_array_t *arr =
+        devs_any_try_alloc(ctx, DEVS_GC_TAG_TYPED_ARRAY, sizeof(devs_typed_array_t));
+    if (arr) {
+        arr->length = length;
+        arr->offset = offset;
+        arr->kind = kind;
+        arr->buffer = buffer;
+    }
+    devs_root_pop(ctx, scope);
+    return arr;
+}
+
 devs_string_t *devs_string_try_alloc(devs_ctx_t *ctx, unsigned size) {
     if (size > DEVS_MAX_ALLOC) {
         devs_throw_too_big_error(ctx, DEVS_BUILTIN_STRING_STRING);
@@ -598,7 +1574,7 @@ devs_string_jmp_t *devs_string_jmp_try_alloc(devs_ctx_t *ctx, unsigned size, uns
     return buf;
 }
 
-char *devs_string_prep(devs_ctx_t *ctx, value_t *v, unsigned sz, unsigned len) {
+char *devs_string_prep(devs_ctx_t *ctx, value_t *v, unsigned sz, unsigned len, unsigned *scope) {
     char *r;
     if (len == sz && sz < DEVS_MAX_ASCII_STRING) {
         devs_string_t *s = devs_string_try_alloc(ctx, sz);
@@ -610,11 +1586,14 @@ char *devs_string_prep(devs_ctx_t *ctx, value_t *v, unsigned sz, unsigned len) {
         r = s ? (char *)devs_utf8_string_data(&s->inner) : NULL;
     }
 
-    devs_value_pin(ctx, *v);
+    // popped in devs_string_finish()
+    *scope = devs_root_scope(ctx);
+    if (r)
+        devs_root_push(ctx, *v);
     return r;
 }
 
-void devs_string_finish(devs_ctx_t *ctx, value_t *v, unsigned sz, unsigned len) {
+void devs_string_finish(devs_ctx_t *ctx, value_t *v, unsigned sz, unsigned len, unsigned scope) {
     void *p = devs_value_to_gc_obj(ctx, *v);
     unsigned tag = devs_gc_tag(p);
     if (tag == DEVS_GC_TAG_STRING) {
@@ -630,7 +1609,7 @@ void devs_string_finish(devs_ctx_t *ctx, value_t *v, unsigned sz, unsigned len)
     } else {
         JD_PANIC();
     }
-    devs_value_unpin(ctx, *v);
+    devs_root_pop(ctx, scope);
 }
 
 devs_any_string_t *devs_string_try_alloc_init(devs_ctx_t *ctx, const char *str, unsigned size) {
@@ -667,7 +1646,12 @@ static const char *tags[] = {
     "half_static_map", //
     "short_map",       //
     "packet",          //
-    "string_jmp"       //
+    "string_jmp",      //
+    "image",           //
+    "string_rope",     //
+    "buffer_view",     //
+    "typed_array",     //
+    "json_parser",     //
 };
 
 const char *devs_gc_tag_name(unsigned tag) {
@@ -729,6 +1713,12 @@ devs_gc_t *devs_gc_create(void) {
         global_gc = jd_alloc(global_gc_size);
     }
     gc = global_gc;
+#elif JD_GC_ELASTIC && JD_64
+    gc = jd_alloc(sizeof(devs_gc_t));
+    gc->reserve_top = devs_gc_host_reserve(JD_GC_MAX_KB * 1024);
+    gc->reserve_end = gc->reserve_top + JD_GC_MAX_KB * 1024;
+    devs_gc_add_chunk(gc, chunk_mem_alloc(gc, size), size);
+    return gc;
 #else
     gc = jd_alloc(sizeof(devs_gc_t) + size);
 #endif
@@ -741,7 +1731,18 @@ void devs_gc_destroy(devs_gc_t *gc) {
 #if JD_GC_KEEP
     memset(gc, 0, global_gc_size);
 #else
+#if JD_GC_ELASTIC && JD_64
+    // the first chunk is at the start of the reservation
+    devs_gc_host_release(gc->first_chunk);
+#elif JD_GC_ELASTIC
+    // the first chunk was allocated together with gc
+    while (gc->first_chunk->next)
+        release_chunk(gc, gc->first_chunk->next);
+#endif
     gc->first_chunk = NULL;
+#if JD_GC_PARALLEL
+    jd_free(gc->mark_deques);
+#endif
     jd_free(gc);
 #endif
 }
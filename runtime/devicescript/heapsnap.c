@@ -0,0 +1,797 @@
+#include "devs_internal.h"
+
+// Writer for Chrome DevTools .heapsnapshot files.
+// The output is generated lazily, in small pieces, so that it can be streamed over a pipe
+// without ever holding the whole JSON in memory. Reading fails if the heap changes after start().
+
+#define NODE_FIELDS 6
+
+// every INDEX_STEP-th object is kept in an index, to find node numbers of edge targets
+#define INDEX_STEP 32
+
+// synthetic nodes: root, (GC roots), and one per kind of GC root
+#define SYNTH_ROOT 0
+#define SYNTH_GC_ROOTS 1
+#define SYNTH_KIND0 2
+#define NUM_SYNTH (SYNTH_KIND0 + DEVS_GC_ROOT___MAX + 1)
+
+// node_types and edge_types, as listed in HEADER below
+#define NT_HIDDEN 0
+#define NT_STRING 2
+#define NT_OBJECT 3
+#define NT_CLOSURE 5
+#define NT_NATIVE 8
+#define NT_SYNTHETIC 9
+#define NT_CONS_STRING 10
+
+#define ET_ELEMENT 1
+#define ET_PROPERTY 2
+#define ET_INTERNAL 3
+#define ET_HIDDEN 4
+
+enum {
+    S_EMPTY,
+    S_GC_ROOTS,
+    S_ROOT_KIND0,
+    S_ARRAY = S_ROOT_KIND0 + DEVS_GC_ROOT___MAX + 1,
+    S_OBJECT,
+    S_SHORT_MAP,
+    S_BUFFER,
+    S_IMAGE,
+    S_TYPED_ARRAY,
+    S_JSON_PARSER,
+    S_PACKET,
+    S_BOUND_FUNCTION,
+    S_BYTES,
+    S_PROTO,
+    S_ELEMENTS,
+    S_PROPERTIES,
+    S_ATTACHED,
+    S_PAYLOAD,
+    S_THIS,
+    S_FUNC,
+    S_CLOSURE,
+    S_ROPE,
+    S_FIRST,
+    S_SECOND,
+    S_TOKEN,
+    S_STACK,
+    S__COUNT
+};
+
+static const char *const const_strings[S__COUNT] = {
+    [S_EMPTY] = "",
+    [S_GC_ROOTS] = "(GC roots)",
+    [S_ROOT_KIND0 + DEVS_GC_ROOT_GLOBALS] = "(globals)",
+    [S_ROOT_KIND0 + DEVS_GC_ROOT_STACK] = "(stack)",
+    [S_ROOT_KIND0 + DEVS_GC_ROOT_BUILTINS] = "(builtin objects)",
+    [S_ROOT_KIND0 + DEVS_GC_ROOT_ROLES] = "(roles)",
+    [S_ROOT_KIND0 + DEVS_GC_ROOT_PINS] = "(pins)",
+    [S_ROOT_KIND0 + DEVS_GC_ROOT_INTERNAL] = "(internal)",
+    [S_ROOT_KIND0 + DEVS_GC_ROOT_FIBERS] = "(fibers)",
+    [S_ROOT_KIND0 + DEVS_GC_ROOT_SCOPES] = "(handle scopes)",
+    [S_ARRAY] = "Array",
+    [S_OBJECT] = "Object",
+    [S_SHORT_MAP] = "(short map)",
+    [S_BUFFER] = "Buffer",
+    [S_IMAGE] = "Image",
+    [S_TYPED_ARRAY] = "TypedArray",
+    [S_JSON_PARSER] = "JSONParser",
+    [S_PACKET] = "Packet",
+    [S_BOUND_FUNCTION] = "(bound function)",
+    [S_BYTES] = "(bytes)",
+    [S_PROTO] = "__proto__",
+    [S_ELEMENTS] = "elements",
+    [S_PROPERTIES] = "properties",
+    [S_ATTACHED] = "attached",
+    [S_PAYLOAD] = "payload",
+    [S_THIS] = "this",
+    [S_FUNC] = "func",
+    [S_CLOSURE] = "closure",
+    [S_ROPE] = "(concatenated string)",
+    [S_FIRST] = "first",
+    [S_SECOND] = "second",
+    [S_TOKEN] = "token",
+    [S_STACK] = "stack",
+};
+
+static const char HEADER[] =
+    "{\"snapshot\":{\"meta\":{"
+    "\"node_fields\":[\"type\",\"name\",\"id\",\"self_size\",\"edge_count\",\"trace_node_id\"],"
+    "\"node_types\":[[\"hidden\",\"array\",\"string\",\"object\",\"code\",\"closure\",\"regexp\","
+    "\"number\",\"native\",\"synthetic\",\"concatenated string\",\"sliced string\",\"symbol\","
+    "\"bigint\"],\"string\",\"number\",\"number\",\"number\",\"number\"],"
+    "\"edge_fields\":[\"type\",\"name_or_index\",\"to_node\"],"
+    "\"edge_types\":[[\"context\",\"element\",\"property\",\"internal\",\"hidden\",\"shortcut\","
+    "\"weak\"],\"string_or_number\",\"node\"],"
+    "\"trace_function_info_fields\":[\"function_id\",\"name\",\"script_name\",\"script_id\","
+    "\"line\",\"column\"],"
+    "\"trace_node_fields\":[\"id\",\"function_info_index\",\"count\",\"size\",\"children\"],"
+    "\"sample_fields\":[\"timestamp_us\",\"last_assigned_id\"],"
+    "\"location_fields\":[\"object_index\",\"script_id\",\"line\",\"column\"]},";
+
+static const char EDGES_HEADER[] = "],\n\"edges\":[";
+static const char STRINGS_HEADER[] = "],\n\"trace_function_infos\":[],\"trace_tree\":[],"
+                                     "\"samples\":[],\"locations\":[],\n\"strings\":[";
+static const char FOOTER[] = "]}\n";
+
+enum {
+    PH_HEADER,
+    PH_COUNTS,
+    PH_NODES_HEADER,
+    PH_SYNTH_NODES,
+    PH_NODES,
+    PH_EDGES_HEADER,
+    PH_SYNTH_EDGES,
+    PH_EDGES,
+    PH_STRINGS_HEADER,
+    PH_CONST_STRINGS,
+    PH_NODE_STRINGS,
+    PH_EDGE_STRINGS,
+    PH_FOOTER,
+    PH_DONE,
+};
+
+typedef struct {
+    uint8_t type;
+    uint8_t named; // name is dynamic string from key
+    uint32_t name_or_index;
+    void *to;
+    value_t key;
+} edge_t;
+
+struct devs_heapsnap {
+    devs_ctx_t *ctx;
+    void **index;
+    unsigned index_len;
+
+    uint32_t num_objs;
+    uint32_t num_edges;
+    uint32_t num_node_strings;
+    uint32_t root_counts[DEVS_GC_ROOT___MAX + 1];
+    // heap objects directly referenced by GC roots, grouped by kind
+    void **roots;
+    uint32_t heap_version;
+
+    uint8_t phase;
+    uint8_t need_comma;
+    uint8_t src_escape;
+    uint8_t tok_len;
+    uint8_t tok_pos;
+
+    // cursor
+    uint16_t synth;
+    uint32_t pos;
+    uint32_t root_pos;
+    void *obj;
+    uint32_t str_idx;
+
+    // pending output
+    const char *src;
+    unsigned src_len;
+    char tok[64];
+};
+
+static inline devs_gc_object_t *bytes_block(void *data) {
+    return data ? (devs_gc_object_t *)((uintptr_t *)data - 1) : NULL;
+}
+
+static inline unsigned obj_tag(void *obj) {
+    return devs_gc_tag(obj) & DEVS_GC_TAG_MASK;
+}
+
+static bool ptr_edge(devs_heapsnap_t *snap, edge_t *e, unsigned type, unsigned name, void *to) {
+    if (!to || !devs_gc_is_heap_ptr(snap->ctx->gc, to))
+        return false;
+    e->type = type;
+    e->named = 0;
+    e->name_or_index = name;
+    e->to = to;
+    return true;
+}
+
+static bool value_edge(devs_heapsnap_t *snap, edge_t *e, unsigned type, unsigned name, value_t v) {
+    if (!devs_handle_is_ptr(v))
+        return false;
+    return ptr_edge(snap, e, type, name, devs_handle_ptr_value(snap->ctx, v));
+}
+
+// finds the next edge of obj at or after slot *pos
+static bool next_edge(devs_heapsnap_t *snap, void *obj, uint32_t *pos, edge_t *e) {
+    for (;;) {
+        uint32_t p = (*pos)++;
+        bool ok = false;
+
+        switch (obj_tag(obj)) {
+        case DEVS_GC_TAG_ARRAY: {
+            devs_array_t *arr = obj;
+            if (p == 0)
+                ok = ptr_edge(snap, e, ET_INTERNAL, S_ELEMENTS, bytes_block(arr->data));
+            else if (p == 1)
+                ok = ptr_edge(snap, e, ET_INTERNAL, S_ATTACHED, arr->attached);
+            else if (p - 2 < arr->length)
+                ok = value_edge(snap, e, ET_ELEMENT, p - 2, arr->data[p - 2]);
+            else
+                return false;
+            break;
+        }
+        case DEVS_GC_TAG_MAP:
+        case DEVS_GC_TAG_HALF_STATIC_MAP: {
+            devs_map_t *map = obj;
+            if (p == 0)
+                ok = ptr_edge(snap, e, ET_PROPERTY, S_PROTO, (void *)map->proto);
+            else if (p == 1)
+                ok = ptr_edge(snap, e, ET_INTERNAL, S_PROPERTIES, bytes_block(map->data));
+            else if (p - 2 < 2U * map->length) {
+                unsigned i = (p - 2) / 2;
+                if ((p - 2) & 1) {
+                    // keys are only retained, they do not need names
+                    ok = value_edge(snap, e, ET_HIDDEN, i, map->data[2 * i]);
+                } else {
+                    ok = value_edge(snap, e, ET_PROPERTY, 0, map->data[2 * i + 1]);
+                    if (ok) {
+                        e->named = 1;
+                        e->key = map->data[2 * i];
+                    }
+                }
+            } else
+                return false;
+            break;
+        }
+        case DEVS_GC_TAG_SHORT_MAP: {
+            devs_short_map_t *map = obj;
+            if (p == 0)
+                ok = ptr_edge(snap, e, ET_PROPERTY, S_PROTO, (void *)map->proto);
+            else if (p == 1)
+                ok = ptr_edge(snap, e, ET_INTERNAL, S_PROPERTIES, bytes_block(map->short_data));
+            else if (p - 2 < map->length) {
+                uint16_t *keys = (uint16_t *)(map->short_data + map->capacity);
+                ok = value_edge(snap, e, ET_ELEMENT, keys[p - 2], map->short_data[p - 2]);
+            } else
+                return false;
+            break;
+        }
+        case DEVS_GC_TAG_BUFFER:
+            if (p == 0)
+                ok = ptr_edge(snap, e, ET_INTERNAL, S_ATTACHED, ((devs_buffer_t *)obj)->attached);
+            else
+                return false;
+            break;
+        case DEVS_GC_TAG_BUFFER_VIEW: {
+            devs_buffer_view_t *view = obj;
+            if (p == 0)
+                ok = value_edge(snap, e, ET_INTERNAL, S_BUFFER, view->parent);
+            else if (p == 1)
+                ok = ptr_edge(snap, e, ET_INTERNAL, S_ATTACHED, view->attached);
+            else
+                return false;
+            break;
+        }
+        case DEVS_GC_TAG_TYPED_ARRAY: {
+            devs_typed_array_t *arr = obj;
+            if (p == 0)
+                ok = value_edge(snap, e, ET_INTERNAL, S_BUFFER, arr->buffer);
+            else if (p == 1)
+                ok = ptr_edge(snap, e, ET_INTERNAL, S_ATTACHED, arr->attached);
+            else
+                return false;
+            break;
+        }
+        case DEVS_GC_TAG_JSON_PARSER: {
+            devs_json_parser_t *parser = obj;
+            if (p == 0)
+                ok = ptr_edge(snap, e, ET_INTERNAL, S_TOKEN, parser->token);
+            else if (p == 1)
+                ok = ptr_edge(snap, e, ET_INTERNAL, S_STACK, parser->stack);
+            else
+                return false;
+            break;
+        }
+        case DEVS_GC_TAG_IMAGE: {
+            devs_gimage_t *img = obj;
+            if (p == 0)
+                ok = ptr_edge(snap, e, ET_INTERNAL, S_BUFFER, img->buffer);
+            else if (p == 1)
+                ok = ptr_edge(snap, e, ET_INTERNAL, S_ATTACHED, img->attached);
+            else
+                return false;
+            break;
+        }
+        case DEVS_GC_TAG_PACKET: {
+            devs_packet_t *pkt = obj;
+            if (p == 0)
+                ok = ptr_edge(snap, e, ET_INTERNAL, S_PAYLOAD, pkt->payload);
+            else if (p == 1)
+                ok = ptr_edge(snap, e, ET_INTERNAL, S_ATTACHED, pkt->attached);
+            else
+                return false;
+            break;
+        }
+        case DEVS_GC_TAG_BOUND_FUNCTION: {
+            devs_bound_function_t *bf = obj;
+            if (p == 0)
+                ok = value_edge(snap, e, ET_INTERNAL, S_THIS, bf->this_val);
+            else if (p == 1)
+                ok = value_edge(snap, e, ET_INTERNAL, S_FUNC, bf->func);
+            else
+                return false;
+            break;
+        }
+        case DEVS_GC_TAG_STRING_ROPE: {
+            devs_string_rope_t *rope = obj;
+            if (p == 0)
+                ok = value_edge(snap, e, ET_INTERNAL, S_FIRST, rope->left);
+            else if (p == 1)
+                ok = value_edge(snap, e, ET_INTERNAL, S_SECOND, rope->right);
+            else
+                return false;
+            break;
+        }
+        case DEVS_GC_TAG_ACTIVATION: {
+            devs_activation_t *act = obj;
+            if (p == 0)
+                ok = ptr_edge(snap, e, ET_INTERNAL, S_CLOSURE, act->closure);
+            else if (p - 1 < act->func->num_slots)
+                ok = value_edge(snap, e, ET_ELEMENT, p - 1, act->slots[p - 1]);
+            else
+                return false;
+            break;
+        }
+        default:
+            return false;
+        }
+
+        if (ok)
+            return true;
+    }
+}
+
+static unsigned num_edges(devs_heapsnap_t *snap, void *obj) {
+    edge_t e;
+    uint32_t pos = 0;
+    unsigned n = 0;
+    while (next_edge(snap, obj, &pos, &e))
+        n++;
+    return n;
+}
+
+// node with a dynamic name (string contents or function name)
+static bool has_name(void *obj) {
+    unsigned tag = obj_tag(obj);
+    return tag == DEVS_GC_TAG_STRING || tag == DEVS_GC_TAG_STRING_JMP ||
+           tag == DEVS_GC_TAG_ACTIVATION;
+}
+
+static const char *node_name(devs_heapsnap_t *snap, void *obj, unsigned *len) {
+    if (obj_tag(obj) == DEVS_GC_TAG_ACTIVATION) {
+        devs_activation_t *act = obj;
+        int idx = act->func - devs_img_get_function(snap->ctx->img, 0);
+        const char *r = devs_img_fun_name(snap->ctx->img, idx);
+        *len = strlen(r);
+        return r;
+    }
+    const char *r = devs_string_get_utf8(snap->ctx, devs_value_from_gc_obj(snap->ctx, obj), len);
+    if (!r) {
+        *len = 0;
+        r = "";
+    }
+    return r;
+}
+
+static uint32_t node_index(devs_heapsnap_t *snap, void *obj) {
+    unsigned l = 0, r = snap->index_len;
+    while (r - l > 1) {
+        unsigned m = (l + r) / 2;
+        if (snap->index[m] <= obj)
+            l = m;
+        else
+            r = m;
+    }
+    uint32_t idx = l * INDEX_STEP;
+    for (void *p = snap->index[l]; p != obj; p = devs_gc_next_obj(snap->ctx->gc, p)) {
+        JD_ASSERT(p != NULL);
+        idx++;
+    }
+    return NUM_SYNTH + idx;
+}
+
+static void count_root(devs_ctx_t *ctx, void *userdata, unsigned kind, void *obj) {
+    devs_heapsnap_t *snap = userdata;
+    if (devs_gc_is_heap_ptr(ctx->gc, obj))
+        snap->root_counts[kind]++;
+}
+
+typedef struct {
+    void **roots;
+    uint32_t next[DEVS_GC_ROOT___MAX + 1];
+} root_fill_t;
+
+static void add_root(devs_ctx_t *ctx, void *userdata, unsigned kind, void *obj) {
+    root_fill_t *f = userdata;
+    if (devs_gc_is_heap_ptr(ctx->gc, obj))
+        f->roots[f->next[kind]++] = obj;
+}
+
+devs_heapsnap_t *devs_heapsnap_start(devs_ctx_t *ctx) {
+    devs_gc_t *gc = ctx->gc;
+
+    // don't report garbage
+    devs_gc_collect(gc);
+
+    // With JD_GC_ALLOC, jd_alloc() takes blocks from the GC heap, so everything is allocated
+    // before the heap is walked and counted; the walk then sees these blocks too.
+    devs_heapsnap_t *snap = jd_alloc(sizeof(*snap));
+    snap->ctx = ctx;
+
+    devs_gc_iter_roots(ctx, count_root, snap);
+    root_fill_t fill;
+    unsigned num_roots = 0;
+    for (unsigned k = 0; k <= DEVS_GC_ROOT___MAX; ++k) {
+        fill.next[k] = num_roots;
+        num_roots += snap->root_counts[k];
+    }
+    snap->roots = fill.roots = jd_alloc(sizeof(void *) * (num_roots + 1));
+    devs_gc_iter_roots(ctx, add_root, &fill);
+
+    unsigned n = 0;
+    for (void *p = devs_gc_first_obj(gc); p; p = devs_gc_next_obj(gc, p))
+        n++;
+    // room for one more object - the index itself
+    unsigned index_size = (n + 1) / INDEX_STEP + 1;
+    snap->index = jd_alloc(sizeof(void *) * index_size);
+
+    for (void *p = devs_gc_first_obj(gc); p; p = devs_gc_next_obj(gc, p)) {
+        if (snap->num_objs % INDEX_STEP == 0) {
+            JD_ASSERT(snap->index_len < index_size);
+            snap->index[snap->index_len++] = p;
+        }
+        snap->num_objs++;
+        snap->num_edges += num_edges(snap, p);
+        if (has_name(p))
+            snap->num_node_strings++;
+    }
+    // any allocation from here on makes read() fail
+    snap->heap_version = devs_gc_heap_version(gc);
+
+    snap->num_edges += 1 + DEVS_GC_ROOT___MAX + 1 + num_roots;
+
+    return snap;
+}
+
+void devs_heapsnap_free(devs_heapsnap_t *snap) {
+    if (snap) {
+        jd_free(snap->index);
+        jd_free(snap->roots);
+        jd_free(snap);
+    }
+}
+
+static void set_src(devs_heapsnap_t *snap, const char *src, unsigned len, bool escape) {
+    snap->src = src;
+    snap->src_len = len;
+    snap->src_escape = escape;
+}
+
+static void set_const(devs_heapsnap_t *snap, const char *src, unsigned len) {
+    set_src(snap, src, len, false);
+}
+
+// start next array element
+static unsigned comma(devs_heapsnap_t *snap) {
+    if (snap->need_comma) {
+        snap->tok[0] = ',';
+        return 1;
+    }
+    snap->need_comma = 1;
+    return 0;
+}
+
+static void emit_node(devs_heapsnap_t *snap, unsigned type, unsigned name, unsigned id,
+                      unsigned size, unsigned nedges) {
+    unsigned p = comma(snap);
+    jd_sprintf(snap->tok + p, sizeof(snap->tok) - p, "%u,%u,%u,%u,%u,0\n", type, name, id, size,
+               nedges);
+    snap->tok_len = p + strlen(snap->tok + p);
+}
+
+static void emit_edge(devs_heapsnap_t *snap, unsigned type, unsigned name, unsigned to) {
+    unsigned p = comma(snap);
+    jd_sprintf(snap->tok + p, sizeof(snap->tok) - p, "%u,%u,%u\n", type, name, to * NODE_FIELDS);
+    snap->tok_len = p + strlen(snap->tok + p);
+}
+
+static void emit_string(devs_heapsnap_t *snap, const char *s, unsigned len) {
+    // the opening quote goes in tok, the closing one is added after src is done
+    unsigned p = comma(snap);
+    snap->tok[p++] = '"';
+    snap->tok_len = p;
+    set_src(snap, s, len, true);
+}
+
+static void obj_node(devs_heapsnap_t *snap, void *obj) {
+    unsigned type = NT_OBJECT;
+    unsigned name = S_OBJECT;
+    switch (obj_tag(obj)) {
+    case DEVS_GC_TAG_ARRAY:
+        name = S_ARRAY;
+        break;
+    case DEVS_GC_TAG_SHORT_MAP:
+        type = NT_HIDDEN;
+        name = S_SHORT_MAP;
+        break;
+    case DEVS_GC_TAG_BUFFER:
+    case DEVS_GC_TAG_BUFFER_VIEW:
+        type = NT_NATIVE;
+        name = S_BUFFER;
+        break;
+    case DEVS_GC_TAG_IMAGE:
+        type = NT_NATIVE;
+        name = S_IMAGE;
+        break;
+    case DEVS_GC_TAG_TYPED_ARRAY:
+        type = NT_NATIVE;
+        name = S_TYPED_ARRAY;
+        break;
+    case DEVS_GC_TAG_JSON_PARSER:
+        type = NT_NATIVE;
+        name = S_JSON_PARSER;
+        break;
+    case DEVS_GC_TAG_PACKET:
+        name = S_PACKET;
+        break;
+    case DEVS_GC_TAG_BOUND_FUNCTION:
+        type = NT_CLOSURE;
+        name = S_BOUND_FUNCTION;
+        break;
+    case DEVS_GC_TAG_BYTES:
+        type = NT_HIDDEN;
+        name = S_BYTES;
+        break;
+    case DEVS_GC_TAG_ACTIVATION:
+        type = NT_CLOSURE;
+        name = S__COUNT + snap->str_idx++;
+        break;
+    case DEVS_GC_TAG_STRING:
+    case DEVS_GC_TAG_STRING_JMP:
+        type = NT_STRING;
+        name = S__COUNT + snap->str_idx++;
+        break;
+    case DEVS_GC_TAG_STRING_ROPE:
+        // not flattened here, as that would allocate
+        type = NT_CONS_STRING;
+        name = S_ROPE;
+        break;
+    }
+    unsigned idx = node_index(snap, obj);
+    emit_node(snap, type, name, 2 * idx + 1,
+              ((devs_gc_object_t *)obj)->size * sizeof(uintptr_t), num_edges(snap, obj));
+}
+
+// advance to next object, or switch to given phase when done
+static void next_obj(devs_heapsnap_t *snap, unsigned next_phase) {
+    snap->obj = devs_gc_next_obj(snap->ctx->gc, snap->obj);
+    snap->pos = 0;
+    if (!snap->obj)
+        snap->phase = next_phase;
+}
+
+static void first_obj(devs_heapsnap_t *snap, unsigned phase, unsigned empty_phase) {
+    snap->obj = devs_gc_first_obj(snap->ctx->gc);
+    snap->pos = 0;
+    snap->phase = snap->obj ? phase : empty_phase;
+}
+
+// produce next piece of output; returns false when done
+static bool step(devs_heapsnap_t *snap) {
+    edge_t e;
+
+    switch (snap->phase) {
+    case PH_HEADER:
+        set_const(snap, HEADER, sizeof(HEADER) - 1);
+        snap->phase = PH_COUNTS;
+        break;
+
+    case PH_COUNTS:
+        jd_sprintf(snap->tok, sizeof(snap->tok), "\"node_count\":%u,\"edge_count\":%u,",
+                   (unsigned)(NUM_SYNTH + snap->num_objs), (unsigned)snap->num_edges);
+        snap->tok_len = strlen(snap->tok);
+        snap->phase = PH_NODES_HEADER;
+        break;
+
+    case PH_NODES_HEADER:
+        set_const(snap, "\"trace_function_count\":0},\n\"nodes\":[", 36);
+        snap->phase = PH_SYNTH_NODES;
+        snap->synth = 0;
+        snap->need_comma = 0;
+        break;
+
+    case PH_SYNTH_NODES:
+        if (snap->synth == SYNTH_ROOT)
+            emit_node(snap, NT_SYNTHETIC, S_EMPTY, 1, 0, 1);
+        else if (snap->synth == SYNTH_GC_ROOTS)
+            emit_node(snap, NT_SYNTHETIC, S_GC_ROOTS, 3, 0, DEVS_GC_ROOT___MAX + 1);
+        else {
+            unsigned k = snap->synth - SYNTH_KIND0;
+            emit_node(snap, NT_SYNTHETIC, S_ROOT_KIND0 + k, 2 * snap->synth + 1, 0,
+                      snap->root_counts[k]);
+        }
+        if (++snap->synth == NUM_SYNTH)
+            first_obj(snap, PH_NODES, PH_EDGES_HEADER);
+        break;
+
+    case PH_NODES:
+        obj_node(snap, snap->obj);
+        next_obj(snap, PH_EDGES_HEADER);
+        break;
+
+    case PH_EDGES_HEADER:
+        set_const(snap, EDGES_HEADER, sizeof(EDGES_HEADER) - 1);
+        snap->phase = PH_SYNTH_EDGES;
+        snap->synth = 0;
+        snap->pos = 0;
+        snap->root_pos = 0;
+        snap->need_comma = 0;
+        snap->str_idx = snap->num_node_strings;
+        break;
+
+    case PH_SYNTH_EDGES:
+        if (snap->synth == SYNTH_ROOT) {
+            emit_edge(snap, ET_ELEMENT, 1, SYNTH_GC_ROOTS);
+            snap->synth++;
+        } else if (snap->synth == SYNTH_GC_ROOTS) {
+            emit_edge(snap, ET_ELEMENT, snap->pos + 1, SYNTH_KIND0 + snap->pos);
+            if (++snap->pos > DEVS_GC_ROOT___MAX) {
+                snap->pos = 0;
+                snap->synth++;
+            }
+        } else {
+            unsigned k = snap->synth - SYNTH_KIND0;
+            if (snap->pos < snap->root_counts[k]) {
+                // roots are emitted in the order they were collected
+                void *obj = snap->roots[snap->root_pos++];
+                emit_edge(snap, ET_ELEMENT, snap->pos, node_index(snap, obj));
+                snap->pos++;
+            } else {
+                snap->pos = 0;
+                if (++snap->synth == NUM_SYNTH)
+                    first_obj(snap, PH_EDGES, PH_STRINGS_HEADER);
+            }
+        }
+        break;
+
+    case PH_EDGES:
+        if (next_edge(snap, snap->obj, &snap->pos, &e)) {
+            unsigned name = e.named ? S__COUNT + snap->str_idx++ : e.name_or_index;
+            emit_edge(snap, e.type, name, node_index(snap, e.to));
+        } else {
+            next_obj(snap, PH_STRINGS_HEADER);
+        }
+        break;
+
+    case PH_STRINGS_HEADER:
+        set_const(snap, STRINGS_HEADER, sizeof(STRINGS_HEADER) - 1);
+        snap->phase = PH_CONST_STRINGS;
+        snap->pos = 0;
+        snap->need_comma = 0;
+        break;
+
+    case PH_CONST_STRINGS:
+        emit_string(snap, const_strings[snap->pos], strlen(const_strings[snap->pos]));
+        if (++snap->pos == S__COUNT)
+            first_obj(snap, PH_NODE_STRINGS, PH_FOOTER);
+        break;
+
+    case PH_NODE_STRINGS:
+        if (has_name(snap->obj)) {
+            unsigned len;
+            const char *s = node_name(snap, snap->obj, &len);
+            emit_string(snap, s, len);
+        }
+        next_obj(snap, PH_EDGE_STRINGS);
+        if (snap->phase == PH_EDGE_STRINGS)
+            first_obj(snap, PH_EDGE_STRINGS, PH_FOOTER);
+        break;
+
+    case PH_EDGE_STRINGS:
+        if (next_edge(snap, snap->obj, &snap->pos, &e)) {
+            if (e.named) {
+                unsigned len;
+                const char *s = devs_string_get_utf8(snap->ctx, e.key, &len);
+                if (!s) {
+                    s = "";
+                    len = 0;
+                }
+                emit_string(snap, s, len);
+            }
+        } else {
+            next_obj(snap, PH_FOOTER);
+        }
+        break;
+
+    case PH_FOOTER:
+        set_const(snap, FOOTER, sizeof(FOOTER) - 1);
+        snap->phase = PH_DONE;
+        break;
+
+    case PH_DONE:
+        return false;
+    }
+
+    return true;
+}
+
+// JSON-escape some of src into tok
+static void escape_src(devs_heapsnap_t *snap) {
+    unsigned p = 0;
+    while (snap->src_len && p < sizeof(snap->tok) - 8) {
+        uint8_t c = *snap->src++;
+        snap->src_len--;
+        if (c == '"' || c == '\\') {
+            snap->tok[p++] = '\\';
+            snap->tok[p++] = c;
+        } else if (c < 0x20) {
+            memcpy(snap->tok + p, "\\u00", 4);
+            snap->tok[p + 4] = "0123456789abcdef"[c >> 4];
+            snap->tok[p + 5] = "0123456789abcdef"[c & 0xf];
+            p += 6;
+        } else {
+            snap->tok[p++] = c;
+        }
+    }
+    if (!snap->src_len) {
+        snap->tok[p++] = '"';
+        snap->src_escape = 0;
+    }
+    snap->tok_len = p;
+}
+
+int devs_heapsnap_read(devs_heapsnap_t *snap, void *dst, unsigned size) {
+    uint8_t *d = dst;
+    unsigned r = 0;
+
+    // node numbers and root lists computed in start() would no longer match the heap
+    if (devs_gc_heap_version(snap->ctx->gc) != snap->heap_version)
+        return -1;
+
+    while (r < size) {
+        if (snap->tok_pos < snap->tok_len) {
+            unsigned n = snap->tok_len - snap->tok_pos;
+            if (n > size - r)
+                n = size - r;
+            memcpy(d + r, snap->tok + snap->tok_pos, n);
+            snap->tok_pos += n;
+            r += n;
+            continue;
+        }
+
+        snap->tok_pos = snap->tok_len = 0;
+
+        if (snap->src_len) {
+            if (snap->src_escape) {
+                escape_src(snap);
+            } else {
+                unsigned n = snap->src_len;
+                if (n > size - r)
+                    n = size - r;
+                memcpy(d + r, snap->src, n);
+                snap->src += n;
+                snap->src_len -= n;
+                r += n;
+            }
+            continue;
+        }
+
+        if (snap->src_escape) {
+            // empty string - still needs the closing quote
+            snap->src_escape = 0;
+            snap->tok[0] = '"';
+            snap->tok_len = 1;
+            continue;
+        }
+
+        if (!step(snap))
+            break;
+    }
+
+    return r;
+}
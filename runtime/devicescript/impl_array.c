@@ -127,63 +127,25 @@ void meth1_Array_join(devs_ctx_t *ctx) {
     if (!self)
         return;
 
+    unsigned scope = devs_root_scope(ctx);
     value_t sep = devs_arg(ctx, 0);
-    unsigned sepsz;
-    unsigned seplen;
-    const char *sepch;
-    if (devs_is_undefined(sep)) {
-        seplen = sepsz = 1;
-        sepch = ",";
-    } else {
-        sep = devs_value_to_string(ctx, sep);
-        sepch = devs_string_get_utf8(ctx, sep, &sepsz);
-        if (sepch == NULL)
-            return;
-        seplen = devs_string_length(ctx, sep);
-        devs_value_pin(ctx, sep);
-    }
-
-    unsigned sz = 0, len = 0;
-
-    for (unsigned i = 0; i < self->length; ++i) {
-        value_t v = devs_value_to_string(ctx, self->data[i]);
-        if (i > 0) {
-            len += seplen;
-            sz += sepsz;
-        }
+    bool comma = devs_is_undefined(sep);
+    if (!comma)
+        sep = devs_root_push(ctx, devs_value_to_string(ctx, sep));
 
-        unsigned tsz;
-        if (devs_string_get_utf8(ctx, v, &tsz) == NULL)
-            goto error;
-        sz += tsz;
-        len += devs_string_length(ctx, v);
-    }
-
-    value_t r;
-    char *d = devs_string_prep(ctx, &r, sz, len);
-    if (!d)
-        goto error;
+    devs_strbuild_t sb;
+    devs_strbuild_init(ctx, &sb);
 
-    unsigned off = 0;
-    for (unsigned i = 0; i < self->length; ++i) {
-        value_t v = devs_value_to_string(ctx, self->data[i]);
+    for (unsigned i = 0; i < self->length && !sb.error; ++i) {
         if (i > 0) {
-            memcpy(d + off, sepch, sepsz);
-            off += sepsz;
+            if (comma)
+                devs_strbuild_add_ch(&sb, ',', 1);
+            else
+                devs_strbuild_add_string(&sb, sep);
         }
-
-        unsigned tsz;
-        const char *ss = devs_string_get_utf8(ctx, v, &tsz);
-        if (ss == NULL)
-            goto error;
-
-        memcpy(d + off, ss, tsz);
-        off += tsz;
+        devs_strbuild_add_value(&sb, self->data[i]);
     }
 
-    devs_string_finish(ctx, &r, off, len);
-    devs_ret(ctx, r);
-
-error:
-    devs_value_unpin(ctx, sep);
+    devs_ret(ctx, devs_strbuild_finish(&sb));
+    devs_root_pop(ctx, scope);
 }
@@ -127,6 +127,13 @@ void meth3_Buffer_fillAt(devs_ctx_t *ctx) {
     memset(dst + dst_offset, val, len);
 }
 
+// Buffer or string
+static const uint8_t *src_data(devs_ctx_t *ctx, value_t v, unsigned *sz) {
+    if (devs_is_string(ctx, v))
+        return (const uint8_t *)devs_string_get_utf8(ctx, v, sz);
+    return buffer_data(ctx, v, sz);
+}
+
 void meth4_Buffer_blitAt(devs_ctx_t *ctx) {
     unsigned slen, dlen;
 
@@ -135,9 +142,7 @@ void meth4_Buffer_blitAt(devs_ctx_t *ctx) {
         return;
     uint32_t dst_offset = devs_arg_int(ctx, 0);
 
-    value_t src_ = devs_arg(ctx, 1);
-    const uint8_t *src = devs_is_string(ctx, src_) ? devs_string_get_utf8(ctx, src_, &slen)
-                                                   : buffer_data(ctx, src_, &slen);
+    const uint8_t *src = src_data(ctx, devs_arg(ctx, 1), &slen);
     if (src == NULL)
         return;
     uint32_t src_offset = devs_arg_int(ctx, 2);
@@ -155,7 +160,8 @@ void meth4_Buffer_blitAt(devs_ctx_t *ctx) {
     if (dlen < len)
         len = dlen;
 
-    memcpy(dst + dst_offset, src + src_offset, len);
+    // src may be a view of dst
+    memmove(dst + dst_offset, src + src_offset, len);
 }
 
 int devs_clamp_size(int v, int max) {
@@ -166,48 +172,257 @@ int devs_clamp_size(int v, int max) {
     return v;
 }
 
-void meth3_Buffer_indexOf(devs_ctx_t *ctx) {
+unsigned devs_rel_index(int idx, unsigned sz) {
+    if (idx < 0)
+        idx += sz;
+    return devs_clamp_size(idx, sz);
+}
+
+static unsigned numfmt_size(devs_ctx_t *ctx, uint32_t fmt) {
+    unsigned esz = devs_numfmt_plain_size(fmt);
+    if (esz == 0)
+        devs_throw_range_error(ctx, "buffer numfmt invalid");
+    return esz;
+}
+
+void meth3_Buffer_getArrayAt(devs_ctx_t *ctx) {
+    unsigned sz;
+    const uint8_t *data = buffer_data(ctx, devs_arg_self(ctx), &sz);
+    if (data == NULL)
+        return;
+
+    unsigned offset = devs_clamp_size(devs_arg_int(ctx, 0), sz);
+    uint32_t fmt = devs_arg_int(ctx, 1);
+    unsigned esz = numfmt_size(ctx, fmt);
+    if (esz == 0)
+        return;
+
+    unsigned num = (sz - offset) / esz;
+    num = devs_clamp_size(devs_arg_int_defl(ctx, 2, num), num);
+
+    devs_array_t *arr = devs_array_try_alloc(ctx, num);
+    if (arr == NULL)
+        return;
+    devs_buffer_decode_many(fmt, data + offset, num, arr->data);
+    devs_ret_gc_ptr(ctx, arr);
+}
+
+void meth3_Buffer_setArrayAt(devs_ctx_t *ctx) {
+    unsigned sz;
+    uint8_t *data = wr_buffer_data(ctx, devs_arg_self(ctx), &sz);
+    if (data == NULL)
+        return;
+
+    int offset = devs_arg_int(ctx, 0);
+    uint32_t fmt = devs_arg_int(ctx, 1);
+    value_t values = devs_arg(ctx, 2);
+    unsigned esz = numfmt_size(ctx, fmt);
+    if (esz == 0)
+        return;
+
+    if (!devs_is_array(ctx, values)) {
+        devs_throw_expecting_error(ctx, DEVS_BUILTIN_STRING_ARRAY, values);
+        return;
+    }
+    devs_array_t *arr = devs_value_to_gc_obj(ctx, values);
+
+    if (offset < 0 || offset + arr->length * esz > sz) {
+        devs_throw_range_error(ctx, "buffer store out of range");
+        return;
+    }
+    devs_buffer_encode_many(ctx, fmt, data + offset, arr->length, arr->data);
+}
+
+void meth2_Buffer_subarray(devs_ctx_t *ctx) {
+    value_t self = devs_arg_self(ctx);
+    unsigned sz;
+    if (!buffer_data(ctx, self, &sz))
+        return;
+
+    unsigned start = devs_rel_index(devs_arg_int(ctx, 0), sz);
+    unsigned endp = devs_rel_index(devs_arg_int_defl(ctx, 1, sz), sz);
+    if (endp < start)
+        endp = start;
+
+    devs_ret_gc_ptr(ctx, devs_buffer_view_try_alloc(ctx, self, start, endp - start));
+}
+
+void meth2_Buffer_set(devs_ctx_t *ctx) {
+    unsigned slen, dlen;
+    uint8_t *dst = wr_buffer_data(ctx, devs_arg_self(ctx), &dlen);
+    if (dst == NULL)
+        return;
+    const uint8_t *src = src_data(ctx, devs_arg(ctx, 0), &slen);
+    if (src == NULL)
+        return;
+
+    unsigned dst_offset = devs_clamp_size(devs_arg_int(ctx, 1), dlen);
+    dlen -= dst_offset;
+    if (dlen < slen)
+        slen = dlen;
+
+    memmove(dst + dst_offset, src, slen);
+}
+
+void meth2_Buffer_slice(devs_ctx_t *ctx) {
+    unsigned sz;
+    if (!buffer_data(ctx, devs_arg_self(ctx), &sz))
+        return;
+
+    unsigned start = devs_rel_index(devs_arg_int(ctx, 0), sz);
+    unsigned endp = devs_rel_index(devs_arg_int_defl(ctx, 1, sz), sz);
+    if (endp < start)
+        endp = start;
+
+    devs_buffer_t *r = devs_buffer_try_alloc(ctx, endp - start);
+    if (r)
+        memcpy(r->data, devs_buffer_data(ctx, devs_arg_self(ctx), NULL) + start, endp - start);
+    devs_ret_gc_ptr(ctx, r);
+}
+
+// the buffers have to be reachable from the stack, as this allocates
+static void concat_buffers(devs_ctx_t *ctx, value_t *args, unsigned num) {
+    unsigned size = 0;
+    for (unsigned i = 0; i < num; ++i) {
+        unsigned sz;
+        if (!buffer_data(ctx, args[i], &sz))
+            return;
+        size += sz;
+    }
+
+    devs_buffer_t *r = devs_buffer_try_alloc(ctx, size);
+    if (r == NULL)
+        return;
+    devs_ret_gc_ptr(ctx, r);
+
+    size = 0;
+    for (unsigned i = 0; i < num; ++i) {
+        unsigned sz;
+        const uint8_t *d = devs_buffer_data(ctx, args[i], &sz);
+        memcpy(r->data + size, d, sz);
+        size += sz;
+    }
+}
+
+void meth1_Buffer_concat(devs_ctx_t *ctx) {
+    value_t bufs[] = {devs_arg_self(ctx), devs_arg(ctx, 0)};
+    concat_buffers(ctx, bufs, 2);
+}
+
+void funX_Buffer_concat(devs_ctx_t *ctx) {
+    concat_buffers(ctx, ctx->the_stack + 1, ctx->stack_top_for_gc - 1);
+}
+
+// offset of the first (last) occurrence of needle in hay, or -1
+int devs_memfind(const void *hay, unsigned size, const void *needle, unsigned nsize) {
+    if (nsize == 0)
+        return 0;
+    if (nsize > size)
+        return -1;
+    const uint8_t *h = hay;
+    const uint8_t *n = needle;
+    const uint8_t *p = h;
+    const uint8_t *last = h + size - nsize;
+    // let memchr() skip to candidate positions
+    while (p <= last) {
+        p = memchr(p, n[0], last - p + 1);
+        if (p == NULL)
+            break;
+        if (memcmp(p + 1, n + 1, nsize - 1) == 0)
+            return p - h;
+        p++;
+    }
+    return -1;
+}
+
+int devs_memrfind(const void *hay, unsigned size, const void *needle, unsigned nsize) {
+    if (nsize > size)
+        return -1;
+    if (nsize == 0)
+        return size;
+    const uint8_t *h = hay;
+    const uint8_t *n = needle;
+    for (const uint8_t *p = h + size - nsize; p >= h; p--)
+        if (*p == n[0] && memcmp(p + 1, n + 1, nsize - 1) == 0)
+            return p - h;
+    return -1;
+}
+
+static void meth3_Buffer_index_of(devs_ctx_t *ctx, bool rev) {
     unsigned sz;
     const uint8_t *data = buffer_data(ctx, devs_arg_self(ctx), &sz);
     if (!data)
         return;
 
-    int ch = devs_arg_int(ctx, 0);
-    int start_pos = devs_arg_int(ctx, 1);
-    int end_pos = devs_arg_int_defl(ctx, 2, sz);
-    int rev = 0;
+    // the pattern is either a byte value or a Buffer/string
+    unsigned psz;
+    uint8_t ch;
+    const uint8_t *pat = devs_bufferish_data(ctx, devs_arg(ctx, 0), &psz);
+    if (pat == NULL) {
+        ch = devs_arg_int(ctx, 0);
+        pat = &ch;
+        psz = 1;
+    }
 
-    start_pos = devs_clamp_size(start_pos, sz);
+    int start_pos = devs_clamp_size(devs_arg_int(ctx, 1), sz);
+    int end_pos = devs_arg_int_defl(ctx, 2, sz);
     if (end_pos < 0) {
-        rev = 1;
+        rev = true;
         end_pos = -end_pos;
     }
     end_pos = devs_clamp_size(end_pos, sz);
 
     int r = -1;
-
-    if (rev) {
-        end_pos--;
-        while (start_pos <= end_pos) {
-            if (data[end_pos] == ch) {
-                r = end_pos;
-                break;
-            }
-            end_pos--;
-        }
-    } else {
-        while (start_pos < end_pos) {
-            if (data[start_pos] == ch) {
-                r = start_pos;
-                break;
-            }
-            start_pos++;
-        }
+    if (start_pos <= end_pos) {
+        r = rev ? devs_memrfind(data + start_pos, end_pos - start_pos, pat, psz)
+                : devs_memfind(data + start_pos, end_pos - start_pos, pat, psz);
+        if (r >= 0)
+            r += start_pos;
     }
 
     devs_ret_int(ctx, r);
 }
 
+void meth3_Buffer_indexOf(devs_ctx_t *ctx) {
+    meth3_Buffer_index_of(ctx, false);
+}
+
+void meth3_Buffer_lastIndexOf(devs_ctx_t *ctx) {
+    meth3_Buffer_index_of(ctx, true);
+}
+
+typedef struct {
+    uint8_t *dst;
+    unsigned left;
+} buffer_sink_t;
+
+#define BUFFER_SINK_FULL -2
+
+static int buffer_sink(void *arg, const char *data, unsigned size) {
+    buffer_sink_t *bs = arg;
+    if (size > bs->left)
+        return BUFFER_SINK_FULL;
+    memcpy(bs->dst, data, size);
+    bs->dst += size;
+    bs->left -= size;
+    return 0;
+}
+
+void meth2_Buffer_writeJSON(devs_ctx_t *ctx) {
+    unsigned sz;
+    uint8_t *data = wr_buffer_data(ctx, devs_arg_self(ctx), &sz);
+    if (!data)
+        return;
+
+    unsigned offset = devs_clamp_size(devs_arg_int(ctx, 1), sz);
+    buffer_sink_t bs = {.dst = data + offset, .left = sz - offset};
+    int r = devs_json_stringify_to(ctx, devs_arg(ctx, 0), 0, 0, buffer_sink, &bs);
+    if (r == BUFFER_SINK_FULL)
+        devs_throw_range_error(ctx, "JSON doesn't fit in buffer at %u, len=%u", offset, sz);
+    else if (r == 0)
+        devs_ret_int(ctx, sz - offset - bs.left);
+}
+
 //
 // Crypto
 //
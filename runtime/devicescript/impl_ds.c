@@ -45,6 +45,84 @@ void fun0_DeviceScript_restart(devs_ctx_t *ctx) {
     devs_panic(ctx, 0);
 }
 
+static void stat_set(devs_ctx_t *ctx, devs_map_t *m, const char *name, value_t v) {
+    unsigned scope = devs_root_scope(ctx);
+    devs_root_push(ctx, v);
+    value_t key = devs_root_push(ctx, devs_string_sprintf(ctx, "%s", name));
+    devs_map_set(ctx, m, key, v);
+    devs_root_pop(ctx, scope);
+}
+
+static value_t gc_stat_hist(devs_ctx_t *ctx, const uint32_t *hist) {
+    devs_array_t *arr = devs_array_try_alloc(ctx, DEVS_GC_TIME_BUCKETS);
+    if (!arr)
+        return devs_undefined;
+    for (unsigned i = 0; i < DEVS_GC_TIME_BUCKETS; ++i)
+        arr->data[i] = devs_value_from_double(hist[i]);
+    return devs_value_from_gc_obj(ctx, arr);
+}
+
+static value_t gc_stat_by_tag(devs_ctx_t *ctx, const uint32_t *counts) {
+    devs_map_t *m = devs_map_try_alloc(ctx, 0);
+    if (!m)
+        return devs_undefined;
+    unsigned scope = devs_root_scope(ctx);
+    value_t r = devs_root_push(ctx, devs_value_from_gc_obj(ctx, m));
+    for (unsigned tag = 1; tag <= DEVS_GC_TAG_MASK; ++tag)
+        if (counts[tag])
+            stat_set(ctx, m, devs_gc_tag_name(tag), devs_value_from_double(counts[tag]));
+    devs_root_pop(ctx, scope);
+    return r;
+}
+
+void fun0_DeviceScript_gcStats(devs_ctx_t *ctx) {
+    // copy, as allocations below update the counters
+    devs_gc_stats_t st = *devs_get_gc_stats(ctx);
+
+    devs_map_t *m = devs_map_try_alloc(ctx, 0);
+    if (!m)
+        return;
+    // ret_val is a GC root
+    devs_ret(ctx, devs_value_from_gc_obj(ctx, m));
+
+    stat_set(ctx, m, "numGC", devs_value_from_double(st.num_gc));
+    stat_set(ctx, m, "liveBytes", devs_value_from_double(st.live_bytes));
+    stat_set(ctx, m, "freeBytes", devs_value_from_double(st.free_bytes));
+    stat_set(ctx, m, "freeBlocks", devs_value_from_double(st.free_blocks));
+    stat_set(ctx, m, "maxFreeBlock", devs_value_from_double(st.max_free_block));
+    stat_set(ctx, m, "markTime", gc_stat_hist(ctx, st.mark_time));
+    stat_set(ctx, m, "sweepTime", gc_stat_hist(ctx, st.sweep_time));
+    stat_set(ctx, m, "numAlloc", gc_stat_by_tag(ctx, st.num_alloc));
+    stat_set(ctx, m, "allocBytes", gc_stat_by_tag(ctx, st.alloc_bytes));
+}
+
+void fun0_DeviceScript_regCacheStats(devs_ctx_t *ctx) {
+    devs_regcache_t *cache = &ctx->regcache;
+    devs_map_t *m = devs_map_try_alloc(ctx, 0);
+    if (!m)
+        return;
+    devs_ret(ctx, devs_value_from_gc_obj(ctx, m));
+
+    stat_set(ctx, m, "size", devs_value_from_int(cache->num_entries));
+    stat_set(ctx, m, "hits", devs_value_from_double(cache->num_hits));
+    stat_set(ctx, m, "misses", devs_value_from_double(cache->num_misses));
+}
+
+void fun1_DeviceScript_encodeCBOR(devs_ctx_t *ctx) {
+    devs_ret(ctx, devs_cbor_encode(ctx, devs_arg(ctx, 0)));
+}
+
+void fun1_DeviceScript_decodeCBOR(devs_ctx_t *ctx) {
+    value_t buf = devs_arg(ctx, 0);
+    if (!devs_is_buffer(ctx, buf)) {
+        devs_throw_expecting_error(ctx, DEVS_BUILTIN_STRING_BUFFER, buf);
+        return;
+    }
+    unsigned sz;
+    const uint8_t *data = devs_buffer_data(ctx, buf, &sz);
+    devs_ret(ctx, devs_cbor_decode(ctx, data, sz));
+}
+
 void funX_DeviceScript_format(devs_ctx_t *ctx) {
     if (ctx->stack_top_for_gc < 2)
         return;
@@ -58,26 +136,10 @@ void funX_DeviceScript_format(devs_ctx_t *ctx) {
     unsigned numargs = ctx->stack_top_for_gc - 2;
     value_t *argp = ctx->the_stack + 2;
 
-    char tmp[64];
-    size_t length;
-    unsigned sz = devs_strformat(ctx, fmt, len, tmp, sizeof(tmp), argp, numargs, &length);
-    sz--;
-    length--;
-
-    value_t r;
-    char *d = devs_string_prep(ctx, &r, sz, length);
-    if (d) {
-        if (sz < sizeof(tmp) - 1) {
-            memcpy(d, tmp, sz);
-        } else {
-            sz = devs_strformat(ctx, fmt, len, d, sz + 1, argp, numargs, &length);
-            length--;
-            sz--;
-        }
-        devs_string_finish(ctx, &r, sz, length);
-    }
-
-    devs_ret(ctx, r);
+    devs_strbuild_t sb;
+    devs_strbuild_init(ctx, &sb);
+    devs_strformat(&sb, fmt, len, argp, numargs);
+    devs_ret(ctx, devs_strbuild_finish(&sb));
 }
 
 void fun2_DeviceScript_print(devs_ctx_t *ctx) {
@@ -103,14 +165,30 @@ void fun2_DeviceScript__logRepr(devs_ctx_t *ctx) {
     if (devs_is_nullish(lbl)) {
         DMESG("> %s", devs_show_value(ctx, v));
     } else {
-        lbl = devs_value_to_string(ctx, lbl);
-        devs_value_pin(ctx, lbl);
+        unsigned scope = devs_root_scope(ctx);
+        lbl = devs_root_push(ctx, devs_value_to_string(ctx, lbl));
         const char *p = devs_string_get_utf8(ctx, lbl, NULL);
         DMESG("> %s: %s", p, devs_show_value(ctx, v));
-        devs_value_unpin(ctx, lbl);
+        devs_root_pop(ctx, scope);
     }
 }
 
+// JSON goes to the trace log in pieces of this size
+#define TRACE_JSON_CHUNK 128
+
+static int trace_sink(void *arg, const char *data, unsigned size) {
+    devs_trace(arg, DEVS_TRACE_EV_JSON, data, size);
+    return 0;
+}
+
+void fun1_DeviceScript_traceJSON(devs_ctx_t *ctx) {
+    if (!devs_trace_enabled(ctx))
+        return;
+    devs_json_stringify_to(ctx, devs_arg(ctx, 0), 0, TRACE_JSON_CHUNK, trace_sink, ctx);
+    // also after an exception, so the next value starts on a new line
+    devs_trace(ctx, DEVS_TRACE_EV_JSON, "\n", 1);
+}
+
 void fun1_DeviceScript__dcfgString(devs_ctx_t *ctx) {
     value_t lbl = devs_arg(ctx, 0);
     lbl = devs_value_to_string(ctx, lbl);
@@ -27,11 +27,12 @@ value_t prop_Function_prototype(devs_ctx_t *ctx, value_t self) {
             ctx, devs_map_try_alloc(
                      ctx, devs_get_builtin_object(ctx, DEVS_BUILTIN_OBJECT_OBJECT_PROTOTYPE)));
         if (!devs_is_undefined(r)) {
-            devs_value_pin(ctx, r);
+            unsigned scope = devs_root_scope(ctx);
+            devs_root_push(ctx, r);
             devs_any_set(ctx, r, devs_builtin_string(DEVS_BUILTIN_STRING_CONSTRUCTOR),
                          devs_value_from_handle(DEVS_HANDLE_TYPE_STATIC_FUNCTION, fn));
             devs_short_map_set(ctx, ctx->fn_protos, fn, r);
-            devs_value_unpin(ctx, r);
+            devs_root_pop(ctx, scope);
         }
     }
     return r;
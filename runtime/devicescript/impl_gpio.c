@@ -255,11 +255,12 @@ void fun1_DeviceScript_gpio(devs_ctx_t *ctx) {
         // set fields for nicer debug output
         devs_any_set(ctx, p->obj, devs_builtin_string(DEVS_BUILTIN_STRING_GPIO),
                      devs_value_from_int(gpio));
+        unsigned scope = devs_root_scope(ctx);
         value_t lbl = devs_value_from_gc_obj(
             ctx, devs_string_try_alloc_init(ctx, p->label, strlen(p->label)));
-        devs_value_pin(ctx, lbl);
+        devs_root_push(ctx, lbl);
         devs_any_set(ctx, p->obj, devs_builtin_string(DEVS_BUILTIN_STRING_LABEL), lbl);
-        devs_value_unpin(ctx, lbl);
+        devs_root_pop(ctx, scope);
     }
 
     devs_ret(ctx, p->obj);
@@ -7,14 +7,13 @@ void fun2_JSON_parse(devs_ctx_t *ctx) {
     if (!devs_is_nullish(reviver))
         devs_throw_not_supported_error(ctx, "JSON.parse reviver");
 
-    str = devs_value_to_string(ctx, str);
-
-    devs_value_pin(ctx, str);
+    unsigned scope = devs_root_scope(ctx);
+    str = devs_root_push(ctx, devs_value_to_string(ctx, str));
     unsigned sz;
     const char *data = devs_string_get_utf8(ctx, str, &sz);
     if (data != NULL)
         devs_ret(ctx, devs_json_parse(ctx, data, sz, true));
-    devs_value_unpin(ctx, str);
+    devs_root_pop(ctx, scope);
 }
 
 void fun3_JSON_stringify(devs_ctx_t *ctx) {
@@ -26,4 +25,12 @@ void fun3_JSON_stringify(devs_ctx_t *ctx) {
         devs_throw_not_supported_error(ctx, "JSON.stringify replacer");
 
     devs_ret(ctx, devs_json_stringify(ctx, obj, indent, true));
-}
\ No newline at end of file
+}
+
+void fun0_DeviceScript__jsonParser(devs_ctx_t *ctx) {
+    devs_ret(ctx, devs_json_parser_alloc(ctx));
+}
+
+void fun2_DeviceScript__jsonFeed(devs_ctx_t *ctx) {
+    devs_ret(ctx, devs_json_feed(ctx, devs_arg(ctx, 0), devs_arg(ctx, 1)));
+}
@@ -25,12 +25,12 @@ static void fun1_keys_or_values(devs_ctx_t *ctx, bool keys) {
     if (!arr)
         return;
 
-    value_t ret = devs_value_from_gc_obj(ctx, arr);
-    devs_value_pin(ctx, ret);
+    unsigned scope = devs_root_scope(ctx);
+    value_t ret = devs_root_push(ctx, devs_value_from_gc_obj(ctx, arr));
 
     devs_maplike_keys_or_values(ctx, src, arr, keys);
 
-    devs_value_unpin(ctx, ret);
+    devs_root_pop(ctx, scope);
     devs_ret(ctx, ret);
 }
 
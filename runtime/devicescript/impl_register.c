@@ -23,16 +23,21 @@ static const devs_packet_spec_t *devs_arg_self_reg(devs_ctx_t *ctx, unsigned *ro
     return pkt;
 }
 
-value_t devs_packet_decode(devs_ctx_t *ctx, const devs_packet_spec_t *pkt, uint8_t *dp,
-                           unsigned len) {
+// single field repeated until the end of the packet
+static bool is_last_repeated(const devs_field_spec_t *fld) {
+    return (fld->flags & DEVS_FIELDSPEC_FLAG_STARTS_REPEATS) && !fld[1].name_idx;
+}
+
+value_t devs_packet_decode_generic(devs_ctx_t *ctx, const devs_packet_spec_t *pkt, uint8_t *dp,
+                                   unsigned len) {
     uint8_t *ep = dp + len;
 
     if (pkt->flags & DEVS_PACKETSPEC_FLAG_MULTI_FIELD) {
         devs_array_t *arr = devs_array_try_alloc(ctx, 0);
         if (!arr)
             return devs_undefined;
-        value_t res = devs_value_from_gc_obj(ctx, arr);
-        devs_value_pin(ctx, res);
+        unsigned scope = devs_root_scope(ctx);
+        value_t res = devs_root_push(ctx, devs_value_from_gc_obj(ctx, arr));
 
         const devs_field_spec_t *fld = devs_img_get_field_spec(ctx->img, pkt->numfmt_or_offset);
         const devs_field_spec_t *rep = NULL;
@@ -41,6 +46,18 @@ value_t devs_packet_decode(devs_ctx_t *ctx, const devs_packet_spec_t *pkt, uint8
             intptr_t sz = ep - dp;
             if (sz < 0)
                 break;
+            if (is_last_repeated(fld)) {
+                // decode all remaining values at once
+                unsigned esz = devs_numfmt_plain_size(fld->numfmt);
+                unsigned n = esz ? sz / esz : 0;
+                if (n) {
+                    unsigned len0 = arr->length;
+                    if (devs_array_insert(ctx, arr, len0, n) == 0)
+                        devs_buffer_decode_many(fld->numfmt, dp, n, arr->data + len0);
+                    break;
+                }
+            }
+
             uint8_t *dp0 = dp;
             value_t tmp = devs_buffer_decode(ctx, fld->numfmt, &dp, sz);
             if (devs_is_undefined(tmp))
@@ -60,13 +77,21 @@ value_t devs_packet_decode(devs_ctx_t *ctx, const devs_packet_spec_t *pkt, uint8
             }
         }
 
-        devs_value_unpin(ctx, res);
+        devs_root_pop(ctx, scope);
         return res;
     } else {
         return devs_buffer_decode(ctx, pkt->numfmt_or_offset, &dp, ep - dp);
     }
 }
 
+value_t devs_packet_decode(devs_ctx_t *ctx, const devs_packet_spec_t *pkt, uint8_t *dp,
+                           unsigned len) {
+    value_t fast;
+    if (devs_packet_decode_fast(ctx, pkt, dp, len, &fast))
+        return fast;
+    return devs_packet_decode_generic(ctx, pkt, dp, len);
+}
+
 static void DsRegister_read_cont(devs_ctx_t *ctx, void *userdata) {
     devs_ret(ctx, devs_packet_decode(ctx, userdata, ctx->packet.data, ctx->packet.service_size));
 }
@@ -106,6 +131,18 @@ void devs_packet_encode(devs_ctx_t *ctx, const devs_packet_spec_t *pkt) {
             if (sz < 0)
                 break;
 
+            if (is_last_repeated(fld)) {
+                unsigned esz = devs_numfmt_plain_size(fld->numfmt);
+                if (esz) {
+                    unsigned n = argc - argp;
+                    if (n > sz / esz)
+                        n = sz / esz;
+                    devs_buffer_encode_many(ctx, fld->numfmt, dp, n, argv + argp);
+                    dp += n * esz;
+                    break;
+                }
+            }
+
             int off = devs_buffer_encode(ctx, fld->numfmt, dp, ep - dp, argv[argp]);
 
             if (off == 0)
@@ -128,3 +128,28 @@ void fun1_DeviceScript__socketWrite(devs_ctx_t *ctx) {
     devs_throw_not_supported_error(ctx, "Networking");
 #endif
 }
+
+#if JD_USER_SOCKET
+// JSON is written to the socket in pieces of this size
+#define SOCKET_JSON_CHUNK 256
+
+static int socket_sink(void *arg, const char *data, unsigned size) {
+    inside_sock = true;
+    int r = jd_tcpsock_write(data, size);
+    inside_sock = false;
+    return r;
+}
+#endif
+
+void fun1_DeviceScript__socketWriteJSON(devs_ctx_t *ctx) {
+#if JD_USER_SOCKET
+    if (!jd_tcpsock_on_event_override) {
+        devs_ret_int(ctx, -100);
+    } else {
+        devs_ret_int(ctx, devs_json_stringify_to(ctx, devs_arg(ctx, 0), 0, SOCKET_JSON_CHUNK,
+                                                 socket_sink, NULL));
+    }
+#else
+    devs_throw_not_supported_error(ctx, "Networking");
+#endif
+}
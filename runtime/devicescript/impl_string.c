@@ -44,62 +44,345 @@ void funX_String_fromCharCode(devs_ctx_t *ctx) {
         return;
     }
 
+    if (len == 1) {
+        int ch = devs_arg_int(ctx, 0);
+        if (0 <= ch && ch < 0x80) {
+            devs_ret(ctx, devs_string_from_ascii_char(ch));
+            return;
+        }
+    }
+
     for (int i = 0; i < len; ++i) {
         int ch = devs_arg_int(ctx, i);
         size += devs_utf8_from_code_point(ch, buf);
     }
 
     value_t r;
-    char *d = devs_string_prep(ctx, &r, size, len);
+    unsigned scope;
+    char *d = devs_string_prep(ctx, &r, size, len, &scope);
     if (d) {
         unsigned off = 0;
         for (int i = 0; i < len; ++i) {
             int ch = devs_arg_int(ctx, i);
             off += devs_utf8_from_code_point(ch, d + off);
         }
-        devs_string_finish(ctx, &r, size, len);
+        devs_string_finish(ctx, &r, size, len, scope);
     }
     devs_ret(ctx, r);
 }
 
+// byte offset of character idx, clamped to [0, size]
+static unsigned byte_offset(devs_ctx_t *ctx, value_t str, unsigned size, int idx) {
+    if (idx <= 0)
+        return 0;
+    int off = devs_string_index(ctx, str, idx);
+    return off < 0 ? size : (unsigned)off;
+}
+
+static value_t substring(devs_ctx_t *ctx, value_t str, const char *data, unsigned size,
+                         unsigned start, unsigned endp) {
+    if (start == 0 && endp == size)
+        return str;
+    if (start >= endp)
+        return devs_builtin_string(DEVS_BUILTIN_STRING__EMPTY);
+    return devs_string_from_utf8(ctx, (const uint8_t *)data + start, endp - start);
+}
+
 void meth3_String_indexOf(devs_ctx_t *ctx) {
     value_t str = devs_arg_self(ctx);
+    unsigned search_size;
+    const char *search_data = devs_arg_utf8_with_conv(ctx, 0, &search_size);
     unsigned size;
     const char *data = devs_string_get_utf8(ctx, str, &size);
-
-    value_t search = devs_arg(ctx, 0);
-    unsigned search_size;
-    const char *search_data = devs_string_get_utf8(ctx, search, &search_size);
+    if (!data || !search_data)
+        return;
 
     int len = devs_string_length(ctx, str);
     int start_ch = devs_arg_int(ctx, 1);
-    int end_ch = devs_arg_int_defl(ctx, 2, len);
-    int rev = 0;
+    int end_ch = devs_arg_int_defl(ctx, 2, len + 1);
+    bool rev = false;
     if (end_ch < 0) {
         end_ch = -end_ch;
-        rev = 1;
+        rev = true;
     }
+    if (start_ch < 0)
+        start_ch = 0;
+    if (start_ch > len)
+        start_ch = len;
+    if (end_ch > len + 1)
+        end_ch = len + 1;
 
     int r = -1;
-    int ptr = devs_string_index(ctx, str, start_ch);
+    if (start_ch < end_ch && search_size == 0) {
+        r = rev ? end_ch - 1 : start_ch;
+    } else if (start_ch < end_ch) {
+        unsigned beg = byte_offset(ctx, str, size, start_ch);
+        // matches have to start before character end_ch
+        unsigned lim = byte_offset(ctx, str, size, end_ch) - 1 + search_size;
+        if (lim > size)
+            lim = size;
+        int off = rev ? devs_memrfind(data + beg, lim - beg, search_data, search_size)
+                      : devs_memfind(data + beg, lim - beg, search_data, search_size);
+        if (off >= 0)
+            r = devs_string_char_index(ctx, str, beg + off);
+    }
+
+    devs_ret_int(ctx, r);
+}
+
+void meth2_String_lastIndexOf(devs_ctx_t *ctx) {
+    value_t str = devs_arg_self(ctx);
+    unsigned search_size;
+    const char *search_data = devs_arg_utf8_with_conv(ctx, 0, &search_size);
+    unsigned size;
+    const char *data = devs_string_get_utf8(ctx, str, &size);
+    if (!data || !search_data)
+        return;
+
+    int len = devs_string_length(ctx, str);
+    double pos = devs_arg_double(ctx, 1);
+    int pos_ch = isnan(pos) || pos >= len ? len : pos < 0 ? 0 : (int)pos;
+
+    unsigned lim = byte_offset(ctx, str, size, pos_ch) + search_size;
+    if (lim > size)
+        lim = size;
+    int off = devs_memrfind(data, lim, search_data, search_size);
+    devs_ret_int(ctx, off < 0 ? -1 : devs_string_char_index(ctx, str, off));
+}
+
+void meth2_String_includes(devs_ctx_t *ctx) {
+    value_t str = devs_arg_self(ctx);
+    unsigned search_size;
+    const char *search_data = devs_arg_utf8_with_conv(ctx, 0, &search_size);
+    unsigned size;
+    const char *data = devs_string_get_utf8(ctx, str, &size);
+    if (!data || !search_data)
+        return;
+
+    unsigned beg = byte_offset(ctx, str, size, devs_arg_int(ctx, 1));
+    devs_ret_bool(ctx, devs_memfind(data + beg, size - beg, search_data, search_size) >= 0);
+}
+
+void meth2_String_startsWith(devs_ctx_t *ctx) {
+    value_t str = devs_arg_self(ctx);
+    unsigned search_size;
+    const char *search_data = devs_arg_utf8_with_conv(ctx, 0, &search_size);
+    unsigned size;
+    const char *data = devs_string_get_utf8(ctx, str, &size);
+    if (!data || !search_data)
+        return;
+
+    unsigned beg = byte_offset(ctx, str, size, devs_arg_int(ctx, 1));
+    devs_ret_bool(ctx, beg + search_size <= size &&
+                           memcmp(data + beg, search_data, search_size) == 0);
+}
+
+void meth2_String_endsWith(devs_ctx_t *ctx) {
+    value_t str = devs_arg_self(ctx);
+    unsigned search_size;
+    const char *search_data = devs_arg_utf8_with_conv(ctx, 0, &search_size);
+    unsigned size;
+    const char *data = devs_string_get_utf8(ctx, str, &size);
+    if (!data || !search_data)
+        return;
+
+    unsigned endp = byte_offset(ctx, str, size, devs_arg_int_defl(ctx, 1, 0x7fffffff));
+    devs_ret_bool(ctx, search_size <= endp &&
+                           memcmp(data + endp - search_size, search_data, search_size) == 0);
+}
 
-    if (search_data && ptr >= 0) {
-        while (start_ch < end_ch) {
-            if (ptr + search_size > size)
+static bool is_space(unsigned c) {
+    if (c < 0x80)
+        return c == ' ' || ('\t' <= c && c <= '\r');
+    switch (c) {
+    case 0xa0:
+    case 0x1680:
+    case 0x2028:
+    case 0x2029:
+    case 0x202f:
+    case 0x205f:
+    case 0x3000:
+    case 0xfeff:
+        return true;
+    default:
+        return 0x2000 <= c && c <= 0x200a;
+    }
+}
+
+void meth0_String_trim(devs_ctx_t *ctx) {
+    value_t str = devs_arg_self(ctx);
+    unsigned size;
+    const char *data = devs_string_get_utf8(ctx, str, &size);
+    if (!data)
+        return;
+
+    unsigned beg = 0;
+    while (beg < size && is_space(devs_utf8_code_point(data + beg)))
+        beg += devs_utf8_code_point_length(data + beg);
+
+    unsigned endp = size;
+    while (endp > beg) {
+        unsigned p = endp - 1;
+        while (p > beg && devs_utf8_is_cont(data[p]))
+            p--;
+        if (!is_space(devs_utf8_code_point(data + p)))
+            break;
+        endp = p;
+    }
+
+    devs_ret(ctx, substring(ctx, str, data, size, beg, endp));
+}
+
+void meth2_String_split(devs_ctx_t *ctx) {
+    value_t str = devs_arg_self(ctx);
+    bool whole = devs_is_undefined(devs_arg(ctx, 0));
+    unsigned sep_size = 0;
+    const char *sep = whole ? NULL : devs_arg_utf8_with_conv(ctx, 0, &sep_size);
+    unsigned size;
+    const char *data = devs_string_get_utf8(ctx, str, &size);
+    if (!data || (!whole && !sep))
+        return;
+
+    int lim = devs_arg_int_defl(ctx, 1, 0x7fffffff);
+    if (lim < 0)
+        lim = 0;
+
+    // count the pieces first, so the array is allocated once
+    int num;
+    if (lim == 0)
+        num = 0;
+    else if (whole)
+        num = 1;
+    else if (size == 0)
+        num = sep_size == 0 ? 0 : 1;
+    else if (sep_size == 0)
+        num = devs_string_length(ctx, str);
+    else {
+        num = 1;
+        for (unsigned p = 0; num < lim; num++) {
+            int e = devs_memfind(data + p, size - p, sep, sep_size);
+            if (e < 0)
                 break;
-            if (memcmp(data + ptr, search_data, search_size) == 0) {
-                r = start_ch;
-                if (!rev)
-                    break;
-            }
-            start_ch++;
-            ptr++;
-            while (ptr < (int)size && devs_utf8_is_cont(data[ptr]))
-                ptr++;
+            p += e + sep_size;
         }
     }
+    if (num > lim)
+        num = lim;
 
-    devs_ret_int(ctx, r);
+    devs_array_t *arr = devs_array_try_alloc(ctx, num);
+    if (!arr)
+        return;
+
+    unsigned scope = devs_root_scope(ctx);
+    value_t ret = devs_root_push(ctx, devs_value_from_gc_obj(ctx, arr));
+
+    unsigned p = 0;
+    for (int i = 0; i < num; ++i) {
+        unsigned endp, next;
+        if (whole) {
+            endp = next = size;
+        } else if (sep_size == 0) {
+            endp = next = p + devs_utf8_code_point_length(data + p);
+        } else {
+            int e = devs_memfind(data + p, size - p, sep, sep_size);
+            endp = e < 0 ? size : p + e;
+            next = endp + sep_size;
+        }
+        value_t v = substring(ctx, str, data, size, p, endp);
+        if (devs_is_undefined(v))
+            break; // out of memory
+        arr->data[i] = v;
+        p = next;
+    }
+
+    devs_root_pop(ctx, scope);
+    devs_ret(ctx, ret);
+}
+
+static void meth2_String_replace_core(devs_ctx_t *ctx, bool all) {
+    value_t str = devs_arg_self(ctx);
+    unsigned search_size, repl_size;
+    const char *search_data = devs_arg_utf8_with_conv(ctx, 0, &search_size);
+    const char *repl_data = devs_arg_utf8_with_conv(ctx, 1, &repl_size);
+    unsigned size;
+    const char *data = devs_string_get_utf8(ctx, str, &size);
+    if (!data || !search_data || !repl_data)
+        return;
+
+    int off = devs_memfind(data, size, search_data, search_size);
+    if (off < 0) {
+        devs_ret(ctx, str);
+        return;
+    }
+
+    devs_strbuild_t sb;
+    devs_strbuild_init(ctx, &sb);
+    unsigned copied = 0;
+    while (off >= 0) {
+        devs_strbuild_add(&sb, data + copied, off - copied);
+        devs_strbuild_add(&sb, repl_data, repl_size);
+        copied = off + search_size;
+        if (!all)
+            break;
+        unsigned next = copied;
+        if (search_size == 0) {
+            // empty search string matches between all characters
+            if (next >= size)
+                break;
+            next += devs_utf8_code_point_length(data + next);
+        }
+        off = devs_memfind(data + next, size - next, search_data, search_size);
+        if (off >= 0)
+            off += next;
+    }
+    devs_strbuild_add(&sb, data + copied, size - copied);
+    devs_ret(ctx, devs_strbuild_finish(&sb));
+}
+
+void meth2_String_replace(devs_ctx_t *ctx) {
+    meth2_String_replace_core(ctx, false);
+}
+
+void meth2_String_replaceAll(devs_ctx_t *ctx) {
+    meth2_String_replace_core(ctx, true);
+}
+
+#define ONES ((uintptr_t)-1 / 0xff)
+#define HIGHS (ONES * 0x80)
+
+// 0x20 in every byte of w that is an ASCII letter in lo..lo+25
+static uintptr_t case_bits(uintptr_t w, unsigned lo) {
+    uintptr_t low7 = w & ~HIGHS;
+    uintptr_t ge_lo = low7 + ONES * (0x80 - lo);
+    uintptr_t gt_hi = low7 + ONES * (0x7f - (lo + 25));
+    return ((ge_lo ^ gt_hi) & ~w & HIGHS) >> 2;
+}
+
+static unsigned find_cased(const char *data, unsigned size, unsigned lo) {
+    unsigned i = 0;
+    for (; i + sizeof(uintptr_t) <= size; i += sizeof(uintptr_t)) {
+        uintptr_t w;
+        memcpy(&w, data + i, sizeof(w));
+        if (case_bits(w, lo))
+            break;
+    }
+    for (; i < size; ++i)
+        if ((uint8_t)data[i] - lo < 26)
+            break;
+    return i;
+}
+
+static void flip_case(char *data, unsigned size, unsigned lo) {
+    unsigned i = 0;
+    for (; i + sizeof(uintptr_t) <= size; i += sizeof(uintptr_t)) {
+        uintptr_t w;
+        memcpy(&w, data + i, sizeof(w));
+        w ^= case_bits(w, lo);
+        memcpy(data + i, &w, sizeof(w));
+    }
+    for (; i < size; ++i)
+        if ((uint8_t)data[i] - lo < 26)
+            data[i] ^= 0x20;
 }
 
 static void meth0_String_toCase(devs_ctx_t *ctx, int lower) {
@@ -110,22 +393,24 @@ static void meth0_String_toCase(devs_ctx_t *ctx, int lower) {
     if (!data)
         return;
 
+    // only ASCII letters are converted; UTF-8 sequences never contain ASCII bytes
+    unsigned lo = lower ? 'A' : 'a';
+    unsigned first = find_cased(data, size, lo);
+    if (first == size) {
+        devs_ret(ctx, str);
+        return;
+    }
+    if (size == 1) {
+        devs_ret(ctx, devs_string_from_ascii_char(data[0] ^ 0x20));
+        return;
+    }
+
     value_t r = devs_string_from_utf8(ctx, (const uint8_t *)data, size);
     char *dp = (char *)devs_string_get_utf8(ctx, r, &size);
     if (!dp)
         return;
 
-    for (unsigned i = 0; i < size; ++i) {
-        char c = dp[i];
-        if (lower) {
-            if ('A' <= c && c <= 'Z')
-                c += 32;
-        } else {
-            if ('a' <= c && c <= 'z')
-                c -= 32;
-        }
-        dp[i] = c;
-    }
+    flip_case(dp + first, size - first, lo);
 
     devs_ret(ctx, r);
 }
@@ -0,0 +1,327 @@
+#include "devs_internal.h"
+
+DEVS_DERIVE(Int8Array_prototype, TypedArray_prototype)
+DEVS_DERIVE(Uint8Array_prototype, TypedArray_prototype)
+DEVS_DERIVE(Int16Array_prototype, TypedArray_prototype)
+DEVS_DERIVE(Uint16Array_prototype, TypedArray_prototype)
+DEVS_DERIVE(Int32Array_prototype, TypedArray_prototype)
+DEVS_DERIVE(Uint32Array_prototype, TypedArray_prototype)
+DEVS_DERIVE(Float32Array_prototype, TypedArray_prototype)
+DEVS_DERIVE(Float64Array_prototype, TypedArray_prototype)
+
+STATIC_ASSERT(DEVS_BUILTIN_OBJECT_FLOAT64ARRAY_PROTOTYPE ==
+              DEVS_BUILTIN_OBJECT_INT8ARRAY_PROTOTYPE + 2 * DEVS_TYPED_ARRAY_FLOAT64);
+STATIC_ASSERT(DEVS_BUILTIN_STRING_FLOAT64ARRAY ==
+              DEVS_BUILTIN_STRING_INT8ARRAY + DEVS_TYPED_ARRAY_FLOAT64);
+
+static const uint8_t elt_size[DEVS_TYPED_ARRAY__MAX + 1] = {1, 1, 2, 2, 4, 4, 4, 8};
+
+unsigned devs_typed_array_proto_idx(unsigned kind) {
+    return DEVS_BUILTIN_OBJECT_INT8ARRAY_PROTOTYPE + 2 * kind;
+}
+
+unsigned devs_typed_array_name_idx(unsigned kind) {
+    return DEVS_BUILTIN_STRING_INT8ARRAY + kind;
+}
+
+static uint8_t *elt_ptr(devs_ctx_t *ctx, devs_typed_array_t *arr, unsigned idx) {
+    uint8_t *data = devs_buffer_data(ctx, arr->buffer, NULL);
+    return data + arr->offset + idx * elt_size[arr->kind];
+}
+
+// elements are accessed with memcpy(), as buffer data is only word-aligned
+
+value_t devs_typed_array_get(devs_ctx_t *ctx, devs_typed_array_t *arr, unsigned idx) {
+    if (idx >= arr->length)
+        return devs_undefined;
+
+    const uint8_t *p = elt_ptr(ctx, arr, idx);
+    switch (arr->kind) {
+    case DEVS_TYPED_ARRAY_INT8:
+        return devs_value_from_int((int8_t)*p);
+    case DEVS_TYPED_ARRAY_UINT8:
+        return devs_value_from_int(*p);
+    case DEVS_TYPED_ARRAY_INT16: {
+        int16_t v;
+        memcpy(&v, p, sizeof(v));
+        return devs_value_from_int(v);
+    }
+    case DEVS_TYPED_ARRAY_UINT16: {
+        uint16_t v;
+        memcpy(&v, p, sizeof(v));
+        return devs_value_from_int(v);
+    }
+    case DEVS_TYPED_ARRAY_INT32: {
+        int32_t v;
+        memcpy(&v, p, sizeof(v));
+        return devs_value_from_int(v);
+    }
+    case DEVS_TYPED_ARRAY_UINT32: {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return v <= INT32_MAX ? devs_value_from_int(v) : devs_value_from_double(v);
+    }
+    case DEVS_TYPED_ARRAY_FLOAT32: {
+        float v;
+        memcpy(&v, p, sizeof(v));
+        return devs_value_from_double(v);
+    }
+    case DEVS_TYPED_ARRAY_FLOAT64: {
+        double v;
+        memcpy(&v, p, sizeof(v));
+        return devs_value_from_double(v);
+    }
+    default:
+        JD_PANIC();
+        return devs_undefined;
+    }
+}
+
+static void store(devs_ctx_t *ctx, unsigned kind, uint8_t *p, value_t v) {
+    switch (kind) {
+    case DEVS_TYPED_ARRAY_FLOAT32: {
+        float f = devs_value_to_double(ctx, v);
+        memcpy(p, &f, sizeof(f));
+        break;
+    }
+    case DEVS_TYPED_ARRAY_FLOAT64: {
+        double d = devs_value_to_double(ctx, v);
+        memcpy(p, &d, sizeof(d));
+        break;
+    }
+    default: {
+        // integers wrap around, like in JS
+        int32_t i = devs_value_to_int(ctx, v);
+        if (elt_size[kind] == 1) {
+            *p = i;
+        } else if (elt_size[kind] == 2) {
+            int16_t h = i;
+            memcpy(p, &h, sizeof(h));
+        } else {
+            memcpy(p, &i, sizeof(i));
+        }
+        break;
+    }
+    }
+}
+
+static bool check_writable(devs_ctx_t *ctx, devs_typed_array_t *arr) {
+    if (devs_buffer_is_writable(ctx, arr->buffer))
+        return true;
+    devs_throw_expecting_error_ext(ctx, "mutable Buffer", arr->buffer);
+    return false;
+}
+
+void devs_typed_array_set(devs_ctx_t *ctx, devs_typed_array_t *arr, unsigned idx, value_t v) {
+    if (idx >= arr->length)
+        devs_throw_range_error(ctx, "typed array write at %u, len=%u", idx, arr->length);
+    else if (check_writable(ctx, arr))
+        store(ctx, arr->kind, elt_ptr(ctx, arr, idx), v);
+}
+
+// number of elements of an array or typed array, -1 for other values
+static int seq_length(devs_ctx_t *ctx, value_t v) {
+    devs_typed_array_t *tarr = devs_value_to_typed_array(ctx, v);
+    if (tarr)
+        return tarr->length;
+    if (devs_is_array(ctx, v))
+        return ((devs_array_t *)devs_value_to_gc_obj(ctx, v))->length;
+    return -1;
+}
+
+// src has to be an array or typed array that fits at dst_idx
+static void copy_from(devs_ctx_t *ctx, devs_typed_array_t *arr, unsigned dst_idx, value_t src) {
+    devs_typed_array_t *tsrc = devs_value_to_typed_array(ctx, src);
+    if (tsrc && tsrc->kind == arr->kind) {
+        // memmove(), as both may share a buffer
+        memmove(elt_ptr(ctx, arr, dst_idx), elt_ptr(ctx, tsrc, 0),
+                tsrc->length * elt_size[arr->kind]);
+    } else {
+        unsigned len = seq_length(ctx, src);
+        for (unsigned i = 0; i < len; ++i)
+            store(ctx, arr->kind, elt_ptr(ctx, arr, dst_idx + i), devs_seq_get(ctx, src, i));
+    }
+}
+
+static void meth3_TypedArray_init(devs_ctx_t *ctx, unsigned kind) {
+    // the runtime allocates a map, which we don't need
+    value_t ignored = devs_arg_self(ctx);
+    (void)ignored;
+
+    unsigned esz = elt_size[kind];
+    value_t arg0 = devs_arg(ctx, 0);
+    value_t buffer = arg0;
+    unsigned offset = 0;
+    int length;
+    bool copy = false;
+
+    if (devs_is_buffer(ctx, arg0)) {
+        unsigned sz;
+        devs_buffer_data(ctx, arg0, &sz);
+        int off = devs_arg_int(ctx, 1);
+        if (off < 0 || off > (int)sz || off % esz) {
+            devs_throw_range_error(ctx, "start offset should be a multiple of %u", esz);
+            return;
+        }
+        offset = off;
+        if (devs_is_null_or_undefined(devs_arg(ctx, 2))) {
+            if ((sz - offset) % esz) {
+                devs_throw_range_error(ctx, "buffer length should be a multiple of %u", esz);
+                return;
+            }
+            length = (sz - offset) / esz;
+        } else {
+            length = devs_arg_int(ctx, 2);
+            if (length < 0 || length > (int)((sz - offset) / esz)) {
+                devs_throw_range_error(ctx, "invalid typed array length: %d", length);
+                return;
+            }
+        }
+    } else {
+        length = devs_is_null_or_undefined(arg0) ? 0 : seq_length(ctx, arg0);
+        if (length > 0) {
+            copy = true;
+        } else if (length < 0) {
+            if (!devs_is_number(arg0)) {
+                devs_throw_type_error(ctx, "Expecting number, Buffer or array");
+                return;
+            }
+            length = devs_value_to_int(ctx, arg0);
+            if (length < 0) {
+                devs_throw_range_error(ctx, "invalid typed array length: %d", length);
+                return;
+            }
+        }
+        if (length > (int)(DEVS_MAX_ALLOC / esz)) {
+            devs_throw_too_big_error(ctx, devs_typed_array_name_idx(kind));
+            return;
+        }
+        devs_buffer_t *buf = devs_buffer_try_alloc(ctx, length * esz);
+        if (buf == NULL)
+            return;
+        buffer = devs_value_from_gc_obj(ctx, buf);
+    }
+
+    devs_typed_array_t *arr = devs_typed_array_try_alloc(ctx, kind, buffer, offset, length);
+    if (arr == NULL)
+        return;
+    devs_ret_gc_ptr(ctx, arr);
+
+    if (copy)
+        copy_from(ctx, arr, 0, arg0);
+}
+
+void meth3_Int8Array___ctor__(devs_ctx_t *ctx) {
+    meth3_TypedArray_init(ctx, DEVS_TYPED_ARRAY_INT8);
+}
+
+void meth3_Uint8Array___ctor__(devs_ctx_t *ctx) {
+    meth3_TypedArray_init(ctx, DEVS_TYPED_ARRAY_UINT8);
+}
+
+void meth3_Int16Array___ctor__(devs_ctx_t *ctx) {
+    meth3_TypedArray_init(ctx, DEVS_TYPED_ARRAY_INT16);
+}
+
+void meth3_Uint16Array___ctor__(devs_ctx_t *ctx) {
+    meth3_TypedArray_init(ctx, DEVS_TYPED_ARRAY_UINT16);
+}
+
+void meth3_Int32Array___ctor__(devs_ctx_t *ctx) {
+    meth3_TypedArray_init(ctx, DEVS_TYPED_ARRAY_INT32);
+}
+
+void meth3_Uint32Array___ctor__(devs_ctx_t *ctx) {
+    meth3_TypedArray_init(ctx, DEVS_TYPED_ARRAY_UINT32);
+}
+
+void meth3_Float32Array___ctor__(devs_ctx_t *ctx) {
+    meth3_TypedArray_init(ctx, DEVS_TYPED_ARRAY_FLOAT32);
+}
+
+void meth3_Float64Array___ctor__(devs_ctx_t *ctx) {
+    meth3_TypedArray_init(ctx, DEVS_TYPED_ARRAY_FLOAT64);
+}
+
+static devs_typed_array_t *to_typed_array(devs_ctx_t *ctx, value_t v) {
+    devs_typed_array_t *arr = devs_value_to_typed_array(ctx, v);
+    if (arr == NULL)
+        devs_throw_expecting_error_ext(ctx, "typed array", v);
+    return arr;
+}
+
+value_t prop_TypedArray_length(devs_ctx_t *ctx, value_t self) {
+    devs_typed_array_t *arr = to_typed_array(ctx, self);
+    return arr ? devs_value_from_int(arr->length) : devs_undefined;
+}
+
+value_t prop_TypedArray_buffer(devs_ctx_t *ctx, value_t self) {
+    devs_typed_array_t *arr = to_typed_array(ctx, self);
+    return arr ? arr->buffer : devs_undefined;
+}
+
+value_t prop_TypedArray_byteOffset(devs_ctx_t *ctx, value_t self) {
+    devs_typed_array_t *arr = to_typed_array(ctx, self);
+    return arr ? devs_value_from_int(arr->offset) : devs_undefined;
+}
+
+value_t prop_TypedArray_byteLength(devs_ctx_t *ctx, value_t self) {
+    devs_typed_array_t *arr = to_typed_array(ctx, self);
+    return arr ? devs_value_from_int(arr->length * elt_size[arr->kind]) : devs_undefined;
+}
+
+void meth2_TypedArray_subarray(devs_ctx_t *ctx) {
+    devs_typed_array_t *arr = to_typed_array(ctx, devs_arg_self(ctx));
+    if (arr == NULL)
+        return;
+
+    unsigned start = devs_rel_index(devs_arg_int(ctx, 0), arr->length);
+    unsigned endp = devs_rel_index(devs_arg_int_defl(ctx, 1, arr->length), arr->length);
+    if (endp < start)
+        endp = start;
+
+    devs_ret_gc_ptr(ctx, devs_typed_array_try_alloc(ctx, arr->kind, arr->buffer,
+                                                    arr->offset + start * elt_size[arr->kind],
+                                                    endp - start));
+}
+
+void meth2_TypedArray_set(devs_ctx_t *ctx) {
+    devs_typed_array_t *arr = to_typed_array(ctx, devs_arg_self(ctx));
+    if (arr == NULL || !check_writable(ctx, arr))
+        return;
+
+    value_t src = devs_arg(ctx, 0);
+    int len = seq_length(ctx, src);
+    if (len < 0) {
+        devs_throw_expecting_error(ctx, DEVS_BUILTIN_STRING_ARRAY, src);
+        return;
+    }
+
+    int offset = devs_arg_int(ctx, 1);
+    if (offset < 0 || offset + len > arr->length) {
+        devs_throw_range_error(ctx, "offset is out of bounds");
+        return;
+    }
+
+    copy_from(ctx, arr, offset, src);
+}
+
+void meth3_TypedArray_fill(devs_ctx_t *ctx) {
+    value_t self = devs_arg_self(ctx);
+    devs_typed_array_t *arr = to_typed_array(ctx, self);
+    if (arr == NULL || !check_writable(ctx, arr))
+        return;
+
+    unsigned start = devs_rel_index(devs_arg_int(ctx, 1), arr->length);
+    unsigned endp = devs_rel_index(devs_arg_int_defl(ctx, 2, arr->length), arr->length);
+    if (start < endp) {
+        // store the first element, and replicate its bytes
+        unsigned esz = elt_size[arr->kind];
+        uint8_t *p = elt_ptr(ctx, arr, start);
+        store(ctx, arr->kind, p, devs_arg(ctx, 0));
+        for (unsigned i = 1; i < endp - start; ++i)
+            memcpy(p + i * esz, p, esz);
+    }
+
+    devs_ret(ctx, self);
+}
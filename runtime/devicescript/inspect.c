@@ -6,49 +6,34 @@
 
 typedef struct {
     devs_ctx_t *ctx;
-    unsigned off;
-    unsigned size;
-    unsigned ulen;
-    char *dst;
+    devs_strbuild_t *sb;
+    // output stops at sb->size == limit
+    unsigned limit;
     uint8_t overflow;
+    // objects currently being printed are pushed since this root scope
+    unsigned scope;
 } inspect_t;
 
-static void add_str(inspect_t *state, const char *s) {
-    if (state->overflow)
-        return;
-
-    unsigned space = state->size - state->off;
-    unsigned sz = strlen(s);
-
-    if (sz > space) {
+// anything past the limit is cut off, and no further output is produced
+static void clip(inspect_t *state) {
+    if (state->sb->size > state->limit) {
         state->overflow = 1;
-
-        // the char at ep is the last one to be included
-        int ep = (int)space - 1;
-        if (ep >= 0 && s[ep] & 0x80) {
-            while (ep >= 0) {
-                if (!devs_utf8_is_cont(s[ep])) {
-                    ep--;
-                    break;
-                }
-                ep--;
-            }
-        }
-        sz = ep + 1;
+        devs_strbuild_truncate(state->sb, state->limit);
     }
-
-    for (unsigned i = 0; i < sz; ++i) {
-        if (!devs_utf8_is_cont(s[i]))
-            state->ulen++;
-        if (state->dst)
-            state->dst[state->off + i] = s[i];
-    }
-    state->off += sz;
 }
 
 static void add_ch(inspect_t *state, char c) {
-    char s[2] = {c, 0};
-    add_str(state, s);
+    if (state->overflow)
+        return;
+    devs_strbuild_add_ch(state->sb, c, 1);
+    clip(state);
+}
+
+static void add_str(inspect_t *state, const char *s) {
+    if (state->overflow)
+        return;
+    devs_strbuild_add(state->sb, s, strlen(s));
+    clip(state);
 }
 
 static void inspect_obj(inspect_t *state, value_t v);
@@ -76,7 +61,8 @@ static void inspect_field(devs_ctx_t *ctx, void *state_, value_t k, value_t v) {
         const char *d = devs_string_get_utf8(ctx, k, &size);
         if (is_id(d, size)) {
             id = 1;
-            add_str(state, d);
+            devs_strbuild_add_string(state->sb, k);
+            clip(state);
         }
     }
     if (!id)
@@ -99,37 +85,34 @@ static void inspect_obj(inspect_t *state, value_t v) {
     devs_ctx_t *ctx = state->ctx;
 
     // LOG_VAL("str", v);
-    LOGV("off=%d", state->off);
+    LOGV("size=%d", state->sb->size);
 
-    if (state->overflow)
+    if (state->overflow || ctx->error_code)
         return;
 
-    if (devs_value_is_pinned(ctx, v)) {
+    if (devs_root_in_scope(ctx, state->scope, v)) {
         add_str(state, "[Circular]");
         return;
     }
 
     unsigned type_of = devs_value_typeof(ctx, v);
 
-    unsigned sz;
-    const char *data = NULL;
-
     if (type_of == DEVS_OBJECT_TYPE_STRING) {
-        data = devs_string_get_utf8(ctx, v, &sz);
-        char *p = devs_json_escape(data, sz);
-        add_str(state, p);
-        jd_free(p);
+        unsigned sz;
+        const char *data = devs_string_get_utf8(ctx, v, &sz);
+        devs_json_escape_to(state->sb, data, sz);
+        clip(state);
         return;
     }
 
     if (!is_complex(type_of) || devs_handle_type(v) == DEVS_HANDLE_TYPE_ROLE_MEMBER) {
-        v = devs_value_to_string(ctx, v);
-        data = devs_string_get_utf8(ctx, v, &sz);
-        add_str(state, data);
+        devs_strbuild_add_value(state->sb, v);
+        clip(state);
         return;
     }
 
-    devs_value_pin(ctx, v);
+    unsigned scope = devs_root_scope(ctx);
+    devs_root_push(ctx, v);
 
     if (devs_is_array(ctx, v)) {
         devs_array_t *arr = devs_value_to_gc_obj(ctx, v);
@@ -142,6 +125,17 @@ static void inspect_obj(inspect_t *state, value_t v) {
                 add_ch(state, ',');
         }
         add_ch(state, ']');
+    } else if (devs_value_to_typed_array(ctx, v)) {
+        devs_typed_array_t *arr = devs_value_to_typed_array(ctx, v);
+        add_ch(state, '[');
+        for (unsigned i = 0; i < arr->length; ++i) {
+            inspect_obj(state, devs_typed_array_get(ctx, arr, i));
+            if (state->overflow)
+                break;
+            if ((int)i != arr->length - 1)
+                add_ch(state, ',');
+        }
+        add_ch(state, ']');
     } else {
         devs_maplike_t *map = devs_object_get_attached_enum(ctx, v);
         add_ch(state, '{');
@@ -152,55 +146,45 @@ static void inspect_obj(inspect_t *state, value_t v) {
         add_ch(state, '}');
     }
 
-    devs_value_unpin(ctx, v);
+    devs_root_pop(ctx, scope);
 }
 
-static int devs_inspect_to(devs_ctx_t *ctx, value_t v, char *dst, unsigned size, unsigned *ulen) {
+void devs_inspect_to(devs_strbuild_t *sb, value_t v, unsigned size) {
+    devs_ctx_t *ctx = sb->ctx;
+
+    if (size == 0)
+        size = 100;
+
+    unsigned type_of = devs_value_typeof(ctx, v);
+    if (!is_complex(type_of)) {
+        devs_strbuild_add_value(sb, v);
+        return;
+    }
+
     if (size < 10)
-        return -1;
+        return;
 
     inspect_t state = {
         .ctx = ctx,
-        .dst = dst,
-        .off = 0,
-        .size = size - 3, // space for final '...'
-        .ulen = 0,
+        .sb = sb,
+        .limit = sb->size + size - 3, // space for final '...'
+        .scope = devs_root_scope(ctx),
     };
     inspect_obj(&state, v);
-    JD_ASSERT(state.off + 3 <= size);
 
     if (state.overflow)
-        state.ulen += 3;
-    *ulen = state.ulen;
-
-    if (!dst)
-        return state.overflow ? state.off + 3 : state.off;
-
-    if (state.overflow) {
-        dst[state.off++] = '.';
-        dst[state.off++] = '.';
-        dst[state.off++] = '.';
-    }
-    return state.off;
+        devs_strbuild_add_ch(sb, '.', 3);
 }
 
 value_t devs_inspect(devs_ctx_t *ctx, value_t v, unsigned size) {
-    if (size == 0)
-        size = 100;
     unsigned type_of = devs_value_typeof(ctx, v);
     if (!is_complex(type_of))
         return devs_value_to_string(ctx, v);
-
-    unsigned ulen;
-    int sz = devs_inspect_to(ctx, v, NULL, size, &ulen);
-    if (sz == -1)
+    if (size != 0 && size < 10)
         return devs_undefined;
 
-    value_t r;
-    char *d = devs_string_prep(ctx, &r, sz, ulen);
-    if (d) {
-        sz = devs_inspect_to(ctx, v, d, size, &ulen);
-        devs_string_finish(ctx, &r, sz, ulen);
-    }
-    return r;
-}
\ No newline at end of file
+    devs_strbuild_t sb;
+    devs_strbuild_init(ctx, &sb);
+    devs_inspect_to(&sb, v, size);
+    return devs_strbuild_finish(&sb);
+}
@@ -10,7 +10,6 @@
 static void devs_jd_setup_cached(devs_ctx_t *ctx, unsigned role_idx,
                                  devs_regcache_entry_t *cached) {
     jd_device_service_t *serv = devs_role_service(ctx, role_idx);
-    cached = devs_regcache_mark_used(&ctx->regcache, cached);
     memset(&ctx->packet, 0, sizeof(ctx->packet));
     ctx->packet.service_command = cached->service_command;
     ctx->packet.service_size = cached->resp_size;
@@ -35,6 +34,8 @@ void devs_jd_get_register(devs_ctx_t *ctx, unsigned role_idx, unsigned code, uns
             if (cached->last_refresh_time + timeout < devs_now(ctx)) {
                 devs_regcache_free(&ctx->regcache, cached);
             } else {
+                ctx->regcache.num_hits++;
+                devs_regcache_mark_used(&ctx->regcache, cached);
                 devs_jd_setup_cached(ctx, role_idx, cached);
                 return;
             }
@@ -184,14 +185,13 @@ value_t devs_jd_pkt_capture(devs_ctx_t *ctx, unsigned role_idx) {
     if (pkt == NULL)
         return devs_undefined;
 
-    value_t r = devs_value_from_gc_obj(ctx, pkt);
-    devs_value_pin(ctx, r);
+    unsigned scope = devs_root_scope(ctx);
+    value_t r = devs_root_push(ctx, devs_value_from_gc_obj(ctx, pkt));
 
     pkt->payload = devs_buffer_try_alloc_init(ctx, ctx->packet.data, ctx->packet.service_size);
-    if (pkt->payload == NULL) {
-        devs_value_unpin(ctx, r);
+    devs_root_pop(ctx, scope);
+    if (pkt->payload == NULL)
         return devs_undefined;
-    }
     pkt->device_id = ctx->packet.device_identifier;
     pkt->service_index = ctx->packet.service_index;
     pkt->service_command = ctx->packet.service_command;
@@ -199,7 +199,6 @@ value_t devs_jd_pkt_capture(devs_ctx_t *ctx, unsigned role_idx) {
     pkt->roleidx = role_idx;
     pkt->crc = ctx->packet.crc;
 
-    devs_value_unpin(ctx, r);
     return r;
 }
 
@@ -274,10 +273,9 @@ static devs_regcache_entry_t *devs_jd_update_regcache(devs_ctx_t *ctx, unsigned
         q = NULL;
     }
 
-    if (!q) {
-        q = devs_regcache_alloc(&ctx->regcache, role_idx, pkt->service_command, resp_size);
-        q->argument = command_arg;
-    }
+    if (!q)
+        q = devs_regcache_alloc(&ctx->regcache, role_idx, pkt->service_command, command_arg,
+                                resp_size);
 
     memcpy(devs_regcache_data(q), dp, resp_size);
     q->last_refresh_time = devs_now(ctx);
@@ -326,6 +324,9 @@ static bool handle_reg_get(devs_fiber_t *fiber) {
             devs_regcache_lookup(&ctx->regcache, fiber->role_idx, fiber->service_command,
                                  fiber->pkt_data.reg_get.string_idx);
         if (cached) {
+            // the value came from the bus while we waited
+            ctx->regcache.num_misses++;
+            devs_regcache_mark_used(&ctx->regcache, cached);
             devs_jd_setup_cached(ctx, fiber->role_idx, cached);
             return RESUME_USER_CODE;
         }
@@ -544,7 +545,8 @@ int devs_jd_alloc_role(devs_ctx_t *ctx, value_t name, uint32_t srv_class) {
         return -3;
     }
 
-    devs_value_pin(ctx, name);
+    unsigned scope = devs_root_scope(ctx);
+    devs_root_push(ctx, name);
     int idx = -1;
     const char *n = devs_string_get_utf8(ctx, name, NULL);
     if (!n)
@@ -583,7 +585,7 @@ int devs_jd_alloc_role(devs_ctx_t *ctx, value_t name, uint32_t srv_class) {
     }
 
 exit:
-    devs_value_unpin(ctx, name);
+    devs_root_pop(ctx, scope);
     return idx;
 }
 
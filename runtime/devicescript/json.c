@@ -1,6 +1,14 @@
 #include "devs_internal.h"
 #include <stdlib.h>
 
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
 #define LOG_TAG "JSON"
 #include "devs_logging.h"
 
@@ -27,7 +35,8 @@ static unsigned devs_json_escape_core(const char *str, unsigned sz, char *dst, u
             c = 't';
             break;
         default:
-            if (c >= 32) {
+            // char may be signed; UTF-8 lead and continuation bytes are copied as is
+            if ((uint8_t)c >= 32) {
                 len++;
                 if (dst)
                     *dst++ = c;
@@ -73,32 +82,230 @@ char *devs_json_escape(const char *str, unsigned sz) {
     return r;
 }
 
+void devs_json_escape_to(devs_strbuild_t *sb, const char *str, unsigned sz) {
+    unsigned ulen;
+    unsigned len = devs_json_escape_core(str, sz, NULL, NULL);
+    char *dst = devs_strbuild_reserve(sb, len);
+    if (dst) {
+        devs_json_escape_core(str, sz, dst, &ulen);
+        // skip final NUL
+        devs_strbuild_commit(sb, len - 1, ulen - 1);
+    }
+}
+
+// The parser makes a single pass over the input; strings without escapes are found with
+// SIMD (where available) and copied directly.
+// For larger inputs, a structural prepass first counts the elements of every array and
+// object, so they can be allocated at their final size.
+
+// inputs shorter than this are not pre-sized
+#define JSON_PRESIZE_MIN 128
+// containers nested deeper are not pre-sized
+#define JSON_PRESIZE_DEPTH 32
+
 typedef struct {
     devs_ctx_t *ctx;
     const char *ptr0;
     const char *ptr;
-    unsigned size;
-    unsigned ulen;
+    const char *end;
     int16_t ch;
     bool error;
+    // number of elements of each array/object, in the order they are opened; only a hint
+    uint16_t *counts;
+    unsigned num_counts;
+    unsigned next_container;
 } parser_t;
 
+#if defined(__SSE2__)
+static inline unsigned match_mask(__m128i v, char c) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+static inline uint8x16_t match_vec(uint8x16_t v, char c) {
+    return vceqq_u8(v, vdupq_n_u8(c));
+}
+#elif defined(__wasm_simd128__)
+static inline v128_t match_vec(v128_t v, char c) {
+    return wasm_i8x16_eq(v, wasm_i8x16_splat(c));
+}
+#else
+#define ONES ((uintptr_t)-1 / 0xff)
+// non-zero if any byte of w is c
+static inline uintptr_t has_byte(uintptr_t w, char c) {
+    w ^= ONES * (uint8_t)c;
+    return (w - ONES) & ~w & (ONES * 0x80);
+}
+#endif
+
+// length of prefix of p without '"' or '\\'
+static unsigned string_run(const char *p, const char *end) {
+    const char *sp = p;
+#if defined(__SSE2__)
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        unsigned m = match_mask(v, '"') | match_mask(v, '\\');
+        if (m)
+            return p - sp + __builtin_ctz(m);
+        p += 16;
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    while (end - p >= 16) {
+        uint8x16_t v = vld1q_u8((const uint8_t *)p);
+        if (vmaxvq_u8(vorrq_u8(match_vec(v, '"'), match_vec(v, '\\'))))
+            break;
+        p += 16;
+    }
+#elif defined(__wasm_simd128__)
+    while (end - p >= 16) {
+        v128_t v = wasm_v128_load(p);
+        unsigned m = wasm_i8x16_bitmask(wasm_v128_or(match_vec(v, '"'), match_vec(v, '\\')));
+        if (m)
+            return p - sp + __builtin_ctz(m);
+        p += 16;
+    }
+#else
+    while (end - p >= (int)sizeof(uintptr_t)) {
+        uintptr_t w;
+        memcpy(&w, p, sizeof(w));
+        if (has_byte(w, '"') | has_byte(w, '\\'))
+            break;
+        p += sizeof(w);
+    }
+#endif
+    while (p < end && *p != '"' && *p != '\\')
+        p++;
+    return p - sp;
+}
+
+static bool is_structural(char c) {
+    // (c | 0x20) maps '[' to '{' and ']' to '}'
+    return c == '"' || c == ',' || (c | 0x20) == '{' || (c | 0x20) == '}';
+}
+
+// length of prefix of p without any of '"' ',' '[' ']' '{' '}'
+static unsigned plain_run(const char *p, const char *end) {
+    const char *sp = p;
+#if defined(__SSE2__)
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        __m128i lc = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        unsigned m = match_mask(v, '"') | match_mask(v, ',') | match_mask(lc, '{') |
+                     match_mask(lc, '}');
+        if (m)
+            return p - sp + __builtin_ctz(m);
+        p += 16;
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    while (end - p >= 16) {
+        uint8x16_t v = vld1q_u8((const uint8_t *)p);
+        uint8x16_t lc = vorrq_u8(v, vdupq_n_u8(0x20));
+        uint8x16_t m = vorrq_u8(match_vec(v, '"'), match_vec(v, ','));
+        m = vorrq_u8(m, vorrq_u8(match_vec(lc, '{'), match_vec(lc, '}')));
+        if (vmaxvq_u8(m))
+            break;
+        p += 16;
+    }
+#elif defined(__wasm_simd128__)
+    while (end - p >= 16) {
+        v128_t v = wasm_v128_load(p);
+        v128_t lc = wasm_v128_or(v, wasm_i8x16_splat(0x20));
+        v128_t m = wasm_v128_or(match_vec(v, '"'), match_vec(v, ','));
+        m = wasm_v128_or(m, wasm_v128_or(match_vec(lc, '{'), match_vec(lc, '}')));
+        unsigned mask = wasm_i8x16_bitmask(m);
+        if (mask)
+            return p - sp + __builtin_ctz(mask);
+        p += 16;
+    }
+#endif
+    while (p < end && !is_structural(*p))
+        p++;
+    return p - sp;
+}
+
+static bool is_open(char c) {
+    return c == '[' || c == '{';
+}
+
+// upper bound on the number of arrays and objects
+static unsigned count_open(const char *p, const char *end) {
+    unsigned n = 0;
+#if defined(__SSE2__)
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        n += __builtin_popcount(match_mask(_mm_or_si128(v, _mm_set1_epi8(0x20)), '{'));
+        p += 16;
+    }
+#endif
+    while (p < end)
+        n += is_open(*p++);
+    return n;
+}
+
+static const char *skip_string(const char *p, const char *end) {
+    for (;;) {
+        p += string_run(p, end);
+        if (p >= end)
+            return end;
+        if (*p == '"')
+            return p + 1;
+        p += 2; // backslash and whatever follows it
+    }
+}
+
+static void count_elements(parser_t *state) {
+    const char *p = state->ptr;
+    const char *end = state->end;
+    unsigned stack[JSON_PRESIZE_DEPTH];
+    unsigned depth = 0;
+    unsigned idx = 0;
+
+    while (p < end) {
+        p += plain_run(p, end);
+        if (p >= end)
+            break;
+        char c = *p++;
+        if (c == '"') {
+            p = skip_string(p, end);
+        } else if (c == ',') {
+            if (depth && depth <= JSON_PRESIZE_DEPTH) {
+                uint16_t *cnt = &state->counts[stack[depth - 1]];
+                if (*cnt < 0xffff)
+                    (*cnt)++;
+            }
+        } else if (is_open(c)) {
+            if (idx >= state->num_counts)
+                break;
+            // empty containers are checked for by the parser
+            state->counts[idx] = 1;
+            if (depth < JSON_PRESIZE_DEPTH)
+                stack[depth] = idx;
+            depth++;
+            idx++;
+        } else if (depth) {
+            depth--; // ']' or '}'
+        }
+    }
+}
+
+static unsigned next_count(parser_t *state) {
+    unsigned idx = state->next_container++;
+    return idx < state->num_counts ? state->counts[idx] : 0;
+}
+
 inline static int get_ch(parser_t *state) {
     if (state->error)
         return -1;
-    if (state->size == 0)
+    if (state->ptr >= state->end)
         return (state->ch = -1);
-    state->size--;
     return (state->ch = *state->ptr++);
 }
 
 static int get_non_ws(parser_t *state) {
-    for (;;) {
-        int c = get_ch(state);
-        if (c == ' ' || c == '\n' || c == '\t' || c == '\r')
-            continue;
-        return c;
-    }
+    const char *p = state->ptr;
+    while (p < state->end && (*p == ' ' || *p == '\n' || *p == '\t' || *p == '\r'))
+        p++;
+    state->ptr = p;
+    return get_ch(state);
 }
 
 static bool shift_next(parser_t *state, char exp) {
@@ -108,7 +315,6 @@ static bool shift_next(parser_t *state, char exp) {
     if (c == exp)
         return true;
     state->ptr--;
-    state->size++;
     return false;
 }
 
@@ -135,123 +341,127 @@ static int parse_hex(parser_t *state) {
     return (dst[0] << 8) | dst[1];
 }
 
-static int parse_string_core(parser_t *state, char *dst) {
-    int p = 0;
+// called with ptr at the first backslash
+static value_t parse_escaped_string(parser_t *state, const char *start) {
+    devs_strbuild_t sb;
+    devs_strbuild_init(state->ctx, &sb);
+    devs_strbuild_add(&sb, start, state->ptr - start);
+
     int surr = 0;
     for (;;) {
         int c = get_ch(state);
         if (c == -1)
-            return -1;
+            goto fail;
         if (c == '"')
             break;
-        else if (c == '\\') {
-            c = get_ch(state);
-            switch (c) {
-            case 'n':
-                c = '\n';
-                break;
-            case 't':
-                c = '\t';
-                break;
-            case 'r':
-                c = '\r';
-                break;
-            case 'b':
-                c = '\b';
-                break;
-            case 'f':
-                c = '\f';
-                break;
-            case '"':
-            case '/':
-            case '\\':
-                // c = c;
-                break;
-            case 'u': {
-                c = parse_hex(state);
-                if (c == -1)
-                    return -1;
-                if (0xD800 <= c && c <= 0xDBFF) {
-                    if (surr)
-                        return -1;
-                    surr = c;
-                    continue;
-                }
-                if (0xDC00 <= c && c <= 0xDFFF) {
-                    if (!surr)
-                        return -1;
-                    c = 0x10000 + ((surr - 0xD800) * 0x400) + (c - 0xDC00);
-                    surr = 0;
-                }
-                char buf[4];
-                unsigned len = devs_utf8_from_code_point(c, buf);
-                p += len;
-                state->ulen++;
-                if (dst) {
-                    memcpy(dst, buf, len);
-                    dst += len;
-                }
+        if (c != '\\') {
+            if (surr)
+                goto fail;
+            const char *p = state->ptr - 1;
+            unsigned n = string_run(p, state->end);
+            devs_strbuild_add(&sb, p, n);
+            state->ptr = p + n;
+            continue;
+        }
+
+        c = get_ch(state);
+        switch (c) {
+        case 'n':
+            c = '\n';
+            break;
+        case 't':
+            c = '\t';
+            break;
+        case 'r':
+            c = '\r';
+            break;
+        case 'b':
+            c = '\b';
+            break;
+        case 'f':
+            c = '\f';
+            break;
+        case '"':
+        case '/':
+        case '\\':
+            // c = c;
+            break;
+        case 'u': {
+            c = parse_hex(state);
+            if (c == -1)
+                goto fail;
+            if (0xD800 <= c && c <= 0xDBFF) {
+                if (surr)
+                    goto fail;
+                surr = c;
                 continue;
             }
-            default:
-                return -1;
+            if (0xDC00 <= c && c <= 0xDFFF) {
+                if (!surr)
+                    goto fail;
+                c = 0x10000 + ((surr - 0xD800) * 0x400) + (c - 0xDC00);
+                surr = 0;
             }
+            char buf[4];
+            devs_strbuild_add(&sb, buf, devs_utf8_from_code_point(c, buf));
+            continue;
+        }
+        default:
+            goto fail;
         }
         if (surr)
-            return -1;
-        if (dst)
-            *dst++ = c;
-        if (!devs_utf8_is_cont(c))
-            state->ulen++;
-        p++;
+            goto fail;
+        devs_strbuild_add_ch(&sb, c, 1);
     }
 
     if (surr)
-        return -1;
-    return p;
+        goto fail;
+    return devs_strbuild_finish(&sb);
+
+fail:
+    devs_strbuild_free(&sb);
+    return error(state);
 }
 
 static value_t parse_string(parser_t *state) {
     const char *p = state->ptr;
-    unsigned sz = state->size;
-    state->ulen = 0;
-    int slen = parse_string_core(state, NULL);
-    if (slen == -1)
-        return error(state);
-    if (slen == 0)
-        return devs_builtin_string(DEVS_BUILTIN_STRING__EMPTY);
-    state->ptr = p;
-    state->size = sz;
-
-    devs_ctx_t *ctx = state->ctx;
-    value_t r;
-    char *d = devs_string_prep(ctx, &r, slen, state->ulen);
-    if (d) {
-        state->ulen = 0;
-        slen = parse_string_core(state, d);
-        devs_string_finish(ctx, &r, slen, state->ulen);
+    unsigned n = string_run(p, state->end);
+    state->ptr = p + n;
+    if (state->ptr < state->end && *state->ptr == '"') {
+        // no escapes
+        state->ptr++;
+        if (n == 0)
+            return devs_builtin_string(DEVS_BUILTIN_STRING__EMPTY);
+        return devs_string_from_utf8(state->ctx, (const uint8_t *)p, n);
     }
-
-    return r;
+    return parse_escaped_string(state, p);
 }
 
 static value_t parse_array(parser_t *state) {
     devs_ctx_t *ctx = state->ctx;
-    devs_array_t *arr = devs_array_try_alloc(ctx, 0);
+    unsigned count = next_count(state);
+    bool empty = shift_next(state, ']');
+    devs_array_t *arr = devs_array_try_alloc(ctx, empty ? 0 : count);
     if (!arr)
         return devs_undefined;
     value_t ret = devs_value_from_gc_obj(ctx, arr);
 
-    if (shift_next(state, ']'))
+    if (empty)
         return ret;
 
-    devs_value_pin(ctx, ret);
+    unsigned scope = devs_root_scope(ctx);
+    devs_root_push(ctx, ret);
 
+    unsigned len = 0;
     for (;;) {
         value_t e = json_value(state);
         if (state->error)
             goto fail;
-        devs_array_pin_push(ctx, arr, e);
+        if (len < count)
+            arr->data[len] = e;
+        else
+            devs_array_pin_push(ctx, arr, e);
+        len++;
         int c = get_non_ws(state);
         if (c == ',')
             continue;
@@ -259,17 +469,21 @@ static value_t parse_array(parser_t *state) {
             break;
         goto fail;
     }
+    if (len < count)
+        arr->length = len; // the count was too high; can't really happen
 
-    devs_value_unpin(ctx, ret);
+    devs_root_pop(ctx, scope);
     return ret;
 
 fail:
-    devs_value_unpin(ctx, ret);
+    devs_root_pop(ctx, scope);
     return error(state);
 }
 
 static value_t parse_object(parser_t *state) {
     devs_ctx_t *ctx = state->ctx;
+    // maps grow on demand, but the prepass counted this one too
+    next_count(state);
     devs_map_t *arr = devs_map_try_alloc(ctx, 0);
     if (!arr)
         return devs_undefined;
@@ -278,7 +492,8 @@ static value_t parse_object(parser_t *state) {
     if (shift_next(state, '}'))
         return ret;
 
-    devs_value_pin(ctx, ret);
+    unsigned scope = devs_root_scope(ctx);
+    devs_root_push(ctx, ret);
 
     for (;;) {
         if (get_non_ws(state) != '"')
@@ -289,14 +504,14 @@ static value_t parse_object(parser_t *state) {
         if (get_non_ws(state) != ':')
             goto fail;
 
-        devs_value_pin(ctx, key);
+        unsigned key_scope = devs_root_scope(ctx);
+        devs_root_push(ctx, key);
         value_t val = json_value(state);
         if (!state->error) {
-            devs_value_pin(ctx, val);
+            devs_root_push(ctx, val);
             devs_map_set(ctx, arr, key, val);
-            devs_value_unpin(ctx, val);
         }
-        devs_value_unpin(ctx, key);
+        devs_root_pop(ctx, key_scope);
         if (state->error)
             goto fail;
 
@@ -308,20 +523,20 @@ static value_t parse_object(parser_t *state) {
         goto fail;
     }
 
-    devs_value_unpin(ctx, ret);
+    devs_root_pop(ctx, scope);
     return ret;
 
 fail:
-    devs_value_unpin(ctx, ret);
+    devs_root_pop(ctx, scope);
     return error(state);
 }
 
 static int istoken(parser_t *state, const char *name) {
     if (name[0] == state->ch) {
         unsigned len = strlen(name + 1);
-        if (state->size >= len && memcmp(state->ptr, name + 1, len) == 0) {
+        if ((unsigned)(state->end - state->ptr) >= len &&
+            memcmp(state->ptr, name + 1, len) == 0) {
             state->ptr += len;
-            state->size -= len;
             return true;
         }
     }
@@ -331,6 +546,8 @@ static int istoken(parser_t *state, const char *name) {
 static value_t json_value(parser_t *state) {
     if (state->error)
         return devs_undefined;
+    if (state->ctx->error_code)
+        return error(state);
     int c = get_non_ws(state);
     if (c == '{')
         return parse_object(state);
@@ -346,12 +563,10 @@ static value_t json_value(parser_t *state) {
         return devs_false;
     else if (c == '-' || ('0' <= c && c <= '9')) {
         char *endp;
-        double v = strtod(state->ptr - 1, &endp);
+        double v = devs_strtod(state->ptr - 1, &endp);
         if (endp == state->ptr - 1)
             return error(state);
-        int sz = state->size - (endp - state->ptr);
-        JD_ASSERT(sz >= 0);
-        state->size = sz;
+        JD_ASSERT(endp <= state->end);
         state->ptr = endp;
         return devs_value_from_double(v);
     } else
@@ -366,18 +581,34 @@ static value_t throw_err(parser_t *state) {
 }
 
 value_t devs_json_parse(devs_ctx_t *ctx, const char *str, unsigned sz, bool do_throw) {
-    JD_ASSERT(str[sz] == 0); // strtod requires this
+    JD_ASSERT(str[sz] == 0); // devs_strtod() requires this
     parser_t state = {
         .ctx = ctx,
         .ptr = str,
         .ptr0 = str,
-        .size = sz,
+        .end = str + sz,
     };
+
+    if (sz >= JSON_PRESIZE_MIN) {
+        state.num_counts = count_open(str, str + sz);
+        if (state.num_counts > 0xffff)
+            state.num_counts = 0xffff;
+        if (state.num_counts) {
+            state.counts = devs_try_alloc(ctx, state.num_counts * sizeof(uint16_t));
+            if (state.counts == NULL)
+                return devs_undefined;
+            count_elements(&state);
+        }
+    }
+
     value_t r = json_value(&state);
     if (!state.error) {
         if (get_non_ws(&state) != -1)
             error(&state);
     }
+
+    devs_free(ctx, state.counts);
+
     if (state.error) {
         if (do_throw)
             throw_err(&state);
@@ -389,21 +620,18 @@ value_t devs_json_parse(devs_ctx_t *ctx, const char *str, unsigned sz, bool do_t
 
 typedef struct {
     devs_ctx_t *ctx;
+    devs_strbuild_t *sb;
     int indent_step;
     int curr_indent;
-    unsigned off;
-    char *dst;
     int error;
-    unsigned ulen;
+    // fields written so far in the innermost object
+    unsigned num_fields;
+    // objects currently being stringified are pushed since this root scope
+    unsigned scope;
 } stringify_t;
 
 static void add_ch(stringify_t *state, char c, unsigned rep) {
-    if (state->dst)
-        for (unsigned i = 0; i < rep; ++i)
-            state->dst[state->off + i] = c;
-    state->off += rep;
-    if (!devs_utf8_is_cont(c))
-        state->ulen += rep;
+    devs_strbuild_add_ch(state->sb, c, rep);
 }
 
 static void add_indent(stringify_t *state) {
@@ -432,32 +660,26 @@ static void stringify_field(devs_ctx_t *ctx, void *state_, value_t k, value_t v)
         break;
     }
 
+    if (state->num_fields++)
+        add_ch(state, ',', 1);
     add_indent(state);
     stringify_obj(state, k);
     add_ch(state, ':', 1);
     if (state->curr_indent)
         add_ch(state, ' ', 1);
     stringify_obj(state, v);
-    add_ch(state, ',', 1);
 }
 
 static void stringify_obj(stringify_t *state, value_t v) {
     devs_ctx_t *ctx = state->ctx;
+    devs_strbuild_t *sb = state->sb;
 
     // LOG_VAL("str", v);
-    LOGV("off=%d", state->off);
+    LOGV("size=%d", sb->size);
 
-    if (devs_value_is_pinned(ctx, v)) {
-        state->error = 1;
-        return;
-    }
-    if (state->error)
+    if (state->error || sb->error || ctx->error_code)
         return;
 
-    char *dst = state->dst ? state->dst + state->off : NULL;
-    unsigned sz;
-    const char *data;
-
     switch (devs_value_typeof(ctx, v)) {
     case DEVS_OBJECT_TYPE_NUMBER:
         if (devs_handle_type(v) == DEVS_HANDLE_TYPE_SPECIAL)
@@ -472,24 +694,24 @@ static void stringify_obj(stringify_t *state, value_t v) {
     case DEVS_OBJECT_TYPE_BOOL:
     case DEVS_OBJECT_TYPE_NULL:
     case DEVS_OBJECT_TYPE_UNDEFINED:
-        v = devs_value_to_string(ctx, v);
-        data = devs_string_get_utf8(ctx, v, &sz);
-        if (dst)
-            memcpy(dst, data, sz);
-        state->off += sz;
-        state->ulen += sz; // ASCII-only
+        devs_strbuild_add_value(sb, v);
         return;
 
     case DEVS_OBJECT_TYPE_STRING: {
-        unsigned ulen;
-        data = devs_string_get_utf8(ctx, v, &sz);
-        state->off += devs_json_escape_core(data, sz, dst, &ulen) - 1;
-        state->ulen += ulen - 1;
+        unsigned sz;
+        const char *data = devs_string_get_utf8(ctx, v, &sz);
+        devs_json_escape_to(sb, data, sz);
         return;
     }
     }
 
-    devs_value_pin(ctx, v);
+    if (devs_root_in_scope(ctx, state->scope, v)) {
+        state->error = 1;
+        return;
+    }
+
+    unsigned scope = devs_root_scope(ctx);
+    devs_root_push(ctx, v);
 
     if (devs_is_array(ctx, v)) {
         devs_array_t *arr = devs_value_to_gc_obj(ctx, v);
@@ -511,55 +733,60 @@ static void stringify_obj(stringify_t *state, value_t v) {
         devs_maplike_t *map = devs_object_get_attached_enum(ctx, v);
         add_ch(state, '{', 1);
         if (map != NULL) {
-            unsigned off0 = state->off;
+            // commas go before fields, as the output may have been flushed already
+            unsigned num_fields = state->num_fields;
+            state->num_fields = 0;
             state->curr_indent += state->indent_step;
             devs_maplike_iter(ctx, map, state, stringify_field);
             state->curr_indent -= state->indent_step;
-            if (off0 != state->off) {
-                state->off--; // eat final comma
-                state->ulen--;
+            if (state->num_fields)
                 add_indent(state);
-            }
+            state->num_fields = num_fields;
         }
         add_ch(state, '}', 1);
     }
 
-    devs_value_unpin(ctx, v);
+    devs_root_pop(ctx, scope);
 }
 
-static int devs_json_stringify_to(devs_ctx_t *ctx, value_t v, char *dst, unsigned *len,
-                                  int indent) {
+static bool stringify(devs_ctx_t *ctx, devs_strbuild_t *sb, value_t v, int indent,
+                      bool do_throw) {
     stringify_t state = {
         .ctx = ctx,
+        .sb = sb,
         .indent_step = indent,
         .curr_indent = indent ? 1 : 0,
-        .dst = dst,
-        .ulen = 0,
+        .scope = devs_root_scope(ctx),
     };
     stringify_obj(&state, v);
-    LOGV("after off=%d", state.off);
-    *len = state.ulen;
-    if (state.error)
-        return -1;
-    return state.off;
+    LOGV("after size=%d", sb->size);
+
+    if (state.error && do_throw)
+        devs_throw_type_error(ctx, "Converting circular structure to JSON");
+    return !state.error;
 }
 
 value_t devs_json_stringify(devs_ctx_t *ctx, value_t v, int indent, bool do_throw) {
-    unsigned len;
-    int sz = devs_json_stringify_to(ctx, v, NULL, &len, indent);
-    if (sz == -1) {
-        if (do_throw)
-            devs_throw_type_error(ctx, "Converting circular structure to JSON");
+    devs_strbuild_t sb;
+    devs_strbuild_init(ctx, &sb);
+
+    if (!stringify(ctx, &sb, v, indent, do_throw)) {
+        devs_strbuild_free(&sb);
         return devs_undefined;
     }
 
-    value_t r;
+    return devs_strbuild_finish(&sb);
+}
 
-    char *d = devs_string_prep(ctx, &r, sz, len);
-    if (d) {
-        sz = devs_json_stringify_to(ctx, v, d, &len, indent);
-        devs_string_finish(ctx, &r, sz, len);
-    }
+int devs_json_stringify_to(devs_ctx_t *ctx, value_t v, int indent, unsigned chunk_size,
+                           devs_strbuild_sink_t sink, void *arg) {
+    devs_strbuild_t sb;
+    devs_strbuild_init_sink(ctx, &sb, chunk_size, sink, arg);
+
+    int r = -1;
+    if (stringify(ctx, &sb, v, indent, true))
+        r = devs_strbuild_flush(&sb);
 
+    devs_strbuild_free(&sb);
     return r;
 }
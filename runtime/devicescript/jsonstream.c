@@ -0,0 +1,469 @@
+#include "devs_internal.h"
+
+// Resumable JSON parser, fed with chunks of input as they arrive.
+// The complete document never has to be in memory; only the values built so far,
+// plus the string or number token currently being read.
+//
+// All state lives in a devs_json_parser_t, which the program holds (see JSONParser in
+// packages/core) but can't look into:
+//   token - buffer holding the bytes of the current string or number token
+//   stack - containers being filled; an object is followed by its pending key, if any
+//   state - json_stream_t
+
+#define LOG_TAG "JSON"
+#include "devs_logging.h"
+
+#define TOKEN_MIN_SIZE 32
+
+enum {
+    JS_VALUE,       // expecting a value
+    JS_FIRST_VALUE, // after '['
+    JS_AFTER_VALUE, // expecting ',' or a closing bracket
+    JS_KEY,         // expecting an object key
+    JS_FIRST_KEY,   // after '{'
+    JS_COLON,
+    JS_STRING,
+    JS_NUMBER,
+    JS_LITERAL,
+    JS_ERROR,
+};
+
+typedef struct {
+    uint8_t state;
+    uint8_t is_key;  // the string being read is an object key
+    uint8_t esc;     // 0 - none, 1 - after backslash, 2-5 - reading \u digits
+    uint8_t lit;     // index into literals[]
+    uint8_t lit_pos; // characters of the literal matched so far
+    uint16_t hex;    // value of \u digits read so far
+    uint16_t surr;   // pending high surrogate
+    uint32_t tok_size;
+    uint32_t pos; // bytes consumed so far
+} json_stream_t;
+
+typedef struct {
+    devs_ctx_t *ctx;
+    devs_json_parser_t *parser;
+    devs_array_t *st; // parser->stack
+    devs_array_t *out;
+    json_stream_t js;
+    int ch; // offending character, -1 for end of input
+} feeder_t;
+
+static const char *const literals[] = {"true", "false", "null"};
+
+static value_t literal_value(unsigned idx) {
+    return idx == 0 ? devs_true : idx == 1 ? devs_false : devs_null;
+}
+
+static bool fail(feeder_t *f, int ch) {
+    f->js.state = JS_ERROR;
+    f->ch = ch;
+    return false;
+}
+
+static int reject(feeder_t *f, int ch) {
+    fail(f, ch);
+    return -1;
+}
+
+static inline bool is_ws(int c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+static inline bool is_number_ch(int c) {
+    return ('0' <= c && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+static unsigned depth(feeder_t *f) {
+    return f->st->length;
+}
+
+static value_t top(feeder_t *f) {
+    return f->st->data[f->st->length - 1];
+}
+
+// room for sz more token bytes, plus a NUL terminator
+static uint8_t *token_reserve(feeder_t *f, unsigned sz) {
+    unsigned need = f->js.tok_size + sz + 1;
+    devs_buffer_t *tok = f->parser->token;
+    if (tok == NULL || tok->length < need) {
+        if (need > DEVS_MAX_ALLOC) {
+            devs_throw_too_big_error(f->ctx, DEVS_BUILTIN_STRING_STRING);
+            return NULL;
+        }
+        unsigned cap = tok ? tok->length * 2 : TOKEN_MIN_SIZE;
+        while (cap < need)
+            cap *= 2;
+        if (cap > DEVS_MAX_ALLOC)
+            cap = DEVS_MAX_ALLOC;
+        devs_buffer_t *ntok = devs_buffer_try_alloc(f->ctx, cap);
+        if (ntok == NULL)
+            return NULL;
+        if (tok)
+            memcpy(ntok->data, tok->data, f->js.tok_size);
+        f->parser->token = tok = ntok;
+    }
+    return tok->data + f->js.tok_size;
+}
+
+static bool token_add(feeder_t *f, const void *data, unsigned sz) {
+    uint8_t *dst = token_reserve(f, sz);
+    if (dst == NULL)
+        return false;
+    memcpy(dst, data, sz);
+    f->js.tok_size += sz;
+    return true;
+}
+
+static const uint8_t *token_data(feeder_t *f) {
+    devs_buffer_t *tok = f->parser->token;
+    JD_ASSERT(tok != NULL);
+    tok->data[f->js.tok_size] = 0;
+    return tok->data;
+}
+
+static bool push_container(feeder_t *f, void *obj, unsigned state) {
+    if (obj == NULL)
+        return false;
+    devs_array_pin_push(f->ctx, f->st, devs_value_from_gc_obj(f->ctx, obj));
+    f->js.state = state;
+    return !f->ctx->in_throw;
+}
+
+// a complete value was read; add it to whatever is being built
+static bool emit(feeder_t *f, value_t v) {
+    devs_ctx_t *ctx = f->ctx;
+    unsigned scope = devs_root_scope(ctx);
+    devs_root_push(ctx, v);
+
+    if (depth(f) == 0) {
+        devs_array_set(ctx, f->out, f->out->length, v);
+        f->js.state = JS_VALUE;
+    } else {
+        value_t t = top(f);
+        if (devs_is_array(ctx, t)) {
+            devs_array_t *arr = devs_value_to_gc_obj(ctx, t);
+            devs_array_set(ctx, arr, arr->length, v);
+        } else {
+            // top is the key, the object is just below it
+            devs_map_t *map = devs_value_to_gc_obj(ctx, f->st->data[f->st->length - 2]);
+            f->st->length--;
+            devs_root_push(ctx, t);
+            devs_map_set(ctx, map, t, v);
+        }
+        f->js.state = JS_AFTER_VALUE;
+    }
+
+    devs_root_pop(ctx, scope);
+    return !ctx->in_throw;
+}
+
+static bool close_container(feeder_t *f, int c) {
+    if (depth(f) == 0)
+        return fail(f, c);
+    value_t t = top(f);
+    bool is_arr = devs_is_array(f->ctx, t);
+    if (is_arr != (c == ']'))
+        return fail(f, c);
+    f->st->length--;
+    return emit(f, t);
+}
+
+static bool end_string(feeder_t *f) {
+    json_stream_t *js = &f->js;
+    if (js->surr)
+        return fail(f, '"');
+    value_t v = js->tok_size == 0 ? devs_builtin_string(DEVS_BUILTIN_STRING__EMPTY)
+                                  : devs_string_from_utf8(f->ctx, token_data(f), js->tok_size);
+    if (f->ctx->in_throw)
+        return false;
+    js->tok_size = 0;
+    if (js->is_key) {
+        devs_array_pin_push(f->ctx, f->st, v);
+        js->state = JS_COLON;
+        return !f->ctx->in_throw;
+    }
+    return emit(f, v);
+}
+
+static bool end_number(feeder_t *f) {
+    const char *tok = (const char *)token_data(f);
+    char *endp;
+    double d = devs_strtod(tok, &endp);
+    if (endp != tok + f->js.tok_size)
+        return fail(f, tok[endp - tok]);
+    f->js.tok_size = 0;
+    return emit(f, devs_value_from_double(d));
+}
+
+static bool string_escape(feeder_t *f, int c) {
+    json_stream_t *js = &f->js;
+
+    if (js->esc >= 2) {
+        int d = ('0' <= c && c <= '9')   ? c - '0'
+                : ('a' <= c && c <= 'f') ? c - 'a' + 10
+                : ('A' <= c && c <= 'F') ? c - 'A' + 10
+                                         : -1;
+        if (d < 0)
+            return fail(f, c);
+        js->hex = (js->hex << 4) | d;
+        if (++js->esc < 6)
+            return true;
+
+        js->esc = 0;
+        unsigned cp = js->hex;
+        js->hex = 0;
+        if (0xD800 <= cp && cp <= 0xDBFF) {
+            if (js->surr)
+                return fail(f, c);
+            js->surr = cp;
+            return true;
+        }
+        if (0xDC00 <= cp && cp <= 0xDFFF) {
+            if (!js->surr)
+                return fail(f, c);
+            cp = 0x10000 + ((js->surr - 0xD800) * 0x400) + (cp - 0xDC00);
+            js->surr = 0;
+        }
+        char buf[4];
+        return token_add(f, buf, devs_utf8_from_code_point(cp, buf));
+    }
+
+    switch (c) {
+    case 'u':
+        js->esc = 2;
+        return true;
+    case 'n':
+        c = '\n';
+        break;
+    case 't':
+        c = '\t';
+        break;
+    case 'r':
+        c = '\r';
+        break;
+    case 'b':
+        c = '\b';
+        break;
+    case 'f':
+        c = '\f';
+        break;
+    case '"':
+    case '/':
+    case '\\':
+        break;
+    default:
+        return fail(f, c);
+    }
+    js->esc = 0;
+    if (js->surr)
+        return fail(f, c);
+    char cc = c;
+    return token_add(f, &cc, 1);
+}
+
+// returns the number of bytes consumed from p[0..sz), or -1 on error
+static int feed_string(feeder_t *f, const uint8_t *p, unsigned sz) {
+    json_stream_t *js = &f->js;
+    int c = p[0];
+
+    if (js->esc) {
+        if (!string_escape(f, c))
+            return -1;
+        return 1;
+    }
+
+    if (c == '"')
+        return end_string(f) ? 1 : -1;
+    if (c == '\\') {
+        js->esc = 1;
+        return 1;
+    }
+    if (js->surr)
+        return reject(f, c);
+
+    // copy everything up to the next quote or backslash in one go
+    unsigned n = 1;
+    while (n < sz && p[n] != '"' && p[n] != '\\')
+        n++;
+    return token_add(f, p, n) ? (int)n : -1;
+}
+
+// returns the number of bytes consumed (0 when c should be looked at again), or -1 on error
+static int feed_char(feeder_t *f, uint8_t ch) {
+    json_stream_t *js = &f->js;
+    int c = ch;
+    devs_ctx_t *ctx = f->ctx;
+
+    switch (js->state) {
+    case JS_NUMBER:
+        if (is_number_ch(c))
+            return token_add(f, &ch, 1) ? 1 : -1;
+        return end_number(f) ? 0 : -1;
+
+    case JS_LITERAL: {
+        const char *lit = literals[js->lit];
+        if (c != lit[js->lit_pos])
+            return reject(f, c);
+        if (lit[++js->lit_pos] == 0 && !emit(f, literal_value(js->lit)))
+            return -1;
+        return 1;
+    }
+
+    case JS_COLON:
+        if (is_ws(c))
+            return 1;
+        if (c != ':')
+            return reject(f, c);
+        js->state = JS_VALUE;
+        return 1;
+
+    case JS_AFTER_VALUE:
+        if (is_ws(c))
+            return 1;
+        if (c == ',') {
+            js->state = devs_is_array(ctx, top(f)) ? JS_VALUE : JS_KEY;
+            return 1;
+        }
+        return close_container(f, c) ? 1 : -1;
+
+    case JS_FIRST_KEY:
+        if (c == '}')
+            return close_container(f, c) ? 1 : -1;
+        /* fall-through */
+    case JS_KEY:
+        if (is_ws(c))
+            return 1;
+        if (c != '"')
+            return reject(f, c);
+        js->state = JS_STRING;
+        js->is_key = 1;
+        return 1;
+
+    case JS_FIRST_VALUE:
+        if (c == ']')
+            return close_container(f, c) ? 1 : -1;
+        /* fall-through */
+    case JS_VALUE:
+        if (is_ws(c))
+            return 1;
+        if (c == '{')
+            return push_container(f, devs_map_try_alloc(ctx, NULL), JS_FIRST_KEY) ? 1 : -1;
+        if (c == '[')
+            return push_container(f, devs_array_try_alloc(ctx, 0), JS_FIRST_VALUE) ? 1 : -1;
+        if (c == '"') {
+            js->state = JS_STRING;
+            js->is_key = 0;
+            return 1;
+        }
+        if (c == '-' || ('0' <= c && c <= '9')) {
+            js->state = JS_NUMBER;
+            return token_add(f, &ch, 1) ? 1 : -1;
+        }
+        for (unsigned i = 0; i < sizeof(literals) / sizeof(literals[0]); ++i) {
+            if (c == literals[i][0]) {
+                js->state = JS_LITERAL;
+                js->lit = i;
+                js->lit_pos = 1;
+                return 1;
+            }
+        }
+        return reject(f, c);
+
+    default:
+        JD_PANIC();
+        return -1;
+    }
+}
+
+static bool feed(feeder_t *f, value_t chunk) {
+    unsigned sz;
+    const uint8_t *p = devs_bufferish_data(f->ctx, chunk, &sz);
+    if (p == NULL) {
+        devs_throw_expecting_error(f->ctx, DEVS_BUILTIN_STRING_BUFFER, chunk);
+        return false;
+    }
+
+    unsigned i = 0;
+    while (i < sz) {
+        int n;
+        if (f->js.state == JS_STRING) {
+            n = feed_string(f, p + i, sz - i);
+        } else {
+            n = feed_char(f, p[i]);
+        }
+        if (n < 0)
+            return false;
+        i += n;
+        f->js.pos += n;
+    }
+    return true;
+}
+
+static bool finish(feeder_t *f) {
+    if (f->js.state == JS_NUMBER && !end_number(f))
+        return false;
+    if (f->js.state != JS_VALUE || depth(f) != 0)
+        return fail(f, -1);
+    return true;
+}
+
+static void throw_err(feeder_t *f) {
+    if (f->ch == -1)
+        devs_throw_syntax_error(f->ctx, "Unexpected end of JSON input");
+    else
+        devs_throw_syntax_error(f->ctx, "Unexpected token '%c' in JSON at position %d", f->ch,
+                                f->js.pos);
+}
+
+value_t devs_json_parser_alloc(devs_ctx_t *ctx) {
+    devs_json_parser_t *parser = devs_any_try_alloc(
+        ctx, DEVS_GC_TAG_JSON_PARSER, sizeof(devs_json_parser_t) + sizeof(json_stream_t));
+    if (parser == NULL)
+        return devs_undefined;
+    // all zero is JS_VALUE, at position 0
+    value_t r = devs_value_from_gc_obj(ctx, parser);
+    unsigned scope = devs_root_scope(ctx);
+    devs_root_push(ctx, r);
+    parser->stack = devs_array_try_alloc(ctx, 0);
+    devs_root_pop(ctx, scope);
+    return parser->stack ? r : devs_undefined;
+}
+
+value_t devs_json_feed(devs_ctx_t *ctx, value_t parser, value_t chunk) {
+    devs_json_parser_t *p = devs_value_to_gc_obj(ctx, parser);
+    if (devs_gc_tag(p) != DEVS_GC_TAG_JSON_PARSER) {
+        devs_throw_type_error(ctx, "expecting JSON parser");
+        return devs_undefined;
+    }
+
+    feeder_t f = {.ctx = ctx, .parser = p, .st = p->stack, .ch = -1};
+    memcpy(&f.js, p->state, sizeof(f.js));
+
+    if (f.js.state == JS_ERROR) {
+        devs_throw_syntax_error(ctx, "JSON parser already failed");
+        return devs_undefined;
+    }
+
+    f.out = devs_array_try_alloc(ctx, 0);
+    if (f.out == NULL)
+        return devs_undefined;
+    value_t ret = devs_value_from_gc_obj(ctx, f.out);
+    unsigned scope = devs_root_scope(ctx);
+    devs_root_push(ctx, ret);
+
+    bool ok = devs_is_nullish(chunk) ? finish(&f) : feed(&f, chunk);
+
+    if (ok && devs_is_nullish(chunk)) {
+        // ready for another document; the stack is empty already
+        memset(&f.js, 0, sizeof(f.js));
+        p->token = NULL;
+    }
+    memcpy(p->state, &f.js, sizeof(f.js));
+
+    if (!ok && !ctx->in_throw)
+        throw_err(&f);
+
+    devs_root_pop(ctx, scope);
+    return ok ? ret : devs_undefined;
+}
@@ -553,7 +553,8 @@ value_t devs_function_bind(devs_ctx_t *ctx, value_t obj, value_t fn) {
         case DEVS_HANDLE_TYPE_ROLE:
         case DEVS_HANDLE_TYPE_ROLE_MEMBER:
         case DEVS_HANDLE_TYPE_STATIC_FUNCTION:
-        case DEVS_HANDLE_TYPE_IMG_BUFFERISH: {
+        case DEVS_HANDLE_TYPE_IMG_BUFFERISH:
+        case DEVS_HANDLE_TYPE_ASCII_CHAR: {
             uint32_t hv = devs_handle_value(obj);
             JD_ASSERT((((uint32_t)otp << DEVS_PACK_SHIFT) >> DEVS_PACK_SHIFT) == (uint32_t)otp);
             JD_ASSERT((hv >> DEVS_PACK_SHIFT) == 0);
@@ -684,11 +685,11 @@ devs_map_t *devs_get_spec_proto(devs_ctx_t *ctx, uint32_t spec_idx) {
     devs_map_t *m = devs_any_try_alloc(ctx, DEVS_GC_TAG_HALF_STATIC_MAP, sizeof(devs_map_t));
     if (m == NULL)
         return NULL;
-    value_t v = devs_value_from_gc_obj(ctx, m);
-    devs_value_pin(ctx, v);
+    unsigned scope = devs_root_scope(ctx);
+    value_t v = devs_root_push(ctx, devs_value_from_gc_obj(ctx, m));
     m->proto = (const void *)devs_img_get_service_spec(ctx->img, spec_idx);
     devs_short_map_set(ctx, ctx->spec_protos, spec_idx, v);
-    devs_value_unpin(ctx, v);
+    devs_root_pop(ctx, scope);
     return m;
 }
 
@@ -792,9 +793,10 @@ static devs_maplike_t *devs_object_get_attached(devs_ctx_t *ctx, value_t v, unsi
                         devs_map_try_alloc(ctx, devs_get_builtin_object(
                                                     ctx, DEVS_BUILTIN_OBJECT_FUNCTION_PROTOTYPE)));
                     if (!devs_is_undefined(r)) {
-                        devs_value_pin(ctx, r);
+                        unsigned scope = devs_root_scope(ctx);
+                        devs_root_push(ctx, r);
                         devs_short_map_set(ctx, ctx->fn_values, fidx, r);
-                        devs_value_unpin(ctx, r);
+                        devs_root_pop(ctx, scope);
                     }
                 }
                 if (!devs_is_undefined(r))
@@ -818,10 +820,18 @@ static devs_maplike_t *devs_object_get_attached(devs_ctx_t *ctx, value_t v, unsi
         attached = &((devs_buffer_t *)obj)->attached;
         builtin = DEVS_BUILTIN_OBJECT_BUFFER_PROTOTYPE;
         break;
+    case DEVS_GC_TAG_BUFFER_VIEW:
+        attached = &((devs_buffer_view_t *)obj)->attached;
+        builtin = DEVS_BUILTIN_OBJECT_BUFFER_PROTOTYPE;
+        break;
     case DEVS_GC_TAG_IMAGE:
         attached = &((devs_gimage_t *)obj)->attached;
         builtin = DEVS_BUILTIN_OBJECT_IMAGE_PROTOTYPE;
         break;
+    case DEVS_GC_TAG_TYPED_ARRAY:
+        attached = &((devs_typed_array_t *)obj)->attached;
+        builtin = devs_typed_array_proto_idx(((devs_typed_array_t *)obj)->kind);
+        break;
     case DEVS_GC_TAG_ARRAY:
         attached = &((devs_array_t *)obj)->attached;
         builtin = DEVS_BUILTIN_OBJECT_ARRAY_PROTOTYPE;
@@ -835,9 +845,13 @@ static devs_maplike_t *devs_object_get_attached(devs_ctx_t *ctx, value_t v, unsi
         return (devs_maplike_t *)obj;
     case DEVS_GC_TAG_STRING_JMP:
     case DEVS_GC_TAG_STRING:
+    case DEVS_GC_TAG_STRING_ROPE:
         return devs_get_static_proto(ctx, DEVS_BUILTIN_OBJECT_STRING_PROTOTYPE, attach_flags);
     case DEVS_GC_TAG_BOUND_FUNCTION:
         return devs_get_static_proto(ctx, DEVS_BUILTIN_OBJECT_FUNCTION_PROTOTYPE, attach_flags);
+    case DEVS_GC_TAG_JSON_PARSER:
+        // no properties of its own
+        return devs_get_static_proto(ctx, DEVS_BUILTIN_OBJECT_OBJECT_PROTOTYPE, attach_flags);
     case DEVS_GC_TAG_BUILTIN_PROTO:
     case DEVS_GC_TAG_SHORT_MAP:
     default:
@@ -986,6 +1000,10 @@ value_t devs_seq_get(devs_ctx_t *ctx, value_t seq, unsigned idx) {
     if (idx > DEVS_MAX_ALLOC)
         return devs_undefined;
 
+    devs_typed_array_t *tarr = devs_value_to_typed_array(ctx, seq);
+    if (tarr)
+        return devs_typed_array_get(ctx, tarr, idx);
+
     unsigned len;
     const uint8_t *p = devs_bufferish_data(ctx, seq, &len);
     if (p && idx < len) {
@@ -994,9 +1012,7 @@ value_t devs_seq_get(devs_ctx_t *ctx, value_t seq, unsigned idx) {
             if (off < 0)
                 return devs_undefined;
             p += off;
-            unsigned len = devs_utf8_code_point_length((const char *)p);
-            return devs_value_from_gc_obj(ctx,
-                                          devs_string_try_alloc_init(ctx, (const char *)p, len));
+            return devs_string_from_utf8(ctx, p, devs_utf8_code_point_length((const char *)p));
         }
         return devs_value_from_int(p[idx]);
     }
@@ -1011,7 +1027,8 @@ value_t devs_seq_get(devs_ctx_t *ctx, value_t seq, unsigned idx) {
 }
 
 bool devs_looks_indexable(devs_ctx_t *ctx, value_t seq) {
-    return devs_is_array(ctx, seq) || devs_is_buffer(ctx, seq) || devs_is_string(ctx, seq);
+    return devs_is_array(ctx, seq) || devs_is_buffer(ctx, seq) || devs_is_string(ctx, seq) ||
+           devs_value_to_typed_array(ctx, seq) != NULL;
 }
 
 value_t devs_any_get(devs_ctx_t *ctx, value_t obj, value_t key) {
@@ -1021,10 +1038,10 @@ value_t devs_any_get(devs_ctx_t *ctx, value_t obj, value_t key) {
     } else if (devs_is_string(ctx, key)) {
         return devs_object_get(ctx, obj, key);
     } else {
-        key = devs_value_to_string(ctx, key);
-        devs_value_pin(ctx, key);
+        unsigned scope = devs_root_scope(ctx);
+        key = devs_root_push(ctx, devs_value_to_string(ctx, key));
         value_t res = devs_object_get(ctx, obj, key);
-        devs_value_unpin(ctx, key);
+        devs_root_pop(ctx, scope);
         return res;
     }
 }
@@ -1041,10 +1058,10 @@ void devs_any_set(devs_ctx_t *ctx, value_t obj, value_t key, value_t v) {
         if (devs_is_string(ctx, key))
             devs_map_set(ctx, map, key, v);
         else {
-            key = devs_value_to_string(ctx, key);
-            devs_value_pin(ctx, key);
+            unsigned scope = devs_root_scope(ctx);
+            key = devs_root_push(ctx, devs_value_to_string(ctx, key));
             devs_map_set(ctx, map, key, v);
-            devs_value_unpin(ctx, key);
+            devs_root_pop(ctx, scope);
         }
     }
 }
@@ -1077,15 +1094,19 @@ void devs_array_set(devs_ctx_t *ctx, devs_array_t *arr, unsigned idx, value_t v)
 }
 
 void devs_array_pin_push(devs_ctx_t *ctx, devs_array_t *arr, value_t v) {
-    devs_value_pin(ctx, v);
+    unsigned scope = devs_root_scope(ctx);
+    devs_root_push(ctx, v);
     devs_array_set(ctx, arr, arr->length, v);
-    devs_value_unpin(ctx, v);
+    devs_root_pop(ctx, scope);
 }
 
 void devs_seq_set(devs_ctx_t *ctx, value_t seq, unsigned idx, value_t v) {
     // DMESG("set arr=%s idx=%u", devs_show_value(ctx, seq), idx);
+    devs_typed_array_t *tarr;
     if (idx > DEVS_MAX_ALLOC) {
         devs_throw_too_big_error(ctx, DEVS_BUILTIN_STRING_ARRAY);
+    } else if ((tarr = devs_value_to_typed_array(ctx, seq)) != NULL) {
+        devs_typed_array_set(ctx, tarr, idx, v);
     } else if (devs_buffer_is_writable(ctx, seq)) {
         unsigned len;
         uint8_t *p = devs_buffer_data(ctx, seq, &len);
@@ -0,0 +1,104 @@
+#include "devs_internal.h"
+#include "jd_numfmt.h"
+
+// Packet specs are decoded by walking their field specs, which re-validates every numfmt on
+// every packet. Specs of all-numeric packets are instead compiled, on first use, into a list
+// of numfmts that can be decoded without any checks. Compiled decoders are kept in a small
+// direct-mapped cache in the context; the specs live in the image, so they never change.
+
+static unsigned spec_hash(const devs_packet_spec_t *pkt) {
+    // packet specs of a service are consecutive, so this gives them consecutive slots
+    uintptr_t p = (uintptr_t)pkt / sizeof(devs_packet_spec_t);
+    return (p ^ (p >> 5)) & (DEVS_PKT_DECODER_CACHE_SIZE - 1);
+}
+
+static void compile(devs_ctx_t *ctx, devs_pkt_decoder_t *dec, const devs_packet_spec_t *pkt) {
+    memset(dec, 0, sizeof(*dec));
+    dec->spec = pkt;
+    dec->kind = DEVS_PKT_DECODER_GENERIC;
+
+    if (!(pkt->flags & DEVS_PACKETSPEC_FLAG_MULTI_FIELD)) {
+        unsigned sz = devs_numfmt_plain_size(pkt->numfmt_or_offset);
+        if (sz && pkt->numfmt_or_offset <= 0xff) {
+            dec->kind = DEVS_PKT_DECODER_SINGLE;
+            dec->size = sz;
+            dec->numfmts[0] = pkt->numfmt_or_offset;
+        }
+        return;
+    }
+
+    const devs_field_spec_t *fld = devs_img_get_field_spec(ctx->img, pkt->numfmt_or_offset);
+    unsigned num = 0, size = 0;
+    for (; fld->name_idx; fld++) {
+        unsigned sz = devs_numfmt_plain_size(fld->numfmt);
+        if (sz == 0 || (fld->flags & DEVS_FIELDSPEC_FLAG_IS_BYTES))
+            return;
+        if (fld->flags & DEVS_FIELDSPEC_FLAG_STARTS_REPEATS) {
+            // only a single repeated field, at the end, is supported
+            if (fld[1].name_idx)
+                return;
+            dec->rep_numfmt = fld->numfmt;
+            dec->rep_size = sz;
+            break;
+        }
+        if (num == DEVS_PKT_DECODER_MAX_FIELDS)
+            return;
+        dec->numfmts[num++] = fld->numfmt;
+        size += sz;
+    }
+
+    if (num == 0 && dec->rep_size == 0)
+        return;
+
+    dec->kind = DEVS_PKT_DECODER_STRUCT;
+    dec->num_fields = num;
+    dec->size = size;
+}
+
+static const devs_pkt_decoder_t *get_decoder(devs_ctx_t *ctx, const devs_packet_spec_t *pkt) {
+    devs_pkt_decoder_t *dec = &ctx->pkt_decoders[spec_hash(pkt)];
+    if (dec->spec != pkt)
+        compile(ctx, dec, pkt);
+    return dec;
+}
+
+bool devs_packet_decode_fast(devs_ctx_t *ctx, const devs_packet_spec_t *pkt, const uint8_t *dp,
+                             unsigned len, value_t *res) {
+    const devs_pkt_decoder_t *dec = get_decoder(ctx, pkt);
+
+    switch (dec->kind) {
+    case DEVS_PKT_DECODER_SINGLE:
+        if (len < dec->size)
+            *res = devs_undefined;
+        else
+            devs_buffer_decode_many(dec->numfmts[0], dp, 1, res);
+        return true;
+
+    case DEVS_PKT_DECODER_STRUCT: {
+        // truncated packets are decoded field by field
+        if (len < dec->size)
+            return false;
+
+        unsigned num_rep = dec->rep_size ? (len - dec->size) / dec->rep_size : 0;
+        devs_array_t *arr = devs_array_try_alloc(ctx, dec->num_fields + num_rep);
+        if (arr == NULL) {
+            *res = devs_undefined;
+            return true;
+        }
+
+        // no allocation below, so arr doesn't need to be rooted
+        value_t *dst = arr->data;
+        for (unsigned i = 0; i < dec->num_fields; ++i) {
+            devs_buffer_decode_many(dec->numfmts[i], dp, 1, dst++);
+            dp += jd_numfmt_bytes(dec->numfmts[i]);
+        }
+        devs_buffer_decode_many(dec->rep_numfmt, dp, num_rep, dst);
+
+        *res = devs_value_from_gc_obj(ctx, arr);
+        return true;
+    }
+
+    default:
+        return false;
+    }
+}
@@ -1,89 +1,167 @@
 #include "devs_internal.h"
 
+#define NONE DEVS_REGCACHE_NONE
+
+// Entries are hashed on (role_idx, service_command) only, with the argument compared
+// when walking the chain - this way devs_regcache_next() only has to look at one chain.
+static uint16_t *get_bucket(devs_regcache_t *cache, unsigned role_idx, unsigned service_command) {
+    uint32_t h = ((role_idx << 16) | service_command) * 0x9e3779b1;
+    h ^= h >> 16;
+    return &cache->buckets[h & (cache->num_buckets - 1)];
+}
+
+static inline unsigned entry_idx(devs_regcache_t *cache, devs_regcache_entry_t *q) {
+    return q - cache->entries;
+}
+
+static void lru_unlink(devs_regcache_t *cache, devs_regcache_entry_t *q) {
+    if (q->lru_prev == NONE)
+        cache->lru_first = q->lru_next;
+    else
+        cache->entries[q->lru_prev].lru_next = q->lru_next;
+    if (q->lru_next == NONE)
+        cache->lru_last = q->lru_prev;
+    else
+        cache->entries[q->lru_next].lru_prev = q->lru_prev;
+}
+
+static void lru_push_first(devs_regcache_t *cache, devs_regcache_entry_t *q) {
+    unsigned idx = entry_idx(cache, q);
+    q->lru_prev = NONE;
+    q->lru_next = cache->lru_first;
+    if (cache->lru_first == NONE)
+        cache->lru_last = idx;
+    else
+        cache->entries[cache->lru_first].lru_prev = idx;
+    cache->lru_first = idx;
+}
+
+static void lru_push_last(devs_regcache_t *cache, devs_regcache_entry_t *q) {
+    unsigned idx = entry_idx(cache, q);
+    q->lru_next = NONE;
+    q->lru_prev = cache->lru_last;
+    if (cache->lru_last == NONE)
+        cache->lru_first = idx;
+    else
+        cache->entries[cache->lru_last].lru_next = idx;
+    cache->lru_last = idx;
+}
+
+static void hash_unlink(devs_regcache_t *cache, devs_regcache_entry_t *q) {
+    unsigned idx = entry_idx(cache, q);
+    uint16_t *p = get_bucket(cache, q->role_idx, q->service_command);
+    while (*p != idx) {
+        JD_ASSERT(*p != NONE);
+        p = &cache->entries[*p].hash_next;
+    }
+    *p = q->hash_next;
+}
+
+void devs_regcache_init(devs_regcache_t *cache, unsigned num_entries) {
+    if (num_entries == 0)
+        num_entries = DEVS_REGCACHE_DEFAULT_SIZE;
+    if (num_entries > DEVS_REGCACHE_MAX_SIZE)
+        num_entries = DEVS_REGCACHE_MAX_SIZE;
+    unsigned num_buckets = 1;
+    while (num_buckets < num_entries)
+        num_buckets <<= 1;
+
+    memset(cache, 0, sizeof(*cache));
+    cache->entries = jd_alloc(num_entries * sizeof(devs_regcache_entry_t));
+    cache->buckets = jd_alloc(num_buckets * sizeof(uint16_t));
+    memset(cache->buckets, 0xff, num_buckets * sizeof(uint16_t));
+    cache->num_entries = num_entries;
+    cache->num_buckets = num_buckets;
+    cache->lru_first = cache->lru_last = NONE;
+    for (unsigned i = 0; i < num_entries; ++i)
+        lru_push_last(cache, &cache->entries[i]);
+}
+
+void devs_regcache_destroy(devs_regcache_t *cache) {
+    devs_regcache_free_all(cache);
+    jd_free(cache->entries);
+    jd_free(cache->buckets);
+    memset(cache, 0, sizeof(*cache));
+}
+
 void devs_regcache_free(devs_regcache_t *cache, devs_regcache_entry_t *q) {
+    if (q->service_command == 0)
+        return; // already free
+    hash_unlink(cache, q);
     if (q->resp_size > DEVS_QUERY_MAX_INLINE)
         jd_free(q->value.buffer);
     q->resp_size = 0;
     q->service_command = 0;
+    // free entries are re-used first
+    lru_unlink(cache, q);
+    lru_push_last(cache, q);
 }
 
 void devs_regcache_free_all(devs_regcache_t *cache) {
-    for (unsigned i = 0; i < DEVS_REGCACHE_NUM_ENTRIES; ++i) {
+    for (unsigned i = 0; i < cache->num_entries; ++i) {
         devs_regcache_free(cache, &cache->entries[i]);
     }
 }
 
 devs_regcache_entry_t *devs_regcache_mark_used(devs_regcache_t *cache, devs_regcache_entry_t *q) {
-    unsigned idx = cache->latest_idx;
-    if (q == &cache->entries[idx])
-        return q; // already latest
-    idx++;
-    if (idx >= DEVS_REGCACHE_NUM_ENTRIES)
-        idx = 0;
-    if (q != &cache->entries[idx]) {
-        devs_regcache_entry_t tmp;
-        memcpy(&tmp, q, sizeof(tmp));
-        memcpy(q, &cache->entries[idx], sizeof(tmp));
-        memcpy(&cache->entries[idx], &tmp, sizeof(tmp));
+    if (cache->lru_first != entry_idx(cache, q)) {
+        lru_unlink(cache, q);
+        lru_push_first(cache, q);
     }
-    cache->latest_idx = idx;
-    return &cache->entries[idx];
+    return q;
 }
 
 devs_regcache_entry_t *devs_regcache_alloc(devs_regcache_t *cache, unsigned role_idx,
-                                           unsigned service_command, unsigned resp_size) {
-    devs_regcache_entry_t *q = NULL;
-
+                                           unsigned service_command, unsigned argument,
+                                           unsigned resp_size) {
     JD_ASSERT(service_command > 0);
+    JD_ASSERT(cache->lru_last != NONE);
 
-    for (unsigned i = 0; i < DEVS_REGCACHE_NUM_ENTRIES; ++i) {
-        if (cache->entries[i].service_command == 0) {
-            q = &cache->entries[i];
-            break;
-        }
-    }
-
-    if (!q) {
-        unsigned idx = cache->latest_idx + 1;
-        if (idx >= DEVS_REGCACHE_NUM_ENTRIES)
-            idx = 0;
-        q = &cache->entries[idx];
-        devs_regcache_free(cache, q);
-    }
+    // either a free entry or the least recently used one
+    devs_regcache_entry_t *q = &cache->entries[cache->lru_last];
+    devs_regcache_free(cache, q);
 
     q->role_idx = role_idx;
     q->service_command = service_command;
-    q->argument = 0;
+    q->argument = argument;
     q->resp_size = resp_size;
     if (resp_size > DEVS_QUERY_MAX_INLINE)
         q->value.buffer = jd_alloc(resp_size);
 
-    q = devs_regcache_mark_used(cache, q);
+    uint16_t *p = get_bucket(cache, role_idx, service_command);
+    q->hash_next = *p;
+    *p = entry_idx(cache, q);
 
-    return q;
+    return devs_regcache_mark_used(cache, q);
 }
 
 devs_regcache_entry_t *devs_regcache_lookup(devs_regcache_t *cache, unsigned role_idx,
                                             unsigned service_command, unsigned argument) {
-    for (unsigned i = 0; i < DEVS_REGCACHE_NUM_ENTRIES; ++i) {
-        devs_regcache_entry_t *q = &cache->entries[i];
+    if (!service_command)
+        return NULL;
+    unsigned idx = *get_bucket(cache, role_idx, service_command);
+    while (idx != NONE) {
+        devs_regcache_entry_t *q = &cache->entries[idx];
         if (q->role_idx == role_idx && q->service_command == service_command &&
             q->argument == argument)
             return q;
+        idx = q->hash_next;
     }
     return NULL;
 }
 
+// these are not on the register read path, so linear scans are fine
+
 void devs_regcache_age(devs_regcache_t *cache, unsigned role_idx, uint32_t min_time) {
-    for (unsigned i = 0; i < DEVS_REGCACHE_NUM_ENTRIES; ++i) {
+    for (unsigned i = 0; i < cache->num_entries; ++i) {
         devs_regcache_entry_t *q = &cache->entries[i];
-        if (q->role_idx == role_idx && q->last_refresh_time > min_time)
+        if (q->service_command && q->role_idx == role_idx && q->last_refresh_time > min_time)
             q->last_refresh_time = min_time;
     }
 }
 
 void devs_regcache_free_role(devs_regcache_t *cache, unsigned role_idx) {
-    for (unsigned i = 0; i < DEVS_REGCACHE_NUM_ENTRIES; ++i) {
+    for (unsigned i = 0; i < cache->num_entries; ++i) {
         devs_regcache_entry_t *q = &cache->entries[i];
         if (q->role_idx == role_idx)
             devs_regcache_free(cache, q);
@@ -94,13 +172,12 @@ devs_regcache_entry_t *devs_regcache_next(devs_regcache_t *cache, unsigned role_
                                           unsigned service_command, devs_regcache_entry_t *prev) {
     if (!service_command)
         return NULL;
-    devs_regcache_entry_t *end = &cache->entries[DEVS_REGCACHE_NUM_ENTRIES];
-    if (!prev)
-        prev = &cache->entries[0];
-    while (prev < end) {
-        if (prev->service_command == service_command && prev->role_idx == role_idx)
-            return prev;
-        prev++;
+    unsigned idx = prev ? prev->hash_next : *get_bucket(cache, role_idx, service_command);
+    while (idx != NONE) {
+        devs_regcache_entry_t *q = &cache->entries[idx];
+        if (q->service_command == service_command && q->role_idx == role_idx)
+            return q;
+        idx = q->hash_next;
     }
     return NULL;
-}
\ No newline at end of file
+}
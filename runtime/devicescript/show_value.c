@@ -77,6 +77,9 @@ const char *devs_show_value0(devs_ctx_t *ctx, value_t v) {
     case DEVS_HANDLE_TYPE_IMG_BUFFERISH:
         fmt = devs_bufferish_is_buffer(v) ? "buf" : "str";
         break;
+    case DEVS_HANDLE_TYPE_ASCII_CHAR:
+        fmt = "char";
+        break;
     case DEVS_HANDLE_TYPE_ROLE:
         fmt = "role";
         break;
@@ -101,13 +104,21 @@ const char *devs_show_value0(devs_ctx_t *ctx, value_t v) {
             fmt = "array";
             break;
         case DEVS_GC_TAG_BUFFER:
+        case DEVS_GC_TAG_BUFFER_VIEW:
             fmt = "buffer";
             break;
+        case DEVS_GC_TAG_TYPED_ARRAY:
+            fmt = "typed_array";
+            break;
+        case DEVS_GC_TAG_JSON_PARSER:
+            fmt = "json_parser";
+            break;
         case DEVS_GC_TAG_IMAGE:
             fmt = "image";
             break;
         case DEVS_GC_TAG_STRING_JMP:
         case DEVS_GC_TAG_STRING:
+        case DEVS_GC_TAG_STRING_ROPE:
             fmt = "string";
             break;
         case DEVS_GC_TAG_PACKET:
@@ -0,0 +1,199 @@
+#include "devs_internal.h"
+
+// Growable UTF-8 buffer for building strings in a single pass.
+// Short results stay in the inline buffer; longer ones go to a pinned GC block
+// that is doubled as needed and freed in devs_strbuild_finish().
+// Runtime-internal: programs get its results through join(), JSON.stringify(), format() etc.,
+// but have no handle on a builder itself.
+
+void devs_strbuild_init(devs_ctx_t *ctx, devs_strbuild_t *sb) {
+    memset(sb, 0, sizeof(*sb));
+    sb->ctx = ctx;
+    sb->data = sb->inline_buf;
+    sb->capacity = sizeof(sb->inline_buf);
+}
+
+static bool is_inline(devs_strbuild_t *sb) {
+    return sb->data == sb->inline_buf;
+}
+
+void devs_strbuild_init_sink(devs_ctx_t *ctx, devs_strbuild_t *sb, unsigned chunk_size,
+                             devs_strbuild_sink_t sink, void *arg) {
+    devs_strbuild_init(ctx, sb);
+    sb->sink = sink;
+    sb->sink_arg = arg;
+    if (chunk_size > sb->capacity) {
+        char *data = devs_try_alloc(ctx, chunk_size);
+        if (data == NULL) {
+            sb->error = true;
+        } else {
+            sb->data = data;
+            sb->capacity = chunk_size;
+        }
+    }
+}
+
+static void flush(devs_strbuild_t *sb) {
+    if (sb->size == 0)
+        return;
+    int r = sb->sink(sb->sink_arg, sb->data, sb->size);
+    if (r) {
+        sb->sink_error = r;
+        sb->error = true;
+    }
+    sb->size = 0;
+}
+
+int devs_strbuild_flush(devs_strbuild_t *sb) {
+    if (!sb->error)
+        flush(sb);
+    if (sb->error)
+        return sb->sink_error ? sb->sink_error : -1;
+    return 0;
+}
+
+char *devs_strbuild_reserve(devs_strbuild_t *sb, unsigned sz) {
+    if (sb->error)
+        return NULL;
+
+    unsigned need = sb->size + sz;
+    if (need <= sb->capacity)
+        return sb->data + sb->size;
+
+    if (sb->sink) {
+        flush(sb);
+        if (sb->error)
+            return NULL;
+        need = sz;
+        if (need <= sb->capacity)
+            return sb->data;
+    }
+
+    if (need > DEVS_MAX_ALLOC) {
+        sb->error = true;
+        devs_throw_too_big_error(sb->ctx, DEVS_BUILTIN_STRING_STRING);
+        return NULL;
+    }
+
+    unsigned cap = sb->capacity * 2;
+    while (cap < need)
+        cap *= 2;
+    if (cap > DEVS_MAX_ALLOC)
+        cap = DEVS_MAX_ALLOC;
+
+    // the old block is pinned, so it survives a GC triggered here
+    char *data = devs_try_alloc(sb->ctx, cap);
+    if (data == NULL) {
+        sb->error = true;
+        return NULL;
+    }
+    memcpy(data, sb->data, sb->size);
+    if (!is_inline(sb))
+        devs_free(sb->ctx, sb->data);
+    sb->data = data;
+    sb->capacity = cap;
+
+    return sb->data + sb->size;
+}
+
+void devs_strbuild_commit(devs_strbuild_t *sb, unsigned sz, unsigned len) {
+    JD_ASSERT(sb->size + sz <= sb->capacity);
+    sb->size += sz;
+    sb->length += len;
+}
+
+void devs_strbuild_add(devs_strbuild_t *sb, const char *s, unsigned sz) {
+    char *dst = devs_strbuild_reserve(sb, sz);
+    if (dst == NULL)
+        return;
+    unsigned len = 0;
+    for (unsigned i = 0; i < sz; ++i) {
+        if (!devs_utf8_is_cont(s[i]))
+            len++;
+        dst[i] = s[i];
+    }
+    devs_strbuild_commit(sb, sz, len);
+}
+
+void devs_strbuild_add_ch(devs_strbuild_t *sb, char c, unsigned rep) {
+    char *dst = devs_strbuild_reserve(sb, rep);
+    if (dst == NULL)
+        return;
+    memset(dst, c, rep);
+    devs_strbuild_commit(sb, rep, devs_utf8_is_cont(c) ? 0 : rep);
+}
+
+void devs_strbuild_add_string(devs_strbuild_t *sb, value_t s) {
+    devs_ctx_t *ctx = sb->ctx;
+    if (sb->error)
+        return;
+
+    unsigned scope = devs_root_scope(ctx);
+    // keep s alive while we possibly grow the buffer
+    s = devs_root_push(ctx, s);
+
+    unsigned sz;
+    const char *data = devs_string_get_utf8(ctx, s, &sz);
+    if (data == NULL) {
+        sb->error = true;
+    } else if (devs_strbuild_reserve(sb, sz)) {
+        // no GC between here and memcpy()
+        data = devs_string_get_utf8(ctx, s, &sz);
+        memcpy(sb->data + sb->size, data, sz);
+        devs_strbuild_commit(sb, sz, devs_string_length(ctx, s));
+    }
+
+    devs_root_pop(ctx, scope);
+}
+
+void devs_strbuild_add_value(devs_strbuild_t *sb, value_t v) {
+    if (sb->error)
+        return;
+    if (devs_handle_type(v) == DEVS_HANDLE_TYPE_FLOAT64) {
+        // format numbers in place, without a temporary string
+        char *dst = devs_strbuild_reserve(sb, DEVS_DTOA_SIZE);
+        if (dst) {
+            unsigned sz = devs_is_tagged_int(v) ? devs_itoa(v.val_int32, dst)
+                                                : devs_dtoa(devs_value_to_double(sb->ctx, v), dst);
+            devs_strbuild_commit(sb, sz, sz);
+        }
+        return;
+    }
+    devs_strbuild_add_string(sb, devs_value_to_string(sb->ctx, v));
+}
+
+void devs_strbuild_truncate(devs_strbuild_t *sb, unsigned size) {
+    if (size >= sb->size)
+        return;
+    // don't cut a multi-byte character in half
+    while (size > 0 && devs_utf8_is_cont(sb->data[size]))
+        size--;
+    for (unsigned i = size; i < sb->size; ++i)
+        if (!devs_utf8_is_cont(sb->data[i]))
+            sb->length--;
+    sb->size = size;
+}
+
+void devs_strbuild_free(devs_strbuild_t *sb) {
+    if (!is_inline(sb))
+        devs_free(sb->ctx, sb->data);
+    sb->data = sb->inline_buf;
+    sb->capacity = sizeof(sb->inline_buf);
+    sb->size = sb->length = 0;
+}
+
+value_t devs_strbuild_finish(devs_strbuild_t *sb) {
+    value_t r = devs_undefined;
+    if (!sb->error) {
+        unsigned scope;
+        char *d = devs_string_prep(sb->ctx, &r, sb->size, sb->length, &scope);
+        if (d) {
+            memcpy(d, sb->data, sb->size);
+            devs_string_finish(sb->ctx, &r, sb->size, sb->length, scope);
+        } else {
+            r = devs_undefined;
+        }
+    }
+    devs_strbuild_free(sb);
+    return r;
+}
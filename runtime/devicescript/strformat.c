@@ -9,24 +9,13 @@ static int numvalue(char c) {
     return -1;
 }
 
-#define WR(c)                                                                                      \
-    do {                                                                                           \
-        char tmp = (c);                                                                            \
-        if (dp < dstlen)                                                                           \
-            dst[dp] = tmp;                                                                         \
-        dp++;                                                                                      \
-        if ((tmp & 0xC0) != 0x80)                                                                  \
-            len++;                                                                                 \
-    } while (0)
-
-size_t devs_strformat(devs_ctx_t *ctx, const char *fmt, size_t fmtlen, char *dst, size_t dstlen,
-                      value_t *args, size_t numargs, size_t *length) {
+void devs_strformat(devs_strbuild_t *sb, const char *fmt, size_t fmtlen, value_t *args,
+                    size_t numargs) {
+    devs_ctx_t *ctx = sb->ctx;
     size_t fp = 0;
-    size_t dp = 0;
-    size_t len = 0;
 
-    while (fp <= fmtlen) {
-        char c = fp == fmtlen ? (fp++, 0) : fmt[fp++];
+    while (fp < fmtlen) {
+        char c = fmt[fp++];
         if (c != '{' || fp >= fmtlen) {
             // if we see "}}" we treat it as a single "}"
             if (c == '}' && fp < fmtlen && fmt[fp] == '}')
@@ -61,34 +50,18 @@ size_t devs_strformat(devs_ctx_t *ctx, const char *fmt, size_t fmtlen, char *dst
         if (precision < 0)
             precision = 6;
 
-        unsigned sz;
-        const char *s;
         value_t v = args[pos];
-        char buf[64];
 
         if (devs_is_number(v)) {
-            jd_print_double(buf, devs_value_to_double(ctx, args[pos]), precision + 1);
-            s = buf;
-            sz = strlen(buf);
+            char buf[64];
+            jd_print_double(buf, devs_value_to_double(ctx, v), precision + 1);
+            devs_strbuild_add(sb, buf, strlen(buf));
         } else {
-            value_t tmp = devs_inspect(ctx, v, 0);
-            // note that tmp is not pinned, it may go away at next allocation, but we only use it
-            // down below
-            s = devs_string_get_utf8(ctx, tmp, &sz);
+            devs_inspect_to(sb, v, 0);
         }
-
-        while (sz--)
-            WR(*s++);
         continue;
 
     write_c:
-        WR(c);
+        devs_strbuild_add_ch(sb, c, 1);
     }
-
-    if (dstlen)
-        dst[dstlen - 1] = 0; // in case we overflow
-    if (length)
-        *length = len;
-
-    return dp;
 }
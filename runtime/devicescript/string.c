@@ -1,19 +1,91 @@
 #include "devs_internal.h"
 #include <math.h>
 
+// concatenation results shorter than this are copied right away
+#define ROPE_MIN_SIZE 32
+// flattening recurses into right children; deeper right operands are flattened before concat
+#define ROPE_MAX_DEPTH 16
+
+// NUL-terminated backing store for DEVS_HANDLE_TYPE_ASCII_CHAR strings
+#define CH1(c) c, 0
+#define CH4(c) CH1(c), CH1(c + 1), CH1(c + 2), CH1(c + 3)
+#define CH16(c) CH4(c), CH4(c + 4), CH4(c + 8), CH4(c + 12)
+static const char ascii_chars[256] = {CH16(0x00), CH16(0x10), CH16(0x20), CH16(0x30),
+                                      CH16(0x40), CH16(0x50), CH16(0x60), CH16(0x70)};
+
 bool devs_is_string(devs_ctx_t *ctx, value_t v) {
     unsigned tag;
     switch (devs_handle_type(v)) {
     case DEVS_HANDLE_TYPE_GC_OBJECT:
         tag = devs_gc_tag(devs_handle_ptr_value(ctx, v));
-        return tag == DEVS_GC_TAG_STRING || tag == DEVS_GC_TAG_STRING_JMP;
+        return tag == DEVS_GC_TAG_STRING || tag == DEVS_GC_TAG_STRING_JMP ||
+               tag == DEVS_GC_TAG_STRING_ROPE;
     case DEVS_HANDLE_TYPE_IMG_BUFFERISH:
         return !devs_bufferish_is_buffer(v);
+    case DEVS_HANDLE_TYPE_ASCII_CHAR:
+        return true;
     default:
         return false;
     }
 }
 
+devs_string_rope_t *devs_string_get_rope(devs_ctx_t *ctx, value_t v) {
+    if (devs_handle_type(v) != DEVS_HANDLE_TYPE_GC_OBJECT)
+        return NULL;
+    devs_string_rope_t *r = devs_handle_ptr_value(ctx, v);
+    return devs_gc_tag(r) == DEVS_GC_TAG_STRING_ROPE ? r : NULL;
+}
+
+static unsigned flat_size(devs_ctx_t *ctx, value_t v) {
+    devs_string_rope_t *r = devs_string_get_rope(ctx, v);
+    if (r)
+        return r->size;
+    unsigned sz;
+    devs_string_get_utf8(ctx, v, &sz);
+    return sz;
+}
+
+// copy contents of v, so that they end at dst_end
+static void rope_fill(devs_ctx_t *ctx, value_t v, char *dst_end) {
+    devs_string_rope_t *r;
+    while ((r = devs_string_get_rope(ctx, v)) != NULL && !devs_is_undefined(r->right)) {
+        // ropes from loops like s = s + x are deep on the left, so iterate there
+        rope_fill(ctx, r->right, dst_end);
+        dst_end -= flat_size(ctx, r->right);
+        v = r->left;
+    }
+    if (r)
+        v = r->left;
+    unsigned sz;
+    const char *data = devs_string_get_utf8(ctx, v, &sz);
+    memcpy(dst_end - sz, data, sz);
+}
+
+static value_t rope_flatten(devs_ctx_t *ctx, value_t v) {
+    devs_string_rope_t *r = devs_handle_ptr_value(ctx, v);
+    if (devs_is_undefined(r->right))
+        return r->left;
+
+    unsigned scope = devs_root_scope(ctx);
+    devs_root_push(ctx, v);
+    value_t res;
+    unsigned sz = r->size, len = r->length;
+    unsigned str_scope;
+    char *p = devs_string_prep(ctx, &res, sz, len, &str_scope);
+    if (p) {
+        rope_fill(ctx, v, p + sz);
+        devs_string_finish(ctx, &res, sz, len, str_scope);
+        // the children are likely garbage now
+        r = devs_handle_ptr_value(ctx, v);
+        r->left = res;
+        r->right = devs_undefined;
+    } else {
+        res = devs_undefined;
+    }
+    devs_root_pop(ctx, scope);
+    return res;
+}
+
 bool devs_is_number(value_t v) {
     return devs_is_tagged_int(v) || devs_handle_type(v) == DEVS_HANDLE_TYPE_FLOAT64;
 }
@@ -25,6 +97,9 @@ const devs_utf8_string_t *devs_string_get_utf8_struct(devs_ctx_t *ctx, value_t v
         if (devs_gc_tag(ptr) == DEVS_GC_TAG_STRING_JMP) {
             devs_string_jmp_t *s = ptr;
             return &s->inner;
+        } else if (devs_gc_tag(ptr) == DEVS_GC_TAG_STRING_ROPE) {
+            value_t flat = rope_flatten(ctx, v);
+            return devs_is_undefined(flat) ? NULL : devs_string_get_utf8_struct(ctx, flat);
         }
         return NULL;
     }
@@ -55,12 +130,19 @@ const char *devs_string_get_utf8(devs_ctx_t *ctx, value_t v, unsigned *size) {
             if (size)
                 *size = s->inner.size;
             return devs_utf8_string_data(&s->inner);
+        } else if (devs_gc_tag(ptr) == DEVS_GC_TAG_STRING_ROPE) {
+            value_t flat = rope_flatten(ctx, v);
+            return devs_is_undefined(flat) ? NULL : devs_string_get_utf8(ctx, flat, size);
         }
         return NULL;
     }
     case DEVS_HANDLE_TYPE_IMG_BUFFERISH:
         return devs_bufferish_is_buffer(v) ? NULL
                                            : devs_get_static_utf8(ctx, devs_handle_value(v), size);
+    case DEVS_HANDLE_TYPE_ASCII_CHAR:
+        if (size)
+            *size = 1;
+        return &ascii_chars[devs_handle_value(v) * 2];
     default:
         return NULL;
     }
@@ -71,6 +153,11 @@ value_t devs_builtin_string(unsigned idx) {
                                   (DEVS_STRIDX_BUILTIN << DEVS_STRIDX__SHIFT) | idx);
 }
 
+value_t devs_string_from_ascii_char(unsigned c) {
+    JD_ASSERT(c < 0x80);
+    return devs_value_from_handle(DEVS_HANDLE_TYPE_ASCII_CHAR, c);
+}
+
 value_t devs_string_vsprintf(devs_ctx_t *ctx, const char *format, va_list ap) {
     if (strstr(format, "%-s"))
         JD_PANIC();
@@ -83,12 +170,13 @@ value_t devs_string_vsprintf(devs_ctx_t *ctx, const char *format, va_list ap) {
     len--;
     sz--;
     value_t r;
-    char *d = devs_string_prep(ctx, &r, sz, len);
+    unsigned scope;
+    char *d = devs_string_prep(ctx, &r, sz, len, &scope);
     if (d) {
         sz = jd_vsprintf_ext(d, sz + 1, format, &len, ap2);
         len--;
         sz--;
-        devs_string_finish(ctx, &r, sz, len);
+        devs_string_finish(ctx, &r, sz, len, scope);
     }
     return r;
 }
@@ -102,6 +190,8 @@ value_t devs_string_sprintf(devs_ctx_t *ctx, const char *format, ...) {
 }
 
 value_t devs_string_from_utf8(devs_ctx_t *ctx, const uint8_t *utf8, unsigned size) {
+    if (size == 1 && utf8[0] < 0x80)
+        return devs_string_from_ascii_char(utf8[0]);
     devs_any_string_t *s = devs_string_try_alloc_init(ctx, (const char *)utf8, size);
     if (s == NULL) {
         return devs_undefined;
@@ -122,6 +212,25 @@ static value_t buffer_to_string(devs_ctx_t *ctx, value_t v) {
     }
 }
 
+static value_t int_to_string(devs_ctx_t *ctx, int32_t v) {
+    if (0 <= v && v <= 9)
+        return devs_string_from_ascii_char('0' + v);
+
+    // consecutive ints (loop counters, array indices) land in different slots
+    unsigned h = (uint32_t)v & (DEVS_INT_STR_CACHE_SIZE - 1);
+    if (ctx->int_str_keys[h] == v && !devs_is_undefined(ctx->int_str_vals[h]))
+        return ctx->int_str_vals[h];
+
+    char buf[12];
+    unsigned sz = devs_itoa(v, buf);
+    value_t r = devs_string_from_utf8(ctx, (const uint8_t *)buf, sz);
+    if (!devs_is_undefined(r)) {
+        ctx->int_str_keys[h] = v;
+        ctx->int_str_vals[h] = r;
+    }
+    return r;
+}
+
 value_t devs_value_to_string(devs_ctx_t *ctx, value_t v) {
     if (devs_is_string(ctx, v))
         return v;
@@ -129,9 +238,14 @@ value_t devs_value_to_string(devs_ctx_t *ctx, value_t v) {
     uint32_t hv;
     switch (devs_handle_type(v)) {
     case DEVS_HANDLE_TYPE_FLOAT64: {
-        char buf[64];
-        jd_print_double(buf, devs_value_to_double(ctx, v), 7);
-        return devs_string_sprintf(ctx, "%s", buf);
+        if (devs_is_tagged_int(v))
+            return int_to_string(ctx, v.val_int32);
+        double d = devs_value_to_double(ctx, v);
+        if (-2147483648.0 <= d && d <= 2147483647.0 && d == (int32_t)d)
+            return int_to_string(ctx, (int32_t)d); // also -0
+        char buf[DEVS_DTOA_SIZE];
+        unsigned sz = devs_dtoa(d, buf);
+        return devs_string_from_utf8(ctx, (const uint8_t *)buf, sz);
     }
     case DEVS_HANDLE_TYPE_SPECIAL:
         switch ((hv = devs_handle_value(v))) {
@@ -178,7 +292,12 @@ value_t devs_value_to_string(devs_ctx_t *ctx, value_t v) {
         case DEVS_GC_TAG_BOUND_FUNCTION:
             return devs_builtin_string(DEVS_BUILTIN_STRING_FUNCTION); // TODO?
         case DEVS_GC_TAG_BUFFER:
+        case DEVS_GC_TAG_BUFFER_VIEW:
             return buffer_to_string(ctx, v);
+        case DEVS_GC_TAG_TYPED_ARRAY: {
+            devs_typed_array_t *arr = devs_handle_ptr_value(ctx, v);
+            return devs_builtin_string(devs_typed_array_name_idx(arr->kind));
+        }
         case DEVS_GC_TAG_PACKET: {
             devs_packet_t *pkt = devs_handle_ptr_value(ctx, v);
             return devs_string_sprintf(ctx, "[Packet: %s cmd=%x sz=%d]",
@@ -194,9 +313,12 @@ value_t devs_value_to_string(devs_ctx_t *ctx, value_t v) {
         case DEVS_GC_TAG_HALF_STATIC_MAP:
         case DEVS_GC_TAG_MAP:
             return devs_builtin_string(DEVS_BUILTIN_STRING_MAP);
+        case DEVS_GC_TAG_JSON_PARSER:
+            return devs_string_sprintf(ctx, "[JSONParser]");
         case DEVS_GC_TAG_BUILTIN_PROTO: // can't happen
         case DEVS_GC_TAG_STRING_JMP:    // handled on top
         case DEVS_GC_TAG_STRING:        // handled on top
+        case DEVS_GC_TAG_STRING_ROPE:   // handled on top
         default:
             JD_PANIC();
         }
@@ -226,48 +348,50 @@ value_t devs_value_to_string(devs_ctx_t *ctx, value_t v) {
     }
 }
 
-static value_t devs_value_to_string_and_pin(devs_ctx_t *ctx, value_t a) {
-    if (!devs_is_string(ctx, a)) {
-        value_t tmp = devs_value_to_string(ctx, a);
-        devs_value_pin(ctx, tmp);
-        devs_value_unpin(ctx, a);
-        return tmp;
-    } else {
-        return a;
-    }
-}
-
 void devs_map_set_string_field(devs_ctx_t *ctx, devs_map_t *m, unsigned builtin_str, value_t msg) {
-    devs_value_pin(ctx, msg);
-    msg = devs_value_to_string_and_pin(ctx, msg);
+    unsigned scope = devs_root_scope(ctx);
+    devs_root_push(ctx, msg);
+    msg = devs_root_push(ctx, devs_value_to_string(ctx, msg));
     devs_map_set(ctx, m, devs_builtin_string(builtin_str), msg);
-    devs_value_unpin(ctx, msg);
+    devs_root_pop(ctx, scope);
 }
 
 value_t devs_string_concat(devs_ctx_t *ctx, value_t a, value_t b) {
-    bool dup = (a.u64 == b.u64);
-
-    devs_value_pin(ctx, a);
-    if (!dup)
-        devs_value_pin(ctx, b);
+    unsigned scope = devs_root_scope(ctx);
+    devs_root_push(ctx, a);
+    devs_root_push(ctx, b);
 
-    a = devs_value_to_string_and_pin(ctx, a);
+    a = devs_root_push(ctx, devs_value_to_string(ctx, a));
+    b = devs_root_push(ctx, devs_value_to_string(ctx, b));
 
-    if (dup)
-        b = a;
-    else
-        b = devs_value_to_string_and_pin(ctx, b);
+    devs_string_rope_t *ar = devs_string_get_rope(ctx, a);
+    devs_string_rope_t *br = devs_string_get_rope(ctx, b);
+    if (br && br->depth >= ROPE_MAX_DEPTH) {
+        b = devs_root_push(ctx, rope_flatten(ctx, b));
+        br = NULL;
+    }
 
-    const char *ap, *bp;
+    // ropes are never empty, and don't need to be flattened here
     unsigned asz, bsz, alen, blen;
-    ap = devs_string_get_utf8(ctx, a, &asz);
-    bp = devs_string_get_utf8(ctx, b, &bsz);
-    alen = devs_string_length(ctx, a);
-    blen = devs_string_length(ctx, b);
+    bool ok = true;
+    if (ar) {
+        asz = ar->size;
+        alen = ar->length;
+    } else {
+        ok = devs_string_get_utf8(ctx, a, &asz) != NULL;
+        alen = devs_string_length(ctx, a);
+    }
+    if (br) {
+        bsz = br->size;
+        blen = br->length;
+    } else {
+        ok = ok && devs_string_get_utf8(ctx, b, &bsz) != NULL;
+        blen = devs_string_length(ctx, b);
+    }
 
     value_t r;
 
-    if (ap == NULL || bp == NULL) {
+    if (!ok) {
         // strange...
         devs_invalid_program(ctx, 60126);
         r = devs_undefined;
@@ -275,20 +399,36 @@ value_t devs_string_concat(devs_ctx_t *ctx, value_t a, value_t b) {
         r = b;
     } else if (bsz == 0) {
         r = a;
+    } else if (asz + bsz > DEVS_MAX_ALLOC) {
+        devs_throw_too_big_error(ctx, DEVS_BUILTIN_STRING_STRING);
+        r = devs_undefined;
+    } else if (asz + bsz >= ROPE_MIN_SIZE) {
+        devs_string_rope_t *rope =
+            devs_any_try_alloc(ctx, DEVS_GC_TAG_STRING_ROPE, sizeof(devs_string_rope_t));
+        if (rope) {
+            rope->size = asz + bsz;
+            rope->length = alen + blen;
+            rope->depth = ar ? ar->depth : 0;
+            if (br && br->depth + 1 > rope->depth)
+                rope->depth = br->depth + 1;
+            rope->left = a;
+            rope->right = b;
+        }
+        r = devs_value_from_gc_obj(ctx, rope);
     } else {
         unsigned sz = asz + bsz;
         unsigned len = alen + blen;
-        char *p = devs_string_prep(ctx, &r, sz, len);
+        unsigned str_scope;
+        char *p = devs_string_prep(ctx, &r, sz, len, &str_scope);
         if (p) {
-            memcpy(p, ap, asz);
-            memcpy(p + asz, bp, bsz);
-            devs_string_finish(ctx, &r, sz, len);
+            // both are short, so neither is a rope
+            memcpy(p, devs_string_get_utf8(ctx, a, NULL), asz);
+            memcpy(p + asz, devs_string_get_utf8(ctx, b, NULL), bsz);
+            devs_string_finish(ctx, &r, sz, len, str_scope);
         }
     }
 
-    devs_value_unpin(ctx, a);
-    if (!dup)
-        devs_value_unpin(ctx, b);
+    devs_root_pop(ctx, scope);
 
     return r;
 }
@@ -328,6 +468,22 @@ value_t devs_string_slice(devs_ctx_t *ctx, value_t str, int start, int endp) {
     if (endp < 0)
         endp = sz;
 
-    devs_any_string_t *r = devs_string_try_alloc_init(ctx, data + start, endp - start);
-    return devs_value_from_gc_obj(ctx, r);
+    return devs_string_from_utf8(ctx, (const uint8_t *)data + start, endp - start);
+}
+
+int devs_string_cmp(devs_ctx_t *ctx, value_t a, value_t b) {
+    unsigned scope = devs_root_scope(ctx);
+    // flattening ropes allocates
+    devs_root_push(ctx, a);
+    devs_root_push(ctx, b);
+    unsigned asz, bsz;
+    devs_string_get_utf8(ctx, a, &asz);
+    const char *bp = devs_string_get_utf8(ctx, b, &bsz);
+    const char *ap = devs_string_get_utf8(ctx, a, NULL);
+    devs_root_pop(ctx, scope);
+    // byte order of UTF-8 is the same as code point order
+    int r = memcmp(ap, bp, asz < bsz ? asz : bsz);
+    if (r == 0)
+        r = (int)asz - (int)bsz;
+    return r;
 }
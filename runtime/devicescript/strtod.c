@@ -0,0 +1,257 @@
+#include "devs_internal.h"
+#include <stdlib.h>
+
+// Decimal string to double conversion, using the Eisel-Lemire algorithm (Lemire, "Number
+// Parsing at a Gigabyte per Second", 2021), with Clinger's fast path in front of it.
+// Inputs the fast paths can't decide (more than 19 significant digits, exponents outside
+// of the table, hex, inf/nan) go to the C library strtod().
+
+#define POW5_MIN -64
+#define POW5_MAX 64
+
+// 5^q for q = POW5_MIN ... POW5_MAX, normalized to 128 bits (high word first)
+static const uint64_t pow5_tbl[] = {
+    0xa87fea27a539e9a5ULL, 0x3f2398d747b36224ULL, 0xd29fe4b18e88640eULL, 0x8eec7f0d19a03aadULL,
+    0x83a3eeeef9153e89ULL, 0x1953cf68300424acULL, 0xa48ceaaab75a8e2bULL, 0x5fa8c3423c052dd7ULL,
+    0xcdb02555653131b6ULL, 0x3792f412cb06794dULL, 0x808e17555f3ebf11ULL, 0xe2bbd88bbee40bd0ULL,
+    0xa0b19d2ab70e6ed6ULL, 0x5b6aceaeae9d0ec4ULL, 0xc8de047564d20a8bULL, 0xf245825a5a445275ULL,
+    0xfb158592be068d2eULL, 0xeed6e2f0f0d56712ULL, 0x9ced737bb6c4183dULL, 0x55464dd69685606bULL,
+    0xc428d05aa4751e4cULL, 0xaa97e14c3c26b886ULL, 0xf53304714d9265dfULL, 0xd53dd99f4b3066a8ULL,
+    0x993fe2c6d07b7fabULL, 0xe546a8038efe4029ULL, 0xbf8fdb78849a5f96ULL, 0xde98520472bdd033ULL,
+    0xef73d256a5c0f77cULL, 0x963e66858f6d4440ULL, 0x95a8637627989aadULL, 0xdde7001379a44aa8ULL,
+    0xbb127c53b17ec159ULL, 0x5560c018580d5d52ULL, 0xe9d71b689dde71afULL, 0xaab8f01e6e10b4a6ULL,
+    0x9226712162ab070dULL, 0xcab3961304ca70e8ULL, 0xb6b00d69bb55c8d1ULL, 0x3d607b97c5fd0d22ULL,
+    0xe45c10c42a2b3b05ULL, 0x8cb89a7db77c506aULL, 0x8eb98a7a9a5b04e3ULL, 0x77f3608e92adb242ULL,
+    0xb267ed1940f1c61cULL, 0x55f038b237591ed3ULL, 0xdf01e85f912e37a3ULL, 0x6b6c46dec52f6688ULL,
+    0x8b61313bbabce2c6ULL, 0x2323ac4b3b3da015ULL, 0xae397d8aa96c1b77ULL, 0xabec975e0a0d081aULL,
+    0xd9c7dced53c72255ULL, 0x96e7bd358c904a21ULL, 0x881cea14545c7575ULL, 0x7e50d64177da2e54ULL,
+    0xaa242499697392d2ULL, 0xdde50bd1d5d0b9e9ULL, 0xd4ad2dbfc3d07787ULL, 0x955e4ec64b44e864ULL,
+    0x84ec3c97da624ab4ULL, 0xbd5af13bef0b113eULL, 0xa6274bbdd0fadd61ULL, 0xecb1ad8aeacdd58eULL,
+    0xcfb11ead453994baULL, 0x67de18eda5814af2ULL, 0x81ceb32c4b43fcf4ULL, 0x80eacf948770ced7ULL,
+    0xa2425ff75e14fc31ULL, 0xa1258379a94d028dULL, 0xcad2f7f5359a3b3eULL, 0x096ee45813a04330ULL,
+    0xfd87b5f28300ca0dULL, 0x8bca9d6e188853fcULL, 0x9e74d1b791e07e48ULL, 0x775ea264cf55347eULL,
+    0xc612062576589ddaULL, 0x95364afe032a819eULL, 0xf79687aed3eec551ULL, 0x3a83ddbd83f52205ULL,
+    0x9abe14cd44753b52ULL, 0xc4926a9672793543ULL, 0xc16d9a0095928a27ULL, 0x75b7053c0f178294ULL,
+    0xf1c90080baf72cb1ULL, 0x5324c68b12dd6339ULL, 0x971da05074da7beeULL, 0xd3f6fc16ebca5e04ULL,
+    0xbce5086492111aeaULL, 0x88f4bb1ca6bcf585ULL, 0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e6ULL,
+    0x9392ee8e921d5d07ULL, 0x3aff322e62439fd0ULL, 0xb877aa3236a4b449ULL, 0x09befeb9fad487c3ULL,
+    0xe69594bec44de15bULL, 0x4c2ebe687989a9b4ULL, 0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a11ULL,
+    0xb424dc35095cd80fULL, 0x538484c19ef38c95ULL, 0xe12e13424bb40e13ULL, 0x2865a5f206b06fbaULL,
+    0x8cbccc096f5088cbULL, 0xf93f87b7442e45d4ULL, 0xafebff0bcb24aafeULL, 0xf78f69a51539d749ULL,
+    0xdbe6fecebdedd5beULL, 0xb573440e5a884d1cULL, 0x89705f4136b4a597ULL, 0x31680a88f8953031ULL,
+    0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3eULL, 0xd6bf94d5e57a42bcULL, 0x3d32907604691b4dULL,
+    0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b110ULL, 0xa7c5ac471b478423ULL, 0x0fcf80dc33721d54ULL,
+    0xd1b71758e219652bULL, 0xd3c36113404ea4a9ULL, 0x83126e978d4fdf3bULL, 0x645a1cac083126eaULL,
+    0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a4ULL, 0xccccccccccccccccULL, 0xcccccccccccccccdULL,
+    0x8000000000000000ULL, 0x0000000000000000ULL, 0xa000000000000000ULL, 0x0000000000000000ULL,
+    0xc800000000000000ULL, 0x0000000000000000ULL, 0xfa00000000000000ULL, 0x0000000000000000ULL,
+    0x9c40000000000000ULL, 0x0000000000000000ULL, 0xc350000000000000ULL, 0x0000000000000000ULL,
+    0xf424000000000000ULL, 0x0000000000000000ULL, 0x9896800000000000ULL, 0x0000000000000000ULL,
+    0xbebc200000000000ULL, 0x0000000000000000ULL, 0xee6b280000000000ULL, 0x0000000000000000ULL,
+    0x9502f90000000000ULL, 0x0000000000000000ULL, 0xba43b74000000000ULL, 0x0000000000000000ULL,
+    0xe8d4a51000000000ULL, 0x0000000000000000ULL, 0x9184e72a00000000ULL, 0x0000000000000000ULL,
+    0xb5e620f480000000ULL, 0x0000000000000000ULL, 0xe35fa931a0000000ULL, 0x0000000000000000ULL,
+    0x8e1bc9bf04000000ULL, 0x0000000000000000ULL, 0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL,
+    0xde0b6b3a76400000ULL, 0x0000000000000000ULL, 0x8ac7230489e80000ULL, 0x0000000000000000ULL,
+    0xad78ebc5ac620000ULL, 0x0000000000000000ULL, 0xd8d726b7177a8000ULL, 0x0000000000000000ULL,
+    0x878678326eac9000ULL, 0x0000000000000000ULL, 0xa968163f0a57b400ULL, 0x0000000000000000ULL,
+    0xd3c21bcecceda100ULL, 0x0000000000000000ULL, 0x84595161401484a0ULL, 0x0000000000000000ULL,
+    0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL, 0xcecb8f27f4200f3aULL, 0x0000000000000000ULL,
+    0x813f3978f8940984ULL, 0x4000000000000000ULL, 0xa18f07d736b90be5ULL, 0x5000000000000000ULL,
+    0xc9f2c9cd04674edeULL, 0xa400000000000000ULL, 0xfc6f7c4045812296ULL, 0x4d00000000000000ULL,
+    0x9dc5ada82b70b59dULL, 0xf020000000000000ULL, 0xc5371912364ce305ULL, 0x6c28000000000000ULL,
+    0xf684df56c3e01bc6ULL, 0xc732000000000000ULL, 0x9a130b963a6c115cULL, 0x3c7f400000000000ULL,
+    0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL, 0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL,
+    0x96769950b50d88f4ULL, 0x1314448000000000ULL, 0xbc143fa4e250eb31ULL, 0x17d955a000000000ULL,
+    0xeb194f8e1ae525fdULL, 0x5dcfab0800000000ULL, 0x92efd1b8d0cf37beULL, 0x5aa1cae500000000ULL,
+    0xb7abc627050305adULL, 0xf14a3d9e40000000ULL, 0xe596b7b0c643c719ULL, 0x6d9ccd05d0000000ULL,
+    0x8f7e32ce7bea5c6fULL, 0xe4820023a2000000ULL, 0xb35dbf821ae4f38bULL, 0xdda2802c8a800000ULL,
+    0xe0352f62a19e306eULL, 0xd50b2037ad200000ULL, 0x8c213d9da502de45ULL, 0x4526f422cc340000ULL,
+    0xaf298d050e4395d6ULL, 0x9670b12b7f410000ULL, 0xdaf3f04651d47b4cULL, 0x3c0cdd765f114000ULL,
+    0x88d8762bf324cd0fULL, 0xa5880a69fb6ac800ULL, 0xab0e93b6efee0053ULL, 0x8eea0d047a457a00ULL,
+    0xd5d238a4abe98068ULL, 0x72a4904598d6d880ULL, 0x85a36366eb71f041ULL, 0x47a6da2b7f864750ULL,
+    0xa70c3c40a64e6c51ULL, 0x999090b65f67d924ULL, 0xd0cf4b50cfe20765ULL, 0xfff4b4e3f741cf6dULL,
+    0x82818f1281ed449fULL, 0xbff8f10e7a8921a4ULL, 0xa321f2d7226895c7ULL, 0xaff72d52192b6a0dULL,
+    0xcbea6f8ceb02bb39ULL, 0x9bf4f8a69f764490ULL, 0xfee50b7025c36a08ULL, 0x02f236d04753d5b4ULL,
+    0x9f4f2726179a2245ULL, 0x01d762422c946590ULL, 0xc722f0ef9d80aad6ULL, 0x424d3ad2b7b97ef5ULL,
+    0xf8ebad2b84e0d58bULL, 0xd2e0898765a7deb2ULL, 0x9b934c3b330c8577ULL, 0x63cc55f49f88eb2fULL,
+    0xc2781f49ffcfa6d5ULL, 0x3cbf6b71c76b25fbULL,
+};
+
+// exactly representable powers of 10
+static const double exact_pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static void full_mul(uint64_t a, uint64_t b, uint64_t *hi, uint64_t *lo) {
+    // no __int128 on 32-bit targets
+    uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+    uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+    uint64_t p0 = a_lo * b_lo;
+    uint64_t p1 = a_lo * b_hi;
+    uint64_t p2 = a_hi * b_lo;
+    uint64_t p3 = a_hi * b_hi;
+    uint64_t mid = (p0 >> 32) + (uint32_t)p1 + (uint32_t)p2;
+    *lo = (mid << 32) | (uint32_t)p0;
+    *hi = p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+}
+
+static int clz64(uint64_t v) {
+    int n = 0;
+    if (!(v >> 32)) {
+        n += 32;
+        v <<= 32;
+    }
+    while (!(v >> 63)) {
+        n++;
+        v <<= 1;
+    }
+    return n;
+}
+
+// w * 10^q for w != 0, or -1 when the product can't be rounded without more digits
+static double eisel_lemire(uint64_t w, int q) {
+    int lz = clz64(w);
+    w <<= lz;
+
+    const uint64_t *pow5 = &pow5_tbl[2 * (q - POW5_MIN)];
+    uint64_t hi, lo;
+    full_mul(w, pow5[0], &hi, &lo);
+    if ((hi & 0x1FF) == 0x1FF) {
+        // the 64 bit approximation is not enough; use the low word of 5^q too
+        uint64_t hi2, lo2;
+        full_mul(w, pow5[1], &hi2, &lo2);
+        lo += hi2;
+        if (lo < hi2)
+            hi++;
+        // 5^q is truncated, so the product might still be off by one
+        if ((hi & 0x1FF) == 0x1FF && lo == UINT64_MAX)
+            return -1;
+    }
+
+    int upperbit = hi >> 63;
+    int shift = upperbit + 9;
+    uint64_t m = hi >> shift;
+    // binary exponent of 10^q is about q * log2(10)
+    int e2 = (((152170 + 65536) * q) >> 16) + 63 + upperbit - lz + 1023;
+
+    if (e2 <= 0)
+        return -1; // subnormal; let strtod() deal with it
+
+    // exactly half-way between two doubles; round to even
+    if (lo <= 1 && q >= -4 && q <= 23 && (m & 3) == 1 && (m << shift) == hi)
+        m &= ~(uint64_t)1;
+
+    m += m & 1;
+    m >>= 1;
+    if (m >= ((uint64_t)2 << 52)) {
+        m = (uint64_t)1 << 52;
+        e2++;
+    }
+    m &= ~((uint64_t)1 << 52);
+    if (e2 >= 0x7FF)
+        return -1;
+
+    uint64_t bits = m | ((uint64_t)e2 << 52);
+    double r;
+    memcpy(&r, &bits, sizeof(r));
+    return r;
+}
+
+static bool is_digit(char c) {
+    return '0' <= c && c <= '9';
+}
+
+double devs_strtod(const char *str, char **endp) {
+    const char *p = str;
+    while (*p == ' ' || ('\t' <= *p && *p <= '\r'))
+        p++;
+
+    bool neg = false;
+    if (*p == '-' || *p == '+')
+        neg = *p++ == '-';
+
+    uint64_t w = 0;
+    int num_digits = 0; // significant ones
+    int q = 0;
+    bool any_digits = false;
+
+    // hex, inf, nan etc.
+    if (!is_digit(*p) && !(*p == '.' && is_digit(p[1])))
+        return strtod(str, endp);
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+        return strtod(str, endp);
+
+    while (*p == '0') {
+        any_digits = true;
+        p++;
+    }
+    while (is_digit(*p)) {
+        if (num_digits < 19)
+            w = w * 10 + (*p - '0');
+        else
+            q++;
+        num_digits++;
+        any_digits = true;
+        p++;
+    }
+    if (*p == '.' && (any_digits || is_digit(p[1]))) {
+        p++;
+        if (num_digits == 0) {
+            while (*p == '0') {
+                any_digits = true;
+                q--;
+                p++;
+            }
+        }
+        while (is_digit(*p)) {
+            if (num_digits < 19) {
+                w = w * 10 + (*p - '0');
+                q--;
+            }
+            num_digits++;
+            any_digits = true;
+            p++;
+        }
+    }
+    if (!any_digits) {
+        if (endp)
+            *endp = (char *)str;
+        return 0;
+    }
+    if ((*p == 'e' || *p == 'E') &&
+        (is_digit(p[1]) || ((p[1] == '-' || p[1] == '+') && is_digit(p[2])))) {
+        p++;
+        bool eneg = false;
+        if (*p == '-' || *p == '+')
+            eneg = *p++ == '-';
+        int e = 0;
+        while (is_digit(*p)) {
+            if (e < 100000)
+                e = e * 10 + (*p - '0');
+            p++;
+        }
+        q += eneg ? -e : e;
+    }
+
+    if (endp)
+        *endp = (char *)p;
+
+    double r;
+    if (w == 0) {
+        r = 0;
+    } else if (num_digits > 19) {
+        // digits were dropped
+        return strtod(str, endp);
+    } else if (w <= ((uint64_t)1 << 53) && -22 <= q && q <= 22) {
+        // both w and 10^|q| are exact, so a single rounding happens
+        r = q < 0 ? (double)w / exact_pow10[-q] : (double)w * exact_pow10[q];
+    } else if (POW5_MIN <= q && q <= POW5_MAX && (r = eisel_lemire(w, q)) >= 0) {
+        // r set
+    } else {
+        return strtod(str, endp);
+    }
+
+    return neg ? -r : r;
+}
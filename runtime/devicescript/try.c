@@ -147,10 +147,10 @@ void devs_throw(devs_ctx_t *ctx, value_t exn, unsigned flags) {
             devs_object_get_built_in_field(ctx, exn, DEVS_BUILTIN_STRING___STACK__);
         if (devs_is_undefined(curr_stack)) {
             // keep the original stack when we re-throw
-            value_t stack = devs_capture_stack(ctx);
-            devs_value_pin(ctx, stack);
+            unsigned scope = devs_root_scope(ctx);
+            value_t stack = devs_root_push(ctx, devs_capture_stack(ctx));
             devs_any_set(ctx, exn, devs_builtin_string(DEVS_BUILTIN_STRING___STACK__), stack);
-            devs_value_unpin(ctx, stack);
+            devs_root_pop(ctx, scope);
         }
     }
 }
@@ -261,14 +261,14 @@ value_t devs_alloc_error(devs_ctx_t *ctx, unsigned proto_idx, const char *format
     if (exn == NULL)
         return devs_undefined;
 
-    value_t exnval = devs_value_from_gc_obj(ctx, exn);
-    devs_value_pin(ctx, exnval);
+    unsigned scope = devs_root_scope(ctx);
+    value_t exnval = devs_root_push(ctx, devs_value_from_gc_obj(ctx, exn));
 
     value_t msg = devs_string_vsprintf(ctx, format, arg);
 
     devs_map_set_string_field(ctx, exn, DEVS_BUILTIN_STRING_MESSAGE, msg);
 
-    devs_value_unpin(ctx, exnval);
+    devs_root_pop(ctx, scope);
 
     return exnval;
 }
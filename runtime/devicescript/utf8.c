@@ -1,5 +1,13 @@
 #include "devs_internal.h"
 
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
 // inspired by https://www.cl.cam.ac.uk/~mgk25/ucs/utf8_check.c
 
 // https://en.wikipedia.org/wiki/Specials_(Unicode_block)#Replacement_character
@@ -36,7 +44,36 @@ int devs_string_index(devs_ctx_t *ctx, value_t s, unsigned idx) {
     }
 }
 
+int devs_string_jmp_char_index(const devs_utf8_string_t *dst, unsigned off) {
+    // find the last jump table entry at or before off, then count the rest
+    unsigned lo = 0, hi = devs_utf8_string_jmp_entries(dst->length);
+    while (lo < hi) {
+        unsigned mid = (lo + hi) >> 1;
+        if (dst->jmp_table[mid] <= off)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    unsigned idx = lo << DEVS_UTF8_TABLE_SHIFT;
+    unsigned pos = lo == 0 ? 0 : dst->jmp_table[lo - 1];
+    uint8_t *p = (uint8_t *)devs_utf8_string_data(dst);
+    for (; pos < off; pos++)
+        if (!devs_utf8_is_cont(p[pos]))
+            idx++;
+    return idx;
+}
+
+int devs_string_char_index(devs_ctx_t *ctx, value_t s, unsigned off) {
+    const devs_utf8_string_t *u = devs_string_get_utf8_struct(ctx, s);
+    if (u)
+        return devs_string_jmp_char_index(u, off);
+    return off;
+}
+
 int devs_string_length(devs_ctx_t *ctx, value_t s) {
+    devs_string_rope_t *r = devs_string_get_rope(ctx, s);
+    if (r)
+        return r->length;
     const devs_utf8_string_t *u = devs_string_get_utf8_struct(ctx, s);
     if (u)
         return u->length;
@@ -110,6 +147,53 @@ int devs_string_jmp_init(devs_ctx_t *ctx, devs_string_jmp_t *dst) {
     return r;
 }
 
+// number of leading bytes in [sp, ep) that are below 0x80
+static unsigned ascii_prefix(const uint8_t *sp, const uint8_t *ep) {
+    const uint8_t *p = sp;
+#if defined(__AVX2__)
+    while (ep - p >= 32) {
+        unsigned m = _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)p));
+        if (m)
+            return p - sp + __builtin_ctz(m);
+        p += 32;
+    }
+#endif
+#if defined(__SSE2__) || defined(__AVX2__)
+    while (ep - p >= 16) {
+        unsigned m = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)p));
+        if (m)
+            return p - sp + __builtin_ctz(m);
+        p += 16;
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    while (ep - p >= 16) {
+        if (vmaxvq_u8(vld1q_u8(p)) & 0x80)
+            break;
+        p += 16;
+    }
+#elif defined(__wasm_simd128__)
+    while (ep - p >= 16) {
+        unsigned m = wasm_i8x16_bitmask(wasm_v128_load(p));
+        if (m)
+            return p - sp + __builtin_ctz(m);
+        p += 16;
+    }
+#else
+    // one word at a time; memcpy() keeps this safe on cores without unaligned loads
+    const uintptr_t hi_bits = (uintptr_t)-1 / 0xff * 0x80;
+    while (ep - p >= (int)sizeof(uintptr_t)) {
+        uintptr_t w;
+        memcpy(&w, p, sizeof(w));
+        if (w & hi_bits)
+            break;
+        p += sizeof(w);
+    }
+#endif
+    while (p < ep && *p < 0x80)
+        p++;
+    return p - sp;
+}
+
 int devs_utf8_init(const char *data, unsigned size, unsigned *out_len_p,
                    const devs_utf8_string_t *dst, unsigned flags) {
     const uint8_t *sp = (const uint8_t *)data;
@@ -122,11 +206,31 @@ int devs_utf8_init(const char *data, unsigned size, unsigned *out_len_p,
         dp = (uint8_t *)devs_utf8_string_data(dst);
 
     while (sp < ep) {
-        unsigned ch_len = 1;
         if (sp[0] < 0x80) {
-            // 0xxxxxxx
-            // OK
-        } else if ((sp[0] & 0xe0) == 0xc0) {
+            // ASCII run: one code point per byte, no validation needed
+            unsigned n = ascii_prefix(sp, ep);
+            if (dp)
+                memcpy(dp + out_sz, sp, n);
+            if (flags & (DEVS_UTF8_INIT_SET_JMP | DEVS_UTF8_INIT_CHK_JMP)) {
+                // jmp_table[k] is the offset of code point (k + 1) << DEVS_UTF8_TABLE_SHIFT
+                unsigned k = out_len >> DEVS_UTF8_TABLE_SHIFT;
+                unsigned pos = (k + 1) << DEVS_UTF8_TABLE_SHIFT;
+                for (; pos <= out_len + n; k++, pos += 1 << DEVS_UTF8_TABLE_SHIFT) {
+                    unsigned off = out_sz + pos - out_len;
+                    if (flags & DEVS_UTF8_INIT_SET_JMP)
+                        ((uint16_t *)dst->jmp_table)[k] = off;
+                    else if (dst->jmp_table[k] != off)
+                        return DEVS_UTF8_INIT_ERR_JMP_TBL;
+                }
+            }
+            sp += n;
+            out_sz += n;
+            out_len += n;
+            continue;
+        }
+
+        unsigned ch_len = 1;
+        if ((sp[0] & 0xe0) == 0xc0) {
             // 110XXXXx 10xxxxxx
             if (ep - sp < 1 || !devs_utf8_is_cont(sp[1])) {
                 goto repl;
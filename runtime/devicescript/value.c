@@ -138,7 +138,7 @@ double devs_value_to_double(devs_ctx_t *ctx, value_t v) {
         unsigned sz;
         const char *data = devs_string_get_utf8(ctx, v, &sz);
         char *endp;
-        double d = strtod(data, &endp);
+        double d = devs_strtod(data, &endp);
         if (data != endp)
             return d;
     }
@@ -178,8 +178,10 @@ bool devs_value_to_bool(devs_ctx_t *ctx, value_t v) {
 
 bool devs_is_buffer(devs_ctx_t *ctx, value_t v) {
     switch (devs_handle_type(v)) {
-    case DEVS_HANDLE_TYPE_GC_OBJECT:
-        return devs_gc_tag(devs_handle_ptr_value(ctx, v)) == DEVS_GC_TAG_BUFFER;
+    case DEVS_HANDLE_TYPE_GC_OBJECT: {
+        int tag = devs_gc_tag(devs_handle_ptr_value(ctx, v));
+        return tag == DEVS_GC_TAG_BUFFER || tag == DEVS_GC_TAG_BUFFER_VIEW;
+    }
     case DEVS_HANDLE_TYPE_IMG_BUFFERISH:
         return devs_bufferish_is_buffer(v);
     default:
@@ -188,6 +190,9 @@ bool devs_is_buffer(devs_ctx_t *ctx, value_t v) {
 }
 
 bool devs_buffer_is_writable(devs_ctx_t *ctx, value_t v) {
+    devs_buffer_view_t *view = devs_value_to_gc_obj(ctx, v);
+    if (devs_gc_tag(view) == DEVS_GC_TAG_BUFFER_VIEW)
+        v = view->parent;
     return devs_is_buffer(ctx, v) && devs_handle_type(v) != DEVS_HANDLE_TYPE_IMG_BUFFERISH;
 }
 
@@ -196,6 +201,13 @@ void *devs_buffer_data(devs_ctx_t *ctx, value_t v, unsigned *sz) {
     switch (devs_handle_type(v)) {
     case DEVS_HANDLE_TYPE_GC_OBJECT: {
         devs_buffer_t *buf = devs_handle_ptr_value(ctx, v);
+        if (devs_gc_tag(buf) == DEVS_GC_TAG_BUFFER_VIEW) {
+            devs_buffer_view_t *view = (void *)buf;
+            uint8_t *data = devs_buffer_data(ctx, view->parent, NULL);
+            if (sz)
+                *sz = view->length;
+            return data + view->offset;
+        }
         if (sz)
             *sz = buf->length;
         return buf->data;
@@ -233,6 +245,11 @@ bool devs_is_array(devs_ctx_t *ctx, value_t v) {
     return devs_gc_tag(devs_value_to_gc_obj(ctx, v)) == DEVS_GC_TAG_ARRAY;
 }
 
+devs_typed_array_t *devs_value_to_typed_array(devs_ctx_t *ctx, value_t v) {
+    devs_typed_array_t *arr = devs_value_to_gc_obj(ctx, v);
+    return devs_gc_tag(arr) == DEVS_GC_TAG_TYPED_ARRAY ? arr : NULL;
+}
+
 unsigned devs_value_typeof(devs_ctx_t *ctx, value_t v) {
     uint32_t hv;
 
@@ -274,22 +291,26 @@ unsigned devs_value_typeof(devs_ctx_t *ctx, value_t v) {
         switch (devs_gc_tag(devs_handle_ptr_value(ctx, v))) {
         case DEVS_GC_TAG_STRING_JMP:
         case DEVS_GC_TAG_STRING:
+        case DEVS_GC_TAG_STRING_ROPE:
             return DEVS_OBJECT_TYPE_STRING;
         case DEVS_GC_TAG_PACKET:
             return DEVS_OBJECT_TYPE_PACKET;
         case DEVS_GC_TAG_SHORT_MAP:
         case DEVS_GC_TAG_HALF_STATIC_MAP:
         case DEVS_GC_TAG_MAP:
+        case DEVS_GC_TAG_TYPED_ARRAY:
             return DEVS_OBJECT_TYPE_MAP;
         case DEVS_GC_TAG_ARRAY:
             return DEVS_OBJECT_TYPE_ARRAY;
         case DEVS_GC_TAG_BUFFER:
+        case DEVS_GC_TAG_BUFFER_VIEW:
             return DEVS_OBJECT_TYPE_BUFFER;
         case DEVS_GC_TAG_IMAGE:
             return DEVS_OBJECT_TYPE_IMAGE;
         case DEVS_GC_TAG_BOUND_FUNCTION:
             return DEVS_OBJECT_TYPE_FUNCTION;
         case DEVS_GC_TAG_ACTIVATION:
+        case DEVS_GC_TAG_JSON_PARSER:
             return DEVS_OBJECT_TYPE_EXOTIC;
         case DEVS_GC_TAG_BUILTIN_PROTO:
         default:
@@ -298,6 +319,8 @@ unsigned devs_value_typeof(devs_ctx_t *ctx, value_t v) {
         }
     case DEVS_HANDLE_TYPE_IMG_BUFFERISH:
         return devs_bufferish_is_buffer(v) ? DEVS_OBJECT_TYPE_BUFFER : DEVS_OBJECT_TYPE_STRING;
+    case DEVS_HANDLE_TYPE_ASCII_CHAR:
+        return DEVS_OBJECT_TYPE_STRING;
     case DEVS_HANDLE_TYPE_ROLE_MEMBER:
         if (devs_value_to_service_spec(ctx, v))
             return DEVS_OBJECT_TYPE_MAP;
@@ -359,6 +382,22 @@ bool devs_value_eq(devs_ctx_t *ctx, value_t a, value_t b) {
         return true;
 
     if (devs_is_string(ctx, a) && devs_is_string(ctx, b)) {
+        // don't flatten ropes just to find out they differ in size
+        devs_string_rope_t *ar = devs_string_get_rope(ctx, a);
+        devs_string_rope_t *br = devs_string_get_rope(ctx, b);
+        if (ar || br) {
+            unsigned asz, bsz;
+            if (ar)
+                asz = ar->size;
+            else
+                devs_string_get_utf8(ctx, a, &asz);
+            if (br)
+                bsz = br->size;
+            else
+                devs_string_get_utf8(ctx, b, &bsz);
+            if (asz != bsz)
+                return false;
+        }
         unsigned alen, blen;
         const char *aptr = devs_string_get_utf8(ctx, a, &alen);
         const char *bptr = devs_string_get_utf8(ctx, b, &blen);
@@ -229,6 +229,7 @@ static void devs_vm_exec_opcode(devs_ctx_t *ctx, devs_activation_t *frame) {
         }
 
         ctx->stack_top_for_gc = ctx->stack_top;
+        unsigned scope = devs_root_scope(ctx);
 
         // devs_dump_stackframe(ctx, frame);
 
@@ -241,6 +242,10 @@ static void devs_vm_exec_opcode(devs_ctx_t *ctx, devs_activation_t *frame) {
             devs_vm_push(ctx, v);
         }
 
+        // drop any roots the handler didn't pop (the ctx might have been reset in the meantime)
+        if (ctx->num_roots > scope)
+            ctx->num_roots = scope;
+
         if (ctx->in_throw)
             devs_process_throw(ctx);
     }
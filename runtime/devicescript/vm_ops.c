@@ -60,17 +60,14 @@ static void stmt2_index_delete(devs_activation_t *frame, devs_ctx_t *ctx) {
     if (!map)
         return;
 
-    bool str = devs_is_string(ctx, idx);
-    if (!str) {
-        idx = devs_value_to_string(ctx, idx);
-        devs_value_pin(ctx, idx);
-    }
+    unsigned scope = devs_root_scope(ctx);
+    if (!devs_is_string(ctx, idx))
+        idx = devs_root_push(ctx, devs_value_to_string(ctx, idx));
 
     if (devs_map_delete(ctx, map, idx) == 0)
         ctx->curr_fiber->ret_val = devs_true;
 
-    if (!str)
-        devs_value_unpin(ctx, idx);
+    devs_root_pop(ctx, scope);
 }
 
 static void stmt_callN(devs_activation_t *frame, devs_ctx_t *ctx, unsigned N) {
@@ -637,13 +634,6 @@ static void exec2_and_force_int(devs_activation_t *frame, devs_ctx_t *ctx) {
     aa = devs_vm_pop_arg_i32(ctx);
 }
 
-static int exec2_and_check_int_or_force_double(devs_activation_t *frame, devs_ctx_t *ctx) {
-    if (exec2_and_check_int(frame, ctx))
-        return 1;
-    force_double(ctx);
-    return 0;
-}
-
 static value_t expr2_add(devs_activation_t *frame, devs_ctx_t *ctx) {
     if (exec2_and_check_int(frame, ctx)) {
         int r;
@@ -745,15 +735,25 @@ static value_t expr2_approx_ne(devs_activation_t *frame, devs_ctx_t *ctx) {
     return devs_value_from_bool(!devs_value_approx_eq(ctx, ctx->binop[0], ctx->binop[1]));
 }
 
+static bool both_are_strings(devs_ctx_t *ctx) {
+    return devs_is_string(ctx, ctx->binop[0]) && devs_is_string(ctx, ctx->binop[1]);
+}
+
 static value_t expr2_le(devs_activation_t *frame, devs_ctx_t *ctx) {
-    if (exec2_and_check_int_or_force_double(frame, ctx))
+    if (exec2_and_check_int(frame, ctx))
         return devs_value_from_bool(aa <= bb);
+    if (both_are_strings(ctx))
+        return devs_value_from_bool(devs_string_cmp(ctx, ctx->binop[0], ctx->binop[1]) <= 0);
+    force_double(ctx);
     return devs_value_from_bool(af <= bf);
 }
 
 static value_t expr2_lt(devs_activation_t *frame, devs_ctx_t *ctx) {
-    if (exec2_and_check_int_or_force_double(frame, ctx))
+    if (exec2_and_check_int(frame, ctx))
         return devs_value_from_bool(aa < bb);
+    if (both_are_strings(ctx))
+        return devs_value_from_bool(devs_string_cmp(ctx, ctx->binop[0], ctx->binop[1]) < 0);
+    force_double(ctx);
     return devs_value_from_bool(af < bf);
 }
 
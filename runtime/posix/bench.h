@@ -0,0 +1,7 @@
+#pragma once
+
+#include "devs_internal.h"
+
+// a context with a GC heap and one global, but no program; for benchmarks and self-tests
+devs_ctx_t *bench_ctx_create(void);
+void bench_ctx_free(devs_ctx_t *ctx);
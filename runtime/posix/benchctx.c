@@ -0,0 +1,22 @@
+#ifndef __EMSCRIPTEN__
+
+#include "bench.h"
+
+static devs_img_header_t bench_hdr;
+
+devs_ctx_t *bench_ctx_create(void) {
+    devs_ctx_t *ctx = jd_alloc(sizeof(*ctx));
+    bench_hdr.num_globals = 1;
+    ctx->img.header = &bench_hdr;
+    ctx->gc = devs_gc_create();
+    ctx->globals = devs_try_alloc(ctx, sizeof(value_t));
+    devs_gc_set_ctx(ctx->gc, ctx);
+    return ctx;
+}
+
+void bench_ctx_free(devs_ctx_t *ctx) {
+    devs_gc_destroy(ctx->gc);
+    jd_free(ctx);
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef __EMSCRIPTEN__
+
+#include "jd_sdk.h"
+#include "devicescript.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// number of threads used for GC marking; 0 means one per core (up to MAX_WORKERS)
+int gc_threads = 0;
+
+#define MAX_WORKERS 16
+
+static pthread_mutex_t pool_mut = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+static unsigned num_threads;
+static unsigned generation;
+static unsigned num_running;
+static unsigned num_requested;
+static void (*job_fn)(void *arg, unsigned idx);
+static void *job_arg;
+
+// for workers waiting for more marking work, see devs_gc_host_wait()
+static pthread_mutex_t idle_mut = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t idle_wake = PTHREAD_COND_INITIALIZER;
+
+unsigned devs_gc_host_num_workers(void) {
+    if (gc_threads > 0)
+        return gc_threads > MAX_WORKERS ? MAX_WORKERS : gc_threads;
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1)
+        n = 1;
+    return n > MAX_WORKERS ? MAX_WORKERS : n;
+}
+
+static void *worker_main(void *arg) {
+    unsigned idx = (uintptr_t)arg;
+    unsigned seen = 0;
+
+    pthread_mutex_lock(&pool_mut);
+    for (;;) {
+        while (generation == seen)
+            pthread_cond_wait(&pool_start, &pool_mut);
+        seen = generation;
+        if (idx >= num_requested)
+            continue;
+        pthread_mutex_unlock(&pool_mut);
+
+        job_fn(job_arg, idx);
+
+        pthread_mutex_lock(&pool_mut);
+        if (--num_running == 0)
+            pthread_cond_signal(&pool_done);
+    }
+    return NULL;
+}
+
+void devs_gc_host_run_workers(unsigned n, void (*fn)(void *arg, unsigned idx), void *arg) {
+    JD_ASSERT(n >= 1 && n <= MAX_WORKERS);
+
+    pthread_mutex_lock(&pool_mut);
+    // index 0 runs on the calling thread; the others are started once and kept
+    while (num_threads < n - 1) {
+        pthread_t thr;
+        if (pthread_create(&thr, NULL, worker_main, (void *)(uintptr_t)(num_threads + 1)) != 0)
+            JD_PANIC();
+        pthread_detach(thr);
+        num_threads++;
+    }
+    job_fn = fn;
+    job_arg = arg;
+    num_requested = n;
+    num_running = n - 1;
+    generation++;
+    pthread_cond_broadcast(&pool_start);
+    pthread_mutex_unlock(&pool_mut);
+
+    fn(arg, 0);
+
+    pthread_mutex_lock(&pool_mut);
+    while (num_running > 0)
+        pthread_cond_wait(&pool_done, &pool_mut);
+    pthread_mutex_unlock(&pool_mut);
+}
+
+void devs_gc_host_wait(bool (*ready)(void *arg), void *arg) {
+    pthread_mutex_lock(&idle_mut);
+    while (!ready(arg))
+        pthread_cond_wait(&idle_wake, &idle_mut);
+    pthread_mutex_unlock(&idle_mut);
+}
+
+void devs_gc_host_wake_workers(void) {
+    // taking the lock makes sure a worker between its ready() check and the wait gets this
+    pthread_mutex_lock(&idle_mut);
+    pthread_cond_broadcast(&idle_wake);
+    pthread_mutex_unlock(&idle_mut);
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef __EMSCRIPTEN__
+
+// GC mark-time benchmark (jdcli -B); builds a synthetic heap without running any program
+
+#include "bench.h"
+
+#include <stdio.h>
+
+extern int gc_threads;
+
+#define FANOUT 8
+#define TREE_DEPTH 3
+#define LEAF_SIZE 32
+#define NUM_RUNS 5
+
+static void fill_tree(devs_ctx_t *ctx, value_t arrv, int depth) {
+    for (unsigned i = 0; i < FANOUT; ++i) {
+        value_t child;
+        if (depth == 0) {
+            devs_buffer_t *b = devs_buffer_try_alloc(ctx, LEAF_SIZE);
+            child = devs_value_from_gc_obj(ctx, b);
+        } else {
+            devs_array_t *a = devs_array_try_alloc(ctx, FANOUT);
+            child = devs_value_from_gc_obj(ctx, a);
+        }
+        devs_array_t *arr = devs_handle_ptr_value(ctx, arrv);
+        arr->data[i] = child;
+        if (depth > 0)
+            fill_tree(ctx, child, depth - 1);
+    }
+}
+
+static devs_ctx_t *bench_ctx(unsigned mb) {
+    devs_ctx_t *ctx = bench_ctx_create();
+
+    // a forest of small trees, hanging off a single global
+    unsigned leaves = 1;
+    for (int i = 0; i < TREE_DEPTH; ++i)
+        leaves *= FANOUT;
+    // leaves plus a bit for the inner arrays
+    unsigned tree_bytes =
+        leaves * (LEAF_SIZE + sizeof(devs_buffer_t) + 2 * sizeof(uintptr_t)) * 9 / 8;
+    unsigned num_trees = mb * 1024 * 1024 / tree_bytes;
+
+    devs_array_t *forest = devs_array_try_alloc(ctx, num_trees);
+    ctx->globals[0] = devs_value_from_gc_obj(ctx, forest);
+    for (unsigned i = 0; i < num_trees; ++i) {
+        devs_array_t *tree = devs_array_try_alloc(ctx, FANOUT);
+        forest = devs_handle_ptr_value(ctx, ctx->globals[0]);
+        forest->data[i] = devs_value_from_gc_obj(ctx, tree);
+        fill_tree(ctx, forest->data[i], TREE_DEPTH - 1);
+    }
+    return ctx;
+}
+
+static unsigned best_mark_time(devs_ctx_t *ctx) {
+    unsigned best = 0xffffffff;
+    for (int i = 0; i < NUM_RUNS; ++i) {
+        devs_gc_collect(ctx->gc);
+        unsigned t = devs_gc_stats(ctx->gc)->last_mark_time;
+        if (t < best)
+            best = t;
+    }
+    return best;
+}
+
+int gc_bench(void) {
+    static const unsigned sizes[] = {1, 2, 4, 8, 12};
+    unsigned max_threads = devs_gc_host_num_workers();
+
+    printf("%8s %8s", "heap MB", "live MB");
+    for (unsigned n = 1; n <= max_threads; n *= 2)
+        printf(" %7ut", n);
+    printf("   (mark time in ms)\n");
+
+    for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        devs_ctx_t *ctx = bench_ctx(sizes[i]);
+        devs_gc_collect(ctx->gc);
+        const devs_gc_stats_t *st = devs_gc_stats(ctx->gc);
+        printf("%8.1f %8.1f", (st->live_bytes + st->free_bytes) / 1048576.0,
+               st->live_bytes / 1048576.0);
+        for (unsigned n = 1; n <= max_threads; n *= 2) {
+            gc_threads = n;
+            printf(" %8.2f", best_mark_time(ctx) / 1000.0);
+            fflush(stdout);
+        }
+        printf("\n");
+        bench_ctx_free(ctx);
+    }
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,249 @@
+#ifndef __EMSCRIPTEN__
+
+// GC compaction self-test (jdcli -K); builds a fragmented heap with every pointer-carrying
+// object kind, plus pinned blocks, compacts it, and checks all references still resolve
+
+#include "bench.h"
+
+#include <stdio.h>
+
+#define NUM_OBJS 420
+#define NUM_KINDS 8
+#define PIN_EVERY 16
+#define NUM_PINNED (NUM_OBJS / PIN_EVERY)
+#define PIN_SIZE 40
+#define BUF_SIZE 16
+#define JSON_CHUNK "{\"k\":[1,\"ab"
+
+static int num_failures;
+
+#define CHECK(cond)                                                                                \
+    do {                                                                                           \
+        if (!(cond)) {                                                                             \
+            printf("gctest: %s:%d: %s\n", __FILE__, __LINE__, #cond);                              \
+            num_failures++;                                                                        \
+        }                                                                                          \
+    } while (0)
+
+static devs_array_t *keep(devs_ctx_t *ctx) {
+    return devs_handle_ptr_value(ctx, ctx->globals[0]);
+}
+
+static value_t obj(devs_ctx_t *ctx, unsigned i) {
+    return keep(ctx)->data[i];
+}
+
+static void fill_pinned(uint8_t *p, unsigned i) {
+    for (unsigned j = 0; j < PIN_SIZE; ++j)
+        p[j] = i * 7 + j;
+}
+
+static void make_obj(devs_ctx_t *ctx, unsigned i) {
+    devs_array_t *arr;
+    value_t v;
+
+    // garbage in between live objects leaves holes after GC
+    devs_buffer_try_alloc(ctx, 24 + (i % 5) * 8);
+
+    switch (i % NUM_KINDS) {
+    case 0: {
+        devs_buffer_t *b = devs_buffer_try_alloc(ctx, BUF_SIZE);
+        for (unsigned j = 0; j < BUF_SIZE; ++j)
+            b->data[j] = i + j;
+        v = devs_value_from_gc_obj(ctx, b);
+        break;
+    }
+    case 1: {
+        char tmp[32];
+        unsigned sz = snprintf(tmp, sizeof(tmp), "object number %u", i);
+        v = devs_value_from_gc_obj(ctx, devs_string_try_alloc_init(ctx, tmp, sz));
+        break;
+    }
+    case 2: {
+        devs_map_t *m = devs_map_try_alloc(ctx, NULL);
+        keep(ctx)->data[i] = devs_value_from_gc_obj(ctx, m);
+        devs_map_set(ctx, m, devs_builtin_string(DEVS_BUILTIN_STRING_LENGTH),
+                     devs_value_from_int(i));
+        return;
+    }
+    case 3:
+        arr = devs_array_try_alloc(ctx, 2);
+        arr->data[0] = devs_value_from_int(i);
+        arr->data[1] = obj(ctx, i - 1); // the map
+        v = devs_value_from_gc_obj(ctx, arr);
+        break;
+    case 4:
+        v = devs_value_from_gc_obj(
+            ctx, devs_buffer_view_try_alloc(ctx, obj(ctx, i - 4), 2, BUF_SIZE - 4));
+        break;
+    case 5:
+        v = devs_value_from_gc_obj(ctx, devs_typed_array_try_alloc(ctx, DEVS_TYPED_ARRAY_INT16,
+                                                                   obj(ctx, i - 5), 0, 4));
+        break;
+    case 6:
+        v = devs_string_concat(ctx, obj(ctx, i - 5), obj(ctx, i - 5));
+        break;
+    case 7: {
+        // stopped inside a string, with an object, its key and an array on the stack
+        keep(ctx)->data[i] = devs_json_parser_alloc(ctx);
+        unsigned scope = devs_root_scope(ctx);
+        value_t chunk = devs_root_push(
+            ctx, devs_value_from_gc_obj(ctx, devs_string_try_alloc_init(ctx, JSON_CHUNK, strlen(JSON_CHUNK))));
+        devs_json_feed(ctx, obj(ctx, i), chunk);
+        devs_root_pop(ctx, scope);
+        return;
+    }
+    default:
+        JD_PANIC();
+    }
+    keep(ctx)->data[i] = v;
+}
+
+static void check_obj(devs_ctx_t *ctx, unsigned i) {
+    value_t v = obj(ctx, i);
+    unsigned sz;
+    char expected[64];
+
+    switch (i % NUM_KINDS) {
+    case 0: {
+        CHECK(devs_is_buffer(ctx, v));
+        const uint8_t *data = devs_buffer_data(ctx, v, &sz);
+        CHECK(sz == BUF_SIZE);
+        for (unsigned j = 0; j < BUF_SIZE; ++j)
+            CHECK(data[j] == (uint8_t)(i + j));
+        break;
+    }
+    case 1:
+    case 6: {
+        unsigned k = i % NUM_KINDS == 1 ? i : i - 5;
+        const char *s = devs_string_get_utf8(ctx, v, &sz);
+        if (k == i)
+            snprintf(expected, sizeof(expected), "object number %u", k);
+        else
+            snprintf(expected, sizeof(expected), "object number %uobject number %u", k, k);
+        CHECK(s && sz == strlen(expected) && memcmp(s, expected, sz) == 0);
+        break;
+    }
+    case 2: {
+        devs_map_t *m = devs_value_to_gc_obj(ctx, v);
+        CHECK(m && devs_is_map(m));
+        if (m)
+            CHECK(devs_value_to_int(ctx, devs_map_get(ctx, m, devs_builtin_string(
+                                                                  DEVS_BUILTIN_STRING_LENGTH))) ==
+                  (int)i);
+        break;
+    }
+    case 3: {
+        CHECK(devs_is_array(ctx, v));
+        devs_array_t *arr = devs_value_to_gc_obj(ctx, v);
+        CHECK(arr->length == 2);
+        CHECK(devs_value_to_int(ctx, arr->data[0]) == (int)i);
+        CHECK(devs_value_eq(ctx, arr->data[1], obj(ctx, i - 1)));
+        break;
+    }
+    case 4: {
+        CHECK(devs_is_buffer(ctx, v));
+        const uint8_t *data = devs_buffer_data(ctx, v, &sz);
+        CHECK(sz == BUF_SIZE - 4);
+        CHECK(data == (uint8_t *)devs_buffer_data(ctx, obj(ctx, i - 4), NULL) + 2);
+        CHECK(data[0] == (uint8_t)(i - 4 + 2));
+        break;
+    }
+    case 5: {
+        devs_typed_array_t *ta = devs_value_to_typed_array(ctx, v);
+        CHECK(ta != NULL);
+        if (ta) {
+            CHECK(devs_value_eq(ctx, ta->buffer, obj(ctx, i - 5)));
+            // little endian, as in the buffer
+            unsigned b = i - 5;
+            CHECK(devs_value_to_int(ctx, devs_typed_array_get(ctx, ta, 1)) ==
+                  (int16_t)((uint8_t)(b + 2) | ((uint8_t)(b + 3) << 8)));
+        }
+        break;
+    }
+    case 7: {
+        devs_json_parser_t *p = devs_value_to_gc_obj(ctx, v);
+        CHECK(devs_gc_tag(p) == DEVS_GC_TAG_JSON_PARSER);
+        if (devs_gc_tag(p) != DEVS_GC_TAG_JSON_PARSER)
+            break;
+        CHECK(p->token && memcmp(p->token->data, "ab", 2) == 0);
+        CHECK(p->stack && p->stack->length == 3);
+        if (!p->stack || p->stack->length != 3)
+            break;
+        value_t *st = p->stack->data;
+        const char *key = devs_string_get_utf8(ctx, st[1], &sz);
+        CHECK(devs_is_map(devs_value_to_gc_obj(ctx, st[0])));
+        CHECK(key && sz == 1 && key[0] == 'k');
+        CHECK(devs_is_array(ctx, st[2]) &&
+              devs_value_to_int(ctx, ((devs_array_t *)devs_value_to_gc_obj(ctx, st[2]))->data[0]) ==
+                  1);
+        break;
+    }
+    }
+}
+
+static void check_all(devs_ctx_t *ctx, uint8_t **pinned, uint8_t **pinned_addr) {
+    CHECK(keep(ctx)->length == NUM_OBJS);
+    for (unsigned i = 0; i < NUM_OBJS; ++i)
+        check_obj(ctx, i);
+    for (unsigned i = 0; i < NUM_PINNED; ++i) {
+        uint8_t tmp[PIN_SIZE];
+        fill_pinned(tmp, i);
+        CHECK(pinned[i] == pinned_addr[i]);
+        CHECK(memcmp(pinned[i], tmp, PIN_SIZE) == 0);
+    }
+}
+
+int gc_compact_test(void) {
+    uint8_t *pinned[NUM_PINNED], *pinned_addr[NUM_PINNED];
+    void *addr[NUM_OBJS];
+
+    devs_ctx_t *ctx = bench_ctx_create();
+    devs_array_t *arr = devs_array_try_alloc(ctx, NUM_OBJS);
+    ctx->globals[0] = devs_value_from_gc_obj(ctx, arr);
+
+    for (unsigned i = 0; i < NUM_OBJS; ++i) {
+        make_obj(ctx, i);
+        if (i % PIN_EVERY == PIN_EVERY - 1) {
+            unsigned k = i / PIN_EVERY;
+            pinned[k] = pinned_addr[k] = devs_try_alloc(ctx, PIN_SIZE);
+            fill_pinned(pinned[k], k);
+        }
+    }
+
+    devs_gc_collect(ctx->gc);
+    check_all(ctx, pinned, pinned_addr);
+    unsigned max_free = devs_gc_stats(ctx->gc)->max_free_block;
+    for (unsigned i = 0; i < NUM_OBJS; ++i)
+        addr[i] = devs_value_to_gc_obj(ctx, obj(ctx, i));
+    void *keep_addr = keep(ctx);
+
+    devs_set_global_flags(DEVS_FLAG_GC_STRESS); // validate the heap after compaction
+    devs_gc_compact(ctx->gc);
+    devs_reset_global_flags(DEVS_FLAG_GC_STRESS);
+
+    unsigned num_moved = keep(ctx) != keep_addr;
+    for (unsigned i = 0; i < NUM_OBJS; ++i)
+        if (devs_value_to_gc_obj(ctx, obj(ctx, i)) != addr[i])
+            num_moved++;
+    CHECK(num_moved > NUM_OBJS / 2);
+    CHECK(devs_gc_stats(ctx->gc)->max_free_block > max_free);
+    check_all(ctx, pinned, pinned_addr);
+
+    // the heap is still usable: replace every object, leaving the old ones as garbage
+    for (unsigned i = 0; i < NUM_PINNED; ++i)
+        devs_free(ctx, pinned[i]);
+    for (unsigned i = 0; i < NUM_OBJS; ++i)
+        make_obj(ctx, i);
+    devs_gc_compact(ctx->gc);
+    for (unsigned i = 0; i < NUM_OBJS; ++i)
+        check_obj(ctx, i);
+
+    bench_ctx_free(ctx);
+
+    printf("gctest: %u of %u objects moved; %s\n", num_moved, NUM_OBJS + 1,
+           num_failures ? "FAILED" : "OK");
+    return num_failures ? 1 : 0;
+}
+
+#endif
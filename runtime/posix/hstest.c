@@ -0,0 +1,162 @@
+#ifndef __EMSCRIPTEN__
+
+// Heap snapshot self-test (jdcli -S); writes a snapshot of a small heap and checks the node and
+// edge counts in its header against the nodes and edges actually emitted
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_OBJS 60
+#define NODE_FIELDS 6 // as in heapsnap.c
+#define NODE_EDGE_COUNT 4
+#define EDGE_FIELDS 3
+#define CHUNK 100 // small reads, so tokens get split between them
+
+static int num_failures;
+
+#define CHECK(cond)                                                                                \
+    do {                                                                                           \
+        if (!(cond)) {                                                                             \
+            printf("hstest: %s:%d: %s\n", __FILE__, __LINE__, #cond);                              \
+            num_failures++;                                                                        \
+        }                                                                                          \
+    } while (0)
+
+static devs_array_t *keep(devs_ctx_t *ctx) {
+    return devs_handle_ptr_value(ctx, ctx->globals[0]);
+}
+
+static void build_heap(devs_ctx_t *ctx) {
+    ctx->globals[0] = devs_value_from_gc_obj(ctx, devs_array_try_alloc(ctx, NUM_OBJS));
+    for (unsigned i = 0; i < NUM_OBJS; ++i) {
+        value_t v;
+        // garbage, which is collected before the snapshot is taken
+        devs_buffer_try_alloc(ctx, 16);
+        switch (i % 4) {
+        case 0:
+            v = devs_value_from_gc_obj(ctx, devs_buffer_try_alloc(ctx, 8 + i));
+            break;
+        case 1: {
+            char tmp[32];
+            unsigned sz = snprintf(tmp, sizeof(tmp), "string %u", i);
+            v = devs_value_from_gc_obj(ctx, devs_string_try_alloc_init(ctx, tmp, sz));
+            break;
+        }
+        case 2: {
+            devs_map_t *m = devs_map_try_alloc(ctx, NULL);
+            keep(ctx)->data[i] = devs_value_from_gc_obj(ctx, m);
+            devs_map_set(ctx, m, devs_builtin_string(DEVS_BUILTIN_STRING_LENGTH),
+                         keep(ctx)->data[i - 1]);
+            continue;
+        }
+        default: {
+            devs_array_t *arr = devs_array_try_alloc(ctx, 2);
+            arr->data[0] = keep(ctx)->data[i - 1];
+            arr->data[1] = devs_value_from_int(i);
+            v = devs_value_from_gc_obj(ctx, arr);
+            break;
+        }
+        }
+        keep(ctx)->data[i] = v;
+    }
+}
+
+static char *read_snapshot(devs_ctx_t *ctx, unsigned *size) {
+    devs_heapsnap_t *snap = devs_heapsnap_start(ctx);
+    unsigned len = 0, cap = 4096;
+    char *res = malloc(cap);
+    int n;
+    for (;;) {
+        if (len + CHUNK + 1 > cap) {
+            cap *= 2;
+            res = realloc(res, cap);
+        }
+        n = devs_heapsnap_read(snap, res + len, CHUNK);
+        if (n <= 0)
+            break;
+        len += n;
+    }
+    devs_heapsnap_free(snap);
+    CHECK(n == 0);
+    res[len] = 0;
+    *size = len;
+    return res;
+}
+
+static unsigned header_field(const char *json, const char *name) {
+    const char *p = strstr(json, name);
+    CHECK(p != NULL);
+    return p ? atoi(p + strlen(name)) : 0;
+}
+
+// counts the numbers in the array that starts after `name`; sums every `stride`-th one, from
+// `offset`, into *sum
+static unsigned array_len(const char *json, const char *name, unsigned stride, unsigned offset,
+                          unsigned *sum) {
+    const char *p = strstr(json, name);
+    CHECK(p != NULL);
+    if (!p)
+        return 0;
+    p += strlen(name);
+    unsigned n = 0;
+    *sum = 0;
+    while (*p != ']') {
+        char *end;
+        long v = strtol(p, &end, 10);
+        if (end == p) {
+            CHECK(!"not a number");
+            break;
+        }
+        if (n % stride == offset)
+            *sum += v;
+        n++;
+        p = end;
+        while (*p == ',' || *p == '\n')
+            p++;
+    }
+    return n;
+}
+
+int heapsnap_test(void) {
+    devs_ctx_t *ctx = bench_ctx_create();
+    build_heap(ctx);
+
+    unsigned size;
+    char *json = read_snapshot(ctx, &size);
+
+    unsigned node_count = header_field(json, "\"node_count\":");
+    unsigned edge_count = header_field(json, "\"edge_count\":");
+    unsigned edges_of_nodes, unused;
+    unsigned num_nodes = array_len(json, "\"nodes\":[", NODE_FIELDS, NODE_EDGE_COUNT,
+                                   &edges_of_nodes);
+    unsigned num_edges = array_len(json, "\"edges\":[", EDGE_FIELDS, 0, &unused);
+
+    CHECK(num_nodes % NODE_FIELDS == 0);
+    CHECK(num_edges % EDGE_FIELDS == 0);
+    CHECK(node_count == num_nodes / NODE_FIELDS);
+    CHECK(edge_count == num_edges / EDGE_FIELDS);
+    CHECK(edges_of_nodes == edge_count);
+    CHECK(node_count > NUM_OBJS);
+
+    // an allocation while the snapshot is read makes it fail, instead of producing a bad one
+    devs_heapsnap_t *snap = devs_heapsnap_start(ctx);
+    char buf[CHUNK];
+    CHECK(devs_heapsnap_read(snap, buf, sizeof(buf)) > 0);
+    devs_buffer_try_alloc(ctx, 16);
+    int n;
+    while ((n = devs_heapsnap_read(snap, buf, sizeof(buf))) > 0)
+        ;
+    CHECK(n < 0);
+    devs_heapsnap_free(snap);
+
+    bench_ctx_free(ctx);
+
+    printf("hstest: %u bytes, %u nodes, %u edges; %s\n", size, node_count, edge_count,
+           num_failures ? "FAILED" : "OK");
+    free(json);
+    return num_failures ? 1 : 0;
+}
+
+#endif
@@ -39,6 +39,19 @@ void jd_free(void *p) {
     free(p);
 }
 
+// no memset here - glibc maps large blocks lazily, so the heap reservation
+// only takes memory as the GC touches it
+void *devs_gc_host_reserve(unsigned size) {
+    void *p = malloc(size);
+    if (!p)
+        abort();
+    return p;
+}
+
+void devs_gc_host_release(void *p) {
+    free(p);
+}
+
 void pwr_enter_no_sleep(void) {}
 
 static pthread_mutex_t irq_mut = PTHREAD_MUTEX_INITIALIZER;
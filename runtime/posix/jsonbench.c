@@ -0,0 +1,84 @@
+#ifndef __EMSCRIPTEN__
+
+// JSON.parse() benchmark on telemetry-shaped input (jdcli -J)
+
+#include "bench.h"
+#include "interfaces/jd_hw.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_RECORDS 1000
+#define NUM_RUNS 20
+
+static char *make_telemetry(unsigned *size) {
+    unsigned cap = NUM_RECORDS * 200;
+    char *buf = jd_alloc(cap);
+    unsigned sz = 0;
+    buf[sz++] = '[';
+    for (unsigned i = 0; i < NUM_RECORDS; ++i) {
+        sz += snprintf(buf + sz, cap - sz,
+                       "%s{\"ts\":%u,\"temp\":%.2f,\"hum\":%.1f,\"lat\":%.7f,\"lon\":%.7f,"
+                       "\"acc\":[%.4f,%.4f,%.4f],\"vbat\":%.17g,\"ok\":true}",
+                       i ? "," : "", 1680000000 + i * 10, 18 + (i % 97) / 7.0,
+                       30 + (i % 41) / 3.0, 47.6 + i / 12345.0, -122.3 - i / 54321.0,
+                       (i % 13) / 100.0, -0.98 + (i % 7) / 1000.0, (i % 5) / 50.0,
+                       3.3 + i / 3.0e5);
+        JD_ASSERT(sz < cap - 1);
+    }
+    buf[sz++] = ']';
+    buf[sz] = 0;
+    *size = sz;
+    return buf;
+}
+
+static unsigned time_numbers(const char *json, double (*conv)(const char *, char **)) {
+    double sum = 0;
+    uint64_t t0 = tim_get_micros();
+    for (const char *p = json; *p; p++) {
+        if (*p == '-' || ('0' <= *p && *p <= '9')) {
+            char *endp;
+            sum += conv(p, &endp);
+            p = endp - 1;
+        }
+    }
+    unsigned r = (unsigned)(tim_get_micros() - t0);
+    return sum == 0 ? r + 1 : r; // keep sum alive
+}
+
+int json_bench(void) {
+    devs_ctx_t *ctx = bench_ctx_create();
+
+    unsigned size;
+    char *json = make_telemetry(&size);
+
+    unsigned best_parse = 0xffffffff, best_libc = 0xffffffff, best_devs = 0xffffffff;
+    for (int i = 0; i < NUM_RUNS; ++i) {
+        uint64_t t0 = tim_get_micros();
+        ctx->globals[0] = devs_json_parse(ctx, json, size, false);
+        unsigned t = (unsigned)(tim_get_micros() - t0);
+        JD_ASSERT(devs_is_array(ctx, ctx->globals[0]));
+        ctx->globals[0] = devs_undefined;
+        devs_gc_collect(ctx->gc);
+        if (t < best_parse)
+            best_parse = t;
+
+        t = time_numbers(json, strtod);
+        if (t < best_libc)
+            best_libc = t;
+        t = time_numbers(json, devs_strtod);
+        if (t < best_devs)
+            best_devs = t;
+    }
+
+    printf("%u records, %u bytes\n", NUM_RECORDS, size);
+    printf("JSON.parse():      %8.2f ms\n", best_parse / 1000.0);
+    printf("numbers, strtod(): %8.2f ms\n", best_libc / 1000.0);
+    printf("numbers, devs:     %8.2f ms\n", best_devs / 1000.0);
+
+    jd_free(json);
+    bench_ctx_free(ctx);
+    return 0;
+}
+
+#endif
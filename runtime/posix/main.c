@@ -5,6 +5,7 @@
 #include <errno.h>
 #include <pthread.h>
 #include <assert.h>
+#include <signal.h>
 
 #include "jd_sdk.h"
 #include "devicescript.h"
@@ -212,9 +213,48 @@ void app_process(void) {
 }
 
 #ifndef __EMSCRIPTEN__
+static const char *heapsnap_path;
+static volatile sig_atomic_t heapsnap_requested;
+
+static void heapsnap_signal(int sig) {
+    heapsnap_requested = 1;
+}
+
+static void write_heap_snapshot(void) {
+    devs_ctx_t *ctx = devsmgr_get_ctx();
+    if (!ctx) {
+        LOG("no program running; heap snapshot skipped");
+        return;
+    }
+
+    FILE *f = fopen(heapsnap_path, "wb");
+    if (!f) {
+        LOG("can't write %s", heapsnap_path);
+        return;
+    }
+
+    devs_heapsnap_t *snap = devs_heapsnap_start(ctx);
+    char buf[1024];
+    int n;
+    while ((n = devs_heapsnap_read(snap, buf, sizeof(buf))) > 0)
+        fwrite(buf, 1, n, f);
+    devs_heapsnap_free(snap);
+    fclose(f);
+
+    if (n < 0)
+        LOG("heap changed while writing %s; snapshot incomplete", heapsnap_path);
+    else
+        LOG("heap snapshot written to %s", heapsnap_path);
+}
+
 static void client_process(void) {
     jd_process_everything();
     target_wait_us(jd_max_sleep);
+
+    if (heapsnap_requested) {
+        heapsnap_requested = 0;
+        write_heap_snapshot();
+    }
 }
 
 static void run_sample(const char *name, int keepgoing) {
@@ -243,6 +283,9 @@ static void run_sample(const char *name, int keepgoing) {
 
     LOG("terminating program");
 
+    if (heapsnap_path)
+        write_heap_snapshot();
+
     devsmgr_deploy(NULL, 0);
     jd_lstore_force_flush();
     jd_services_deinit();
@@ -250,6 +293,13 @@ static void run_sample(const char *name, int keepgoing) {
 
 static jd_transport_ctx_t *transport_ctx = NULL;
 extern int settings_in_files;
+extern int gc_threads;
+int gc_bench(void);
+int json_bench(void);
+int gc_compact_test(void);
+int pkt_decode_test(void);
+int regcache_test(void);
+int heapsnap_test(void);
 
 
 int main(int argc, const char **argv) {
@@ -290,6 +340,25 @@ int main(int argc, const char **argv) {
             enable_lstore = 1;
         } else if (strcmp(arg, "-X") == 0) {
             devs_set_global_flags(DEVS_FLAG_GC_STRESS);
+        } else if (strcmp(arg, "-C") == 0) {
+            devs_set_global_flags(DEVS_FLAG_GC_COMPACT);
+        } else if (strcmp(arg, "-P") == 0) {
+            devs_set_global_flags(DEVS_FLAG_ALLOC_PROFILE);
+        } else if (strncmp(arg, "-G:", 3) == 0) {
+            // number of GC marking threads; 1 is serial; needs make GC_PARALLEL=1
+            gc_threads = atoi(arg + 3);
+        } else if (strcmp(arg, "-B") == 0) {
+            return gc_bench();
+        } else if (strcmp(arg, "-J") == 0) {
+            return json_bench();
+        } else if (strcmp(arg, "-K") == 0) {
+            return gc_compact_test();
+        } else if (strcmp(arg, "-D") == 0) {
+            return pkt_decode_test();
+        } else if (strcmp(arg, "-R") == 0) {
+            return regcache_test();
+        } else if (strcmp(arg, "-S") == 0) {
+            return heapsnap_test();
         } else if (strcmp(arg, "-w") == 0) {
             websock = 1;
         } else if (strcmp(arg, "-n") == 0) {
@@ -300,6 +369,10 @@ int main(int argc, const char **argv) {
             test_settings = 1;
         } else if (strncmp(arg, "-d:", 3) == 0) {
             cached_devid = jd_device_id_from_string(arg + 3);
+        } else if (strncmp(arg, "-H:", 3) == 0) {
+            // write .heapsnapshot on SIGUSR1 and at exit
+            heapsnap_path = arg + 3;
+            signal(SIGUSR1, heapsnap_signal);
         } else {
             fprintf(stderr, "unknown arg: %s\n", arg);
             return 1;
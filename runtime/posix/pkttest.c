@@ -0,0 +1,158 @@
+#ifndef __EMSCRIPTEN__
+
+// Packet decoder self-test (jdcli -D); decodes packets of every length with the compiled
+// decoders of pktdecode.c and checks the results match the generic field spec interpreter
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <math.h>
+
+#define SPECS_START 256 // bytes; packet specs, then field specs
+#define FIELDS_START 32 // words from SPECS_START
+#define MAX_LEN 24
+#define NUM_ROUNDS 3 // the first round compiles decoders, the rest use cached ones
+
+static uint32_t img[128];
+static int num_failures;
+
+#define CHECK(cond)                                                                                \
+    do {                                                                                           \
+        if (!(cond)) {                                                                             \
+            printf("pkttest: %s:%d: %s\n", __FILE__, __LINE__, #cond);                             \
+            num_failures++;                                                                        \
+        }                                                                                          \
+    } while (0)
+
+#define MAX_SPECS (FIELDS_START * 4 / sizeof(devs_packet_spec_t))
+
+static devs_packet_spec_t *pkts;
+static devs_field_spec_t *flds;
+static unsigned num_pkts, num_flds;
+
+static void add_single(unsigned numfmt) {
+    devs_packet_spec_t *p = &pkts[num_pkts++];
+    p->name_idx = 1;
+    p->numfmt_or_offset = numfmt;
+}
+
+// fields are given as numfmt, flags pairs
+static void add_struct(unsigned num, const uint8_t *fields) {
+    devs_packet_spec_t *p = &pkts[num_pkts++];
+    p->name_idx = 1;
+    p->flags = DEVS_PACKETSPEC_FLAG_MULTI_FIELD;
+    p->numfmt_or_offset = FIELDS_START + num_flds;
+    for (unsigned i = 0; i < num; ++i) {
+        devs_field_spec_t *f = &flds[num_flds++];
+        f->name_idx = 1;
+        f->numfmt = fields[2 * i];
+        f->flags = fields[2 * i + 1];
+    }
+    num_flds++; // terminator
+}
+
+#define STRUCT(...)                                                                                \
+    do {                                                                                           \
+        static const uint8_t fields[] = {__VA_ARGS__};                                             \
+        add_struct(sizeof(fields) / 2, fields);                                                    \
+    } while (0)
+
+#define REP DEVS_FIELDSPEC_FLAG_STARTS_REPEATS
+#define FIXED(fmt, shift) (DEVS_NUMFMT_##fmt | ((shift) << 4))
+
+static void build_specs(void) {
+    devs_img_header_t *hdr = (devs_img_header_t *)img;
+    hdr->num_globals = 1;
+    hdr->service_specs.start = SPECS_START;
+    pkts = (devs_packet_spec_t *)((uint8_t *)img + SPECS_START);
+    flds = (devs_field_spec_t *)((uint8_t *)img + SPECS_START + FIELDS_START * 4);
+
+    add_single(DEVS_NUMFMT_U16);
+    add_single(DEVS_NUMFMT_I8);
+    add_single(FIXED(I32, 10));
+    add_single(DEVS_NUMFMT_F32);
+    add_single(DEVS_NUMFMT_F64);
+    // fixed fields only
+    STRUCT(DEVS_NUMFMT_U8, 0, DEVS_NUMFMT_I16, 0, FIXED(U32, 8), 0);
+    // fixed fields followed by a repeated one
+    STRUCT(DEVS_NUMFMT_U8, 0, DEVS_NUMFMT_I16, REP);
+    STRUCT(DEVS_NUMFMT_I16, 0, DEVS_NUMFMT_U8, 0, DEVS_NUMFMT_F32, REP);
+    // only a repeated field
+    STRUCT(DEVS_NUMFMT_U16, REP);
+    // as many fields as a compiled decoder holds
+    STRUCT(DEVS_NUMFMT_I8, 0, DEVS_NUMFMT_U16, 0, DEVS_NUMFMT_I8, 0, DEVS_NUMFMT_U32, 0,
+           DEVS_NUMFMT_I8, 0, DEVS_NUMFMT_I16, 0, DEVS_NUMFMT_I8, 0, DEVS_NUMFMT_U8, 0);
+}
+
+static bool same_number(devs_ctx_t *ctx, value_t a, value_t b) {
+    if (devs_is_undefined(a) || devs_is_undefined(b))
+        return devs_is_undefined(a) && devs_is_undefined(b);
+    double x = devs_value_to_double(ctx, a), y = devs_value_to_double(ctx, b);
+    return x == y || (isnan(x) && isnan(y));
+}
+
+static bool same_value(devs_ctx_t *ctx, value_t a, value_t b) {
+    if (devs_is_array(ctx, a) != devs_is_array(ctx, b))
+        return false;
+    if (!devs_is_array(ctx, a))
+        return same_number(ctx, a, b);
+    devs_array_t *x = devs_value_to_gc_obj(ctx, a);
+    devs_array_t *y = devs_value_to_gc_obj(ctx, b);
+    if (x->length != y->length)
+        return false;
+    for (unsigned i = 0; i < x->length; ++i)
+        if (!same_number(ctx, x->data[i], y->data[i]))
+            return false;
+    return true;
+}
+
+int pkt_decode_test(void) {
+    uint8_t data[MAX_LEN];
+    for (unsigned i = 0; i < MAX_LEN; ++i)
+        data[i] = i * 37 + 5; // with the top bit set in some bytes
+
+    devs_ctx_t *ctx = bench_ctx_create();
+    build_specs();
+    ctx->img.header = (devs_img_header_t *)img;
+
+    unsigned num_fast = 0, num_checked = 0;
+    unsigned fast_per_spec[MAX_SPECS] = {0};
+    for (unsigned round = 0; round < NUM_ROUNDS; ++round) {
+        for (unsigned p = 0; p < num_pkts; ++p) {
+            const devs_packet_spec_t *pkt = &pkts[p];
+            // every length, so truncated packets and partial trailing elements are covered
+            for (unsigned len = 0; len <= MAX_LEN; ++len) {
+                unsigned scope = devs_root_scope(ctx);
+                value_t fast;
+                bool is_fast = devs_packet_decode_fast(ctx, pkt, data, len, &fast);
+                if (is_fast)
+                    devs_root_push(ctx, fast);
+                value_t exp = devs_root_push(ctx, devs_packet_decode_generic(ctx, pkt, data, len));
+                if (is_fast) {
+                    num_fast++;
+                    fast_per_spec[p]++;
+                    if (!same_value(ctx, fast, exp)) {
+                        printf("pkttest: spec %u, len %u: %s", p, len, devs_show_value(ctx, fast));
+                        printf(" != %s\n", devs_show_value(ctx, exp));
+                        num_failures++;
+                    }
+                }
+                CHECK(same_value(ctx, devs_packet_decode(ctx, pkt, data, len), exp));
+                num_checked++;
+                devs_root_pop(ctx, scope);
+            }
+        }
+    }
+
+    // all specs above are supposed to be compiled
+    for (unsigned p = 0; p < num_pkts; ++p)
+        CHECK(fast_per_spec[p] > 0);
+
+    bench_ctx_free(ctx);
+
+    printf("pkttest: %u of %u packets decoded by the fast path; %s\n", num_fast, num_checked,
+           num_failures ? "FAILED" : "OK");
+    return num_failures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,247 @@
+#ifndef __EMSCRIPTEN__
+
+// Register cache self-test (jdcli -R); runs random operations on a small cache, with few enough
+// buckets that hash chains are long, and checks it against a simple model after each step
+
+#include "devs_internal.h"
+
+#include <stdio.h>
+
+#define CACHE_SIZE 12
+#define NUM_ROLES 8
+#define NUM_CMDS 4
+#define NUM_ARGS 3
+#define NUM_KEYS (NUM_ROLES * NUM_CMDS * NUM_ARGS)
+#define NUM_STEPS 20000
+#define MAX_RESP 20 // above DEVS_QUERY_MAX_INLINE, so some values are heap-allocated
+
+// with 16 buckets, roles 16 apart are the ones that can share a chain for the same command
+static const uint16_t roles[NUM_ROLES] = {0, 1, 2, 3, 16, 17, 32, 48};
+static const uint16_t cmds[NUM_CMDS] = {0x1101, 0x1102, 0x1180, 0x1001};
+
+static int num_failures;
+
+#define CHECK(cond)                                                                                \
+    do {                                                                                           \
+        if (!(cond)) {                                                                             \
+            printf("rctest: %s:%d: %s\n", __FILE__, __LINE__, #cond);                              \
+            num_failures++;                                                                        \
+        }                                                                                          \
+    } while (0)
+
+typedef struct {
+    uint8_t role, cmd, arg;
+    uint8_t resp_size;
+    uint8_t seed; // for the value
+} rc_key_t;
+
+// live entries, most recently used first
+static rc_key_t model[CACHE_SIZE];
+static unsigned model_len;
+
+static uint32_t rnd_state = 1;
+static unsigned rnd(unsigned n) {
+    rnd_state = rnd_state * 1103515245 + 12345;
+    return (rnd_state >> 8) % n;
+}
+
+static rc_key_t key_of(unsigned k) {
+    rc_key_t r = {
+        .role = k % NUM_ROLES, .cmd = (k / NUM_ROLES) % NUM_CMDS, .arg = k / NUM_ROLES / NUM_CMDS};
+    return r;
+}
+
+static bool same_key(const rc_key_t *a, const rc_key_t *b) {
+    return a->role == b->role && a->cmd == b->cmd && a->arg == b->arg;
+}
+
+static int model_find(const rc_key_t *k) {
+    for (unsigned i = 0; i < model_len; ++i)
+        if (same_key(&model[i], k))
+            return i;
+    return -1;
+}
+
+static void model_remove(unsigned i) {
+    memmove(model + i, model + i + 1, (model_len - i - 1) * sizeof(rc_key_t));
+    model_len--;
+}
+
+static void model_push_first(const rc_key_t *k) {
+    JD_ASSERT(model_len < CACHE_SIZE);
+    memmove(model + 1, model, model_len * sizeof(rc_key_t));
+    model[0] = *k;
+    model_len++;
+}
+
+static devs_regcache_entry_t *lookup(devs_regcache_t *cache, const rc_key_t *k) {
+    return devs_regcache_lookup(cache, roles[k->role], cmds[k->cmd], k->arg);
+}
+
+static void fill(devs_regcache_entry_t *q, const rc_key_t *k) {
+    uint8_t *d = devs_regcache_data(q);
+    for (unsigned i = 0; i < k->resp_size; ++i)
+        d[i] = k->seed + i;
+}
+
+static void alloc(devs_regcache_t *cache, const rc_key_t *k) {
+    fill(devs_regcache_alloc(cache, roles[k->role], cmds[k->cmd], k->arg, k->resp_size), k);
+}
+
+static bool check_data(devs_regcache_entry_t *q, const rc_key_t *k) {
+    if (q->resp_size != k->resp_size)
+        return false;
+    uint8_t *d = devs_regcache_data(q);
+    for (unsigned i = 0; i < k->resp_size; ++i)
+        if (d[i] != (uint8_t)(k->seed + i))
+            return false;
+    return true;
+}
+
+static void check_cache(devs_regcache_t *cache) {
+    // every key is found iff it's in the model, with the right value
+    for (unsigned i = 0; i < NUM_KEYS; ++i) {
+        rc_key_t k = key_of(i);
+        int m = model_find(&k);
+        devs_regcache_entry_t *q = lookup(cache, &k);
+        CHECK((q != NULL) == (m >= 0));
+        if (q && m >= 0)
+            CHECK(check_data(q, &model[m]));
+    }
+
+    // the LRU list has live entries in model order, then all the free ones
+    unsigned n = 0, num_free = 0;
+    for (unsigned idx = cache->lru_first; idx != DEVS_REGCACHE_NONE;
+         idx = cache->entries[idx].lru_next) {
+        devs_regcache_entry_t *q = &cache->entries[idx];
+        if (q->service_command == 0) {
+            num_free++;
+            continue;
+        }
+        CHECK(num_free == 0);
+        CHECK(n < model_len && q->role_idx == roles[model[n].role] &&
+              q->service_command == cmds[model[n].cmd] && q->argument == model[n].arg);
+        n++;
+    }
+    CHECK(n == model_len);
+    CHECK(n + num_free == cache->num_entries);
+
+    // next() returns each entry of a (role, command) pair exactly once
+    for (unsigned role = 0; role < NUM_ROLES; ++role)
+        for (unsigned c = 0; c < NUM_CMDS; ++c) {
+            unsigned seen = 0, expected = 0;
+            for (unsigned i = 0; i < model_len; ++i)
+                if (model[i].role == role && model[i].cmd == c)
+                    expected |= 1 << model[i].arg;
+            devs_regcache_entry_t *q = NULL;
+            while ((q = devs_regcache_next(cache, roles[role], cmds[c], q)) != NULL) {
+                CHECK(q->role_idx == roles[role] && q->service_command == cmds[c]);
+                CHECK(!(seen & (1 << q->argument)));
+                seen |= 1 << q->argument;
+            }
+            CHECK(seen == expected);
+        }
+}
+
+static void step(devs_regcache_t *cache) {
+    rc_key_t k = key_of(rnd(NUM_KEYS));
+    int m = model_find(&k);
+    devs_regcache_entry_t *q = lookup(cache, &k);
+
+    switch (rnd(8)) {
+    case 0:
+    case 1:
+    case 2:
+        // a read; hits move to the front, misses are allocated, evicting the LRU entry
+        if (m >= 0) {
+            devs_regcache_mark_used(cache, q);
+            k = model[m];
+            model_remove(m);
+        } else {
+            if (model_len == CACHE_SIZE)
+                model_len--;
+            k.resp_size = 1 + rnd(MAX_RESP);
+            k.seed = rnd(256);
+            alloc(cache, &k);
+        }
+        model_push_first(&k);
+        break;
+    case 3:
+    case 4:
+        // an update with a different size, as in devs_jd_update_regcache()
+        if (m >= 0) {
+            devs_regcache_free(cache, q);
+            model_remove(m);
+        } else if (model_len == CACHE_SIZE) {
+            model_len--;
+        }
+        k.resp_size = 1 + rnd(MAX_RESP);
+        k.seed = rnd(256);
+        alloc(cache, &k);
+        model_push_first(&k);
+        break;
+    case 5:
+    case 6:
+        if (m >= 0) {
+            devs_regcache_free(cache, q);
+            model_remove(m);
+        }
+        break;
+    case 7:
+        if (rnd(4) == 0) {
+            devs_regcache_free_role(cache, roles[k.role]);
+            for (unsigned i = model_len; i > 0; --i)
+                if (model[i - 1].role == k.role)
+                    model_remove(i - 1);
+        }
+        break;
+    }
+}
+
+int regcache_test(void) {
+    devs_regcache_t cache;
+    devs_regcache_init(&cache, CACHE_SIZE);
+    CHECK(cache.num_entries == CACHE_SIZE);
+    CHECK(cache.num_buckets == 16);
+
+    // fill the cache, then use the entries in reverse; eviction has to follow that order
+    for (unsigned i = 0; i < CACHE_SIZE; ++i) {
+        rc_key_t k = key_of(i * 3);
+        k.resp_size = 4;
+        alloc(&cache, &k);
+    }
+    for (unsigned i = CACHE_SIZE; i > 0; --i) {
+        rc_key_t k = key_of((i - 1) * 3);
+        k.resp_size = 4;
+        devs_regcache_mark_used(&cache, lookup(&cache, &k));
+        model_push_first(&k);
+    }
+    check_cache(&cache);
+    for (unsigned i = 0; i < CACHE_SIZE; ++i) {
+        rc_key_t evicted = key_of((CACHE_SIZE - 1 - i) * 3);
+        CHECK(lookup(&cache, &evicted) != NULL);
+        rc_key_t k = key_of(i * 3 + 1);
+        k.resp_size = 1;
+        alloc(&cache, &k);
+        CHECK(lookup(&cache, &evicted) == NULL);
+    }
+    devs_regcache_free_all(&cache);
+    model_len = 0;
+    check_cache(&cache);
+
+    for (unsigned i = 0; i < NUM_STEPS; ++i) {
+        step(&cache);
+        check_cache(&cache);
+        if (num_failures) {
+            printf("rctest: failed at step %u\n", i);
+            break;
+        }
+    }
+
+    devs_regcache_destroy(&cache);
+
+    printf("rctest: %u steps; %s\n", NUM_STEPS, num_failures ? "FAILED" : "OK");
+    return num_failures ? 1 : 0;
+}
+
+#endif